@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Controller.h"
+
+/* Fractions of the difficulty are in thousandths, integers like the rest of the simulation. */
+const std::int32_t AI_ONE = 1000;
+
+/* Knobs of the computer player. */
+struct AiDifficulty
+{
+    int reactionTicks; /* Ticks before the player reacts to a change of direction of the ball. */
+    std::int32_t noise; /* Maximum prediction error, in thousandths of the pad height. Beyond about 620 the pad can miss the ball. */
+    std::int32_t speedCap; /* Thousandths of the ticks in which the pad is allowed to move, in [0, AI_ONE]. */
+    int serveTicks; /* Ticks the player holds the ball before serving. */
+};
+
+/* Computer player driven by the closed-form ball predictor. */
+class AiController : public Controller
+{
+public:
+    static const AiDifficulty EASY;
+    static const AiDifficulty MEDIUM;
+    static const AiDifficulty HARD;
+    static const AiDifficulty PERFECT;
+
+    explicit AiController(const AiDifficulty& difficulty);
+
+    void reset(std::uint32_t seed) override;
+    ControllerAction act(const PongState& state, const PongConfig& config, bool rightSide) override;
+
+private:
+    AiDifficulty _difficulty;
+    std::uint32_t _random; /* Xorshift state for the prediction noise. */
+    std::int32_t _targetY; /* Planned y coordinate of the centre of the pad. */
+    std::int32_t _lastSpeedX; /* Ball speed seen at the last tick, to detect changes of direction. */
+    std::int32_t _lastSpeedY;
+    int _reactionLeft; /* Ticks before the next plan. */
+    int _serveLeft; /* Ticks before serving. */
+    std::int32_t _moveBudget; /* Accumulated thousandths of a move, for the speed cap. */
+
+    std::int32_t nextNoise(); /* Uniform value in [-AI_ONE, AI_ONE]. */
+    void plan(const PongState& state, const PongConfig& config, bool rightSide); /* Choose a new target. */
+    PlayerMoved spin(const PongState& state, const PongConfig& config, bool rightSide) const; /* Move that sends the ball away from the other pad. */
+};
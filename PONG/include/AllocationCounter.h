@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+    Number of heap allocations made through operator new, to check that the steady state of the game does not allocate.
+    The global operator new and delete are only replaced in builds that define PONG_COUNT_ALLOCATIONS:
+    in the others the count stays at zero and allocationCounterEnabled() returns false.
+*/
+bool allocationCounterEnabled();
+std::uint64_t allocationCount(); /* Allocations since the start of the program, on every thread. */
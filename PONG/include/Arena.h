@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+/*
+    Bump allocator over a single block allocated up front.
+    Allocating moves a pointer and never reaches the heap; everything is released at once by reset().
+*/
+class Arena
+{
+public:
+    explicit Arena(std::size_t capacity);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(std::size_t size, std::size_t alignment); /* Null if the arena is full. */
+    void reset(); /* Release every allocation. */
+
+    /* Construct an object in the arena, null if it is full. Its destructor is never called. */
+    template <typename T>
+    T* create()
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena objects are never destroyed");
+        void* memory = allocate(sizeof(T), alignof(T));
+        return (memory != nullptr) ? new (memory) T() : nullptr;
+    }
+
+    std::size_t used() const; /* Bytes allocated since the last reset, with the alignment padding. */
+    std::size_t capacity() const;
+
+private:
+    std::unique_ptr<std::uint8_t[]> _memory;
+    std::size_t _capacity;
+    std::size_t _used;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <SDL.h>
+
+#include "MappedFile.h"
+
+/*
+    Asset bundles: the images of the game already decoded and the glyphs already rasterized, so that the startup
+    neither reads PNG files nor opens the font. Written by PONG --pack, mapped by the game with --bundle.
+
+    Layout (little endian, mapped and used in place):
+    - BundleHeader;
+    - imageCount BundleImage records;
+    - the RGBA32 pixels of every image, width * 4 bytes per row, each image 16-byte aligned.
+    A name can have several images: the first one is at its original size, the others are pre-scaled
+    to the sizes the game draws it at in common window sizes.
+*/
+
+const std::uint32_t BUNDLE_MAGIC = 0x444E4250; /* "PBND" */
+const std::uint32_t BUNDLE_VERSION = 1;
+const std::size_t BUNDLE_NAME_SIZE = 24; /* Longest name, with its terminating null. */
+const std::size_t BUNDLE_ALIGNMENT = 16;
+
+struct BundleHeader
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t imageCount;
+    std::uint32_t reserved;
+};
+
+struct BundleImage
+{
+    char name[BUNDLE_NAME_SIZE]; /* File name of an image, text of a glyph. */
+    std::int32_t width;
+    std::int32_t height;
+    std::uint64_t offset; /* Of the pixels, from the start of the file. */
+};
+
+/* Collects the images of a bundle and writes the file. */
+class AssetBundleWriter
+{
+public:
+    bool addImage(const std::string& name, SDL_Surface* surface); /* Copy an RGBA32 surface, unless the name already has an image of its size. */
+    bool save(const std::string& path) const;
+
+private:
+    std::vector<BundleImage> _images; /* Offsets relative to the start of _pixels until save(). */
+    std::vector<std::uint8_t> _pixels;
+};
+
+/* Memory-mapped asset bundle. */
+class AssetBundle
+{
+public:
+    AssetBundle();
+
+    bool open(const std::string& path); /* Map and validate a bundle file. */
+
+    const BundleImage* find(const std::string& name) const; /* Image at its original size, null if there is none. */
+    const BundleImage* find(const std::string& name, int width, int height) const; /* Image pre-scaled to a size, null if there is none. */
+    SDL_Surface* createSurface(const BundleImage& image) const; /* Surface over the mapped pixels, valid while the bundle is open. */
+
+private:
+    MappedFile _file;
+    BundleHeader _header;
+    const BundleImage* _images;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "PongState.h"
+#include "UdpSocket.h"
+
+/*
+    Live broadcast of a match to read-only spectators over UDP.
+    Every snapshot is bit-packed as a delta against a baseline: a snapshot at a tick multiple of BROADCAST_BASELINE
+    that the spectator acknowledged, or nothing for a full snapshot. Spectators acknowledging the same baseline
+    receive the very same datagram, so a snapshot is encoded at most once per baseline still in the history,
+    whatever the number of spectators, and sent to all of them from that one buffer.
+*/
+
+const std::uint32_t BROADCAST_MAGIC = 0x50425243; /* "PBRC" */
+const std::uint32_t BROADCAST_BASELINE = 16; /* Ticks between two snapshots usable as a baseline. */
+const std::uint32_t BROADCAST_HISTORY = 256; /* Ticks of states kept by the server, a power of two. */
+const std::uint32_t BROADCAST_BASELINES = BROADCAST_HISTORY / BROADCAST_BASELINE; /* Baselines kept, by both sides. */
+const std::size_t BROADCAST_MAX_SNAPSHOT = 64; /* Bytes of the largest snapshot datagram. */
+const std::uint32_t BROADCAST_TIMEOUT = 5000; /* Milliseconds without a packet after which a spectator is dropped. */
+const std::uint32_t BROADCAST_NO_ACK = 0xFFFFFFFF;
+
+/* Datagram from a spectator. */
+struct BroadcastRequest
+{
+    std::uint32_t magic;
+    std::uint32_t ackTick; /* Newest baseline received, BROADCAST_NO_ACK if none: asks for a full snapshot. */
+};
+
+/*
+    Encode the state at tick as a delta against base, the state at baseTick, into buffer.
+    A null base encodes a full snapshot. Returns the size of the datagram, at most BROADCAST_MAX_SNAPSHOT.
+*/
+std::size_t encodeSnapshot(std::uint8_t* buffer, std::uint32_t tick, const PongState& state, std::uint32_t baseTick, const PongState* base);
+
+/* Tick and base tick of a snapshot datagram, false if it is not one. The base tick equals the tick for a full snapshot. */
+bool readSnapshotTicks(const std::uint8_t* data, std::size_t size, std::uint32_t& tick, std::uint32_t& baseTick);
+
+/* Decode a snapshot datagram, base is the state at its base tick (ignored by a full one). False if it is corrupted. */
+bool decodeSnapshot(const std::uint8_t* data, std::size_t size, const PongState& base, PongState& state);
+
+struct BroadcastSettings
+{
+    std::uint32_t sendInterval = 4; /* Ticks between two snapshots, a divisor of BROADCAST_BASELINE. */
+};
+
+/* Sends the states of a match to every spectator that asked for them. */
+class BroadcastServer
+{
+public:
+    explicit BroadcastServer(const BroadcastSettings& settings = BroadcastSettings());
+
+    bool open(std::uint16_t port);
+    std::uint16_t localPort() const;
+    void publish(const PongState& state); /* State of the next tick, from the simulation. */
+
+    std::size_t getSpectators() const;
+    std::uint64_t getEncodes() const; /* Snapshots encoded. */
+    std::uint64_t getSnapshots() const; /* Datagrams sent. */
+    std::uint64_t getFailedSends() const; /* Datagrams the socket refused. */
+    std::uint64_t getBytes() const; /* Bytes of the datagrams sent. */
+    double getEncodeSeconds() const; /* Time spent encoding. */
+    double getSendSeconds() const; /* Time spent sending. */
+
+private:
+    struct Spectator
+    {
+        UdpAddress address;
+        std::uint32_t ackTick;
+        std::uint32_t lastSeen; /* Milliseconds. */
+    };
+
+    /* Spectators sharing a baseline, and the snapshot encoded for them. */
+    struct Group
+    {
+        std::vector<UdpAddress> addresses;
+        std::uint8_t snapshot[BROADCAST_MAX_SNAPSHOT];
+    };
+
+    BroadcastSettings _settings;
+    UdpSocket _socket;
+    std::uint32_t _tick; /* Ticks published. */
+    PongState _history[BROADCAST_HISTORY]; /* State of every recent tick. */
+    std::vector<Spectator> _spectators;
+    std::unordered_map<std::uint64_t, std::size_t> _spectatorIndices; /* Index in _spectators, by address. */
+    Group _groups[BROADCAST_BASELINES + 1]; /* One per baseline in the history, the last one for full snapshots. */
+
+    std::uint64_t _encodes;
+    std::uint64_t _snapshots;
+    std::uint64_t _failedSends;
+    std::uint64_t _bytes;
+    double _encodeSeconds;
+    double _sendSeconds;
+
+    void receive(std::uint32_t now);
+    void broadcast(std::uint32_t now);
+};
+
+/* Follows a broadcast match. */
+class BroadcastClient
+{
+public:
+    BroadcastClient();
+
+    bool open(const UdpAddress& server); /* Subscribe to a server from any free port. */
+    void poll(); /* Read the waiting snapshots, acknowledge the baselines, subscribe again if nothing arrives. */
+
+    bool hasState() const; /* A snapshot was decoded. */
+    std::uint32_t tick() const; /* Tick of the newest snapshot. */
+    const PongState& state() const; /* State of the newest snapshot. */
+    std::uint64_t getSnapshots() const; /* Snapshots decoded. */
+    std::uint64_t getDropped() const; /* Snapshots whose baseline was unknown or that were corrupted. */
+
+private:
+    UdpSocket _socket;
+    UdpAddress _server;
+    bool _hasState;
+    std::uint32_t _tick;
+    PongState _state;
+    std::uint32_t _ackTick; /* Newest baseline received, BROADCAST_NO_ACK if none. */
+    std::uint32_t _baselineTicks[BROADCAST_BASELINES]; /* Baselines received, by tick. */
+    PongState _baselines[BROADCAST_BASELINES];
+    std::uint32_t _lastReceive; /* Milliseconds. */
+    std::uint32_t _lastRequest;
+    std::uint64_t _snapshots;
+    std::uint64_t _dropped;
+
+    void request(std::uint32_t now);
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PongState.h"
+
+/* Action chosen by a controller for one tick. */
+struct ControllerAction
+{
+    PlayerMoved move; /* Direction of the pad. */
+    bool serve; /* Serve the ball if it is locked to this pad. */
+};
+
+/* Drives one pad of a match from the match state, without a window. */
+class Controller
+{
+public:
+    virtual ~Controller() {}
+
+    virtual void reset(std::uint32_t seed); /* Called before every match. */
+    virtual ControllerAction act(const PongState& state, const PongConfig& config, bool rightSide) = 0; /* Called on every tick. */
+};
+
+std::uint8_t toInput(const ControllerAction& action, bool rightSide); /* Convert an action to the PongInput bits of one side. */
+
+/* Never moves, serves as soon as it gets the ball. */
+class IdleController : public Controller
+{
+public:
+    ControllerAction act(const PongState& state, const PongConfig& config, bool rightSide) override;
+};
+
+/* Moves at random, keeping each direction for a random number of ticks. */
+class RandomController : public Controller
+{
+public:
+    RandomController();
+
+    void reset(std::uint32_t seed) override;
+    ControllerAction act(const PongState& state, const PongConfig& config, bool rightSide) override;
+
+private:
+    std::uint32_t _random; /* Xorshift state. */
+    PlayerMoved _move; /* Current direction. */
+    int _ticksLeft; /* Ticks before choosing a new direction. */
+};
+
+/* Keeps the centre of the pad aligned with the centre of the ball. */
+class FollowController : public Controller
+{
+public:
+    ControllerAction act(const PongState& state, const PongConfig& config, bool rightSide) override;
+};
+
+/* Built-in controllers, by name. */
+std::vector<std::string> controllerNames();
+std::unique_ptr<Controller> createController(const std::string& name); /* Returns nullptr if the name is unknown. */
@@ -1,16 +1,64 @@
 #pragma once
 
-#include "LTexture.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
 
-/*
-    Playere movement status for the current frame.
-    -1 -> player moved up, 0 -> player didn't move, 1 -> player moved down.
-*/
-enum class PlayerMoved
+#include "AssetBundle.h"
+#include "Broadcast.h"
+#include "Controller.h"
+#include "Netplay.h"
+#include "Profiler.h"
+#include "PongState.h"
+#include "Replay.h"
+#include "SpriteBatch.h"
+#include "TextureAtlas.h"
+#include "ThreadPool.h"
+#include "TripleBuffer.h"
+
+/* Window and renderer settings of Game::init. Defaults are those of the game. */
+struct GameOptions
+{
+    int windowWidth = 0; /* Size of a windowed game, 0 -> fullscreen on the desktop. */
+    int windowHeight = 0;
+    bool softwareRenderer = false; /* Use SDL's software renderer instead of the accelerated one. */
+    bool vsync = true; /* Pace the frames with the display. */
+    bool audio = true; /* Initialize the audio subsystem, not available on every headless machine. */
+    bool idleWait = true; /* Sleep until an event instead of redrawing the same frame when nobody plays. */
+    bool lowLatency = false; /* Apply the key events at the tick they happened, and start every frame as late as the display allows. */
+    bool simulationThread = false; /* Run the simulation on its own thread, the main thread polls the events and renders. */
+    bool dirtyRects = false; /* Render in software straight to the window surface and update only the areas that changed. */
+};
+
+/* Key event waiting for the tick it happened in, timed on the performance counter. */
+struct KeyEvent
+{
+    Uint64 time;
+    std::uint8_t input; /* PongInput bit of the key. */
+    bool down;
+};
+
+/* Image or glyph of the atlas, decoded by a loader thread. */
+struct SpriteLoad
+{
+    std::string name; /* File name of an image, text of a glyph: its key in a bundle. */
+    bool text;
+    int* sprite; /* Receives the id of the image in the atlas. */
+    SDL_Surface* surface; /* Null until decoded, and if decoding failed. */
+    Uint64 time; /* Counter ticks spent decoding it. */
+};
+
+/* Simulation state published to the render thread. */
+struct GameSnapshot
 {
-    UP = -1,
-    NA,
-    DOWN
+    PongState previous; /* State at the tick before, to interpolate from. */
+    PongState current;
+    Uint64 time; /* Time at which the current state is reached: the end of its tick. */
+    Uint64 inputTime; /* Oldest input applied since the previous snapshot, 0 if none. */
+    Uint64 physicsTime; /* Counter ticks spent simulating since the start, a total so that skipped snapshots are not lost. */
+    bool finished; /* The replay is over. */
 };
 
 class Game
@@ -25,14 +73,8 @@ public:
     const int START_WIDTH = 800; /* Initial width of the window. */
     const int START_HEIGHT = 600; /* Initial height of the window. */
     const int FONT_SIZE = 100; /* Font size for in-game text. */
-    const int BORDER_OFFSET = 45; /* Offset of the table border from the left margin. */
-    const int BORDER_WIDTH = 15; /* Width of the border line. */
-    const int GOAL_WIDTH = 15; /* Width of the goal line. */
-    const int GOAL_OFFSET = 404; /* Offset of the goal line from the table border. */
-    const int PAD_BORDER = 10; /* Shadow border of the player pad. */
     const int UPPER_MARGIN = 30; /* Margin from the top of the screen. */
     const int SEPARATOR_MARGIN = 20; /* Margin from the score separator. */
-    const int BALL_MARGIN = 8; /* Margin from the surface of the ball. */
 
     const Uint8 DEFAULT_RED = 0; /* Initial red component of default colour. */
     const Uint8 DEFAULT_GREEN = 0; /* Initial green component of default colour. */
@@ -41,12 +83,27 @@ public:
 
     const float TABLE_COEFF = 0.9f; /* Percentage of the vertical space that is occupied by the playing field. */
     const float SCORE_HCOEFF = 0.2f; /* Percentage of the horizontal space that is occupied by the score text. */
-    const float PLAYER_SPEED_COEFF = 0.01f; /* Percentage of the screen covered in one frame by the player. */
-    const float BALL_SPEED_COEFF = 0.005f; /* Percentage of the horizontal space covered in one frame by the player. */
 
     const SDL_Color SCORE_TEXT_COLOUR = { 255, 255, 255 }; /* Colour of the score text. */
 
-    const Uint32 MIN_FRAME_TIME = 10; /* Minimum frame time. */
+    const Uint32 TICK_RATE = 240; /* Number of simulation ticks per second. */
+    const Uint32 MAX_TICKS_PER_FRAME = 25; /* Maximum number of ticks simulated in a single frame, to avoid spiralling after a stall. */
+    const Uint32 IDLE_WAIT = 100; /* Longest sleep in milliseconds while the game is idle. */
+    const std::uint64_t ALLOCATION_WARMUP_FRAMES = 120; /* Frames allowed to allocate before the loop must not anymore. */
+
+    /* Frame pacing of the low latency mode. */
+    const int DEFAULT_REFRESH_RATE = 60; /* Used when the display does not report its refresh rate. */
+    const int PACING_FRAMES = 60; /* Recent frames whose slowest cost is expected for the next frame. */
+    const Uint64 PACING_MARGIN = 1000; /* Microseconds left between the expected end of a frame and the vblank. */
+
+    /* Profiler overlay. */
+    const SDL_Keycode PROFILER_KEY = SDLK_F3; /* Shows and hides the overlay. */
+    const int PROFILER_MARGIN = 10; /* Margin of the overlay from the top left corner. */
+    const int PROFILER_ROW_HEIGHT = 24; /* Height of the row of a zone. */
+    const int PROFILER_TEXT_HEIGHT = 20; /* Height of the text of a row. */
+    const int PROFILER_LABEL_WIDTH = 140; /* Space for the name of the zone. */
+    const int PROFILER_BAR_WIDTH = 300; /* Width of a bar for a 60 Hz frame. */
+    const int PROFILER_COLUMN_WIDTH = 100; /* Width of the p50, p99 and max columns. */
 
 
     /* Names of the required media files. */
@@ -55,62 +112,160 @@ public:
     const std::string PAD_NAME = "pad.png";
     const std::string BALL_NAME = "ball.png";
 
+    /* Asset loading. */
+    const unsigned int LOADER_THREADS = 4; /* Workers decoding the images and the glyphs. */
+    const Uint32 PLACEHOLDER_INTERVAL = 16; /* Milliseconds between two frames of the loading placeholder. */
+    const int PLACEHOLDER_BAR_WIDTH = 300; /* Progress bar of the placeholder. */
+    const int PLACEHOLDER_BAR_HEIGHT = 10;
+
+    /* Window sizes for which a bundle has the images pre-scaled, the others resample them at startup. */
+    const SDL_Point BUNDLE_RESOLUTIONS[6] = { { 800, 600 }, { 1280, 720 }, { 1366, 768 }, { 1600, 900 }, { 1920, 1080 }, { 2560, 1440 } };
+
     /* Constructor - Destructor. */
     Game();
     ~Game();
 
-    bool init(std::string texturePath, std::string fontPath); /* Load required data and initialize the game. */
+    bool init(const std::string& texturePath, const std::string& fontPath, const GameOptions& options = GameOptions()); /* Load required data and initialize the game. */
     void play(); /* Play the game. */
+    void setController(bool rightSide, std::unique_ptr<Controller> controller); /* Drive a pad with a controller instead of the keyboard. */
+    void setRecording(const std::string& path); /* Record the inputs of the match to a replay file, written when the game ends. */
+    void setReplay(Replay* replay, std::uint64_t startTick); /* Play a replay from the given tick instead of reading the inputs. */
+    void setNetplay(RollbackSession* session); /* Play the pad of this side of a remote match, the keys of both pads move it. */
+    void setBroadcast(BroadcastServer* server); /* Send the state of every tick to the spectators of the match. */
+    void setSpectating(BroadcastClient* client); /* Show a broadcast match instead of playing one. */
+    void setProfiling(const std::string& path); /* Write the profiler statistics to a CSV file when the game ends. */
+    void setBundle(AssetBundle* bundle); /* Take the images and glyphs from a bundle instead of the image and font files. */
+    bool packBundle(const std::string& texturePath, const std::string& fontPath, const std::string& bundlePath); /* Write the images and glyphs, also pre-scaled for BUNDLE_RESOLUTIONS, to a bundle. */
+    void renderFrame(float alpha); /* Render and present a single frame of the current state. */
+    std::uint64_t getSkippedFrames() const; /* Frames not drawn because the game was idle. */
+    const Profiler& getProfiler() const; /* Frame, latency and asset load times measured so far. */
+    std::uint64_t getSteadyAllocations() const; /* Heap allocations after the warm-up frames, always 0 without PONG_COUNT_ALLOCATIONS. */
 
 private:
     /* Window variables. */
     SDL_Window* _window; /* Main window of the game. */
     SDL_Renderer* _renderer; /* Main renderer of the game. */
+    GameOptions _options;
     int _wWidth; /* Window width. */
     int _wHeight; /* Window height. */
+    std::string _texturePath; /* Folder of the images, kept to resample them when the display changes. */
+    AssetBundle* _bundle; /* Source of the images and glyphs, null -> the files. */
 
     /* Texture data. */
-    LTexture _background; /* Playing field background. */
-    LTexture _pad; /* Player pad. */
-    LTexture _ball; /* The ball. */
-    LTexture _colon; /* Colon separating the two scores. */
-    LTexture _leftScoreText; /* Text of the left score. */
-    LTexture _rightScoreText; /* Text of the right score. */
+    TextureAtlas _atlas; /* Every static image of the game. */
+    SpriteBatch _batch; /* Quads of the current frame. */
+    int _backgroundSprite; /* Playing field background. */
+    int _padSprite; /* Player pad. */
+    int _ballSprite; /* The ball. */
+    int _colonSprite; /* Colon separating the two scores. */
+    int _digitSprites[10]; /* Glyphs of the digits, rasterized once to compose the scores. */
+    int _zoneSprites[ZONE_COUNT]; /* Names of the profiler zones. */
+    std::vector<std::string> _spriteNames; /* Name of every image of the atlas, its key in a bundle. */
+
+    /* Asset loading. */
+    std::string _fontPath; /* Folder of the font, opened by the first load. */
+    std::unique_ptr<ThreadPool> _loaders; /* Created by the first load from the files. */
+    std::vector<SpriteLoad> _spriteLoads; /* Sprites of the current load, in the order of their ids. */
+    std::atomic<std::size_t> _decodedSprites; /* Entries of _spriteLoads done, successfully or not. */
+    Uint64 _fontTime; /* Counter ticks spent opening the font, 0 once reported. */
+
+    /* Cache of the table, the separator and the scores, redrawn only when a score changes. */
+    SDL_Texture* _staticLayer; /* Render target of the window size, null if the renderer has none. */
+    std::int32_t _layerLeftScore; /* Scores drawn in the static layer, -1 -> not drawn yet. */
+    std::int32_t _layerRightScore;
+
+    /* Dirty rectangles. */
+    bool _fullRedraw; /* The whole window must be drawn and updated in the next frame. */
+    SDL_Rect _lastSprites[3]; /* Pads and ball in the previous frame. */
+    std::vector<SDL_Rect> _dirtyAreas; /* Areas of the window updated by the next present(). */
+
+    /* Low latency input and pacing. */
+    std::vector<KeyEvent> _keyEvents; /* Key events not applied yet, oldest first. */
+    std::uint8_t _keyInputs; /* Keyboard input after the events applied so far. */
+    Uint64 _pendingInput; /* Time of the oldest input applied since the last present, 0 if none. */
+    Uint64 _lastPresent; /* Time at which the last present returned. */
+    std::vector<Uint64> _frameCosts; /* Cost of the last PACING_FRAMES frames, without the present. */
+    std::size_t _frameCostIndex;
+    int _refreshRate; /* Of the display of the window. */
+
+    /* Simulation thread. */
+    TripleBuffer<GameSnapshot> _snapshots;
+    std::atomic<bool> _simulating; /* Cleared by the render thread to stop the simulation thread. */
+    std::mutex _keyMutex; /* Protects _sharedKeyEvents and _renderIdle. */
+    std::vector<KeyEvent> _sharedKeyEvents; /* Key events polled by the render thread, not taken by the simulation yet. */
+    bool _renderIdle; /* The render thread skips its frames: the simulation thread sleeps until a key event or the end. */
+    std::condition_variable _simulationWake; /* Signalled with a key event, when the render thread leaves idle and at the end. */
+    Uint64 _lastKeyEvent; /* Time of the newest key event handed to the simulation, render thread only. */
+
+    /* Idle mode. */
+    std::uint64_t _shownHash; /* hashState of the last rendered frame. */
+    std::uint64_t _skippedFrames;
+
+    /* Heap allocations of the game loop, see AllocationCounter.h. */
+    std::uint64_t _loopFrames; /* Frames started, drawn or skipped. */
+    std::uint64_t _lastAllocationCount; /* allocationCount() at the start of the current frame. */
+    std::uint64_t _steadyAllocations; /* Made during the frames after the warm-up. */
+    std::uint64_t _maxFrameAllocations; /* Most made during a single frame after the warm-up. */
 
     SDL_Rect _backGroundDest; /* Background destination rectangle. */
+    float _pixelsPerUnitX; /* Horizontal size of a table unit on screen. */
+    float _pixelsPerUnitY; /* Vertical size of a table unit on screen. */
     TTF_Font* _font; /* Main game font. */
 
-    /* Player variables. */
+    /* Match state. */
+    PongConfig _config; /* Table geometry and speeds. */
+    PongState _state; /* State at the current tick. */
+    PongState _previousState; /* State at the previous tick, used to interpolate between two simulation states. */
+    std::unique_ptr<Controller> _leftController; /* Computer player of the left pad, if any. */
+    std::unique_ptr<Controller> _rightController; /* Computer player of the right pad, if any. */
+
+    /* Recording and replay. */
+    std::string _recordPath; /* Replay file to write, empty if the match is not recorded. */
+    std::unique_ptr<ReplayWriter> _recorder;
+    Replay* _replay; /* Replay being played, if any. */
+    std::uint64_t _replayStart; /* First tick of the replay to show. */
+    RollbackSession* _netplay; /* Remote match, if any. */
+    BroadcastServer* _broadcast; /* Spectators of this match, if any. */
+    BroadcastClient* _spectating; /* Broadcast match shown, if any. */
+
+    /* Rendering rectangles of the moving objects. */
     SDL_Rect _leftPlayer; /* Position of the left pad. */
     SDL_Rect _rightPlayer; /* Position of the right pad. */
-    SDL_Rect _leftPlayerLock; /* Left player reset position. */
-    SDL_Rect _rightPlayerLock; /* Right player reset position. */
-    int _playerUpperLimit; /* Minimum y coordinate of the player. */
-    int _playerLowerLimit; /* Maximum y coordinate of the player. */
-    int _leftScore; /* Score for the left player. */
-    int _rightScore; /* Score fot the right player. */
-    PlayerMoved _leftPlayerMoved; 
-    PlayerMoved _rightPlayerMoved;
-    float _playerSpeed; /* Player speed in pixels per second. */
-
-    /* Ball variables. */
     SDL_Rect _ballPosition; /* Ball current position. */
-    SDL_Rect _leftPlayerBallLock; /* Ball left reset position. */
-    SDL_Rect _rightPlayerBallLock; /* Ball right reset position. */
-    int _ballDefaultSpeed; /* Default horizontal speed of the ball. */
-    int _ballSpeedX; /* Ball speed on x axis. */
-    int _ballSpeedY; /* Ball speed on y axis. */
-    int _leftGoal; /* Left goal x coordinate. */
-    int _rightGoal; /* Right goal x coordinate. */
-    int _ballLowerLimit; /* Lower border for the ball. */
-    bool _lock; /* Is the ball locked to a player? */
-    bool _lockSide; /* False -> ball to the left, True -> ball to the right. */
 
     /* Score position and size. */
-    SDL_Rect _leftScoreRect;
-    SDL_Rect _rightScoreRect;
     SDL_Rect _separatorRect;
-    float _textScale;
 
-    void render(); /* Render the game. */
+    /* Profiling. */
+    Profiler _profiler;
+    bool _showProfiler; /* Is the overlay visible? */
+    std::string _profilePath; /* CSV file written at the end, empty if none. */
+
+    bool openMedia(); /* Initialize the image and font libraries. */
+    bool createRenderer(); /* Create the renderer, or recreate it for a new window surface. */
+    bool loadSprites(); /* Load the images and glyphs of the atlas at their original size, and wait for them. */
+    void startLoading(); /* Take the sprites from the bundle, or start decoding them on the loader threads. */
+    void decodeGlyphs(); /* Loader task: open the font if needed and rasterize every glyph. */
+    bool finishLoading(); /* Wait for the loaders and add the sprites to the atlas, false if any failed. */
+    void renderPlaceholder(); /* Frame shown while the loaders run: the progress of the load. */
+    PongLayout imageLayout() const; /* Table geometry given by the original size of the images. */
+    bool fitToWindow(); /* Place everything for the current window size and build the atlas at those sizes, false if the previous atlas had to be kept. */
+    void placeSprites(int width, int height); /* Compute the position of everything and the size of every image for a window size. */
+    void sizeSprite(int id, int width, int height); /* Set the size of an image, taking it pre-scaled from the bundle if it has it. */
+    bool pollEvents(bool& keyEvents); /* Handle the window and keyboard events, returns false when the game must end. */
+    void runSingleThread(); /* Simulate and render on the calling thread. */
+    void runRenderThread(); /* Render on the calling thread while simulationLoop() runs on its own. */
+    void simulationLoop(); /* Simulate the ticks as they are due and publish a snapshot after each batch. */
+    std::uint8_t sampleInput(const Uint8* currentKeyState); /* Convert the keyboard state to PongInput bits. */
+    std::uint8_t applyKeyEvents(Uint64 until); /* Apply the key events older than until, returns the keyboard input. */
+    void countAllocations(); /* Close the allocation count of the previous frame and start the one of the current frame. */
+    void waitForFrameStart(); /* Sleep until the latest time the next frame can start and still be ready for the vblank. */
+    std::uint8_t applyController(Controller* controller, bool rightSide, std::uint8_t inputs); /* Replace the keyboard input of a pad driven by a controller. */
+    void update(std::uint8_t inputs); /* Advance the simulation by one tick. */
+    void drawNumber(std::uint32_t value, int x, int y, int height, bool alignRight); /* Queue the digit glyphs of a number, from or up to x. */
+    void drawStaticLayer(const PongState& state); /* Queue the table, the separator and the scores. */
+    void render(const PongState& previous, const PongState& current, float alpha); /* Render the game, interpolating between two ticks. */
+    void present(); /* Show the rendered frame, only the dirty areas in dirty rectangle mode. */
+    SDL_Rect profilerArea() const; /* Part of the window covered by the profiler overlay. */
+    void renderProfiler(); /* Draw the profiler overlay: time of every zone in the last frame, p50, p99 and max in microseconds. */
 };
\ No newline at end of file
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "PongState.h"
+#include "UdpSocket.h"
+
+/*
+    Authoritative server for many matches at once.
+    Rooms are sharded over worker threads. Each shard owns a UDP socket and ticks its rooms on a fixed schedule with
+    the same rules as the game, from the last input each player sent; the players only send inputs and draw the
+    states the server sends back. On Linux every shard binds the same port and the system spreads the clients among
+    them; elsewhere shard i listens on port + i.
+*/
+
+const std::uint32_t SERVER_MAGIC = 0x50535256; /* "PSRV" */
+const std::uint32_t SERVER_NO_ROOM = 0xFFFFFFFF;
+
+enum ServerPacketType : std::uint8_t
+{
+    SERVER_JOIN, /* Client: looking for a match, repeated until SERVER_WELCOME. */
+    SERVER_INPUT, /* Client: input of its side, applied until the next one. */
+    SERVER_LEAVE, /* Client: leaving the match. */
+    SERVER_WELCOME, /* Server: the client plays in a room. */
+    SERVER_STATE, /* Server: state of the room. */
+    SERVER_END /* Server: the match is over, final state. */
+};
+
+/* The one packet of the protocol, in both directions. */
+struct ServerPacket
+{
+    std::uint32_t magic;
+    std::uint8_t type; /* ServerPacketType. */
+    std::uint8_t rightSide; /* WELCOME, STATE, END: side of the receiver. */
+    std::uint8_t input; /* INPUT: PongInput bits of the sender's side. */
+    std::uint8_t reserved;
+    std::uint32_t room; /* Room of the receiver or the sender, SERVER_NO_ROOM if none. */
+    std::uint32_t sequence; /* INPUT: number of the input. STATE, END: number of the last input of the receiver applied. */
+    std::uint32_t tick; /* STATE, END: tick of the room. */
+    PongState state; /* STATE, END. */
+};
+
+struct ServerSettings
+{
+    std::uint16_t port = 27015; /* UDP port of the first shard. */
+    unsigned int shards = 0; /* Worker threads, 0 -> one per hardware thread. */
+    unsigned int tickRate = 240; /* Room ticks per second, as in the game. */
+    unsigned int snapshotInterval = 4; /* Ticks between two states sent to the players. */
+    int goalsToWin = 10; /* Goals that end a match, 0 -> endless. */
+    unsigned int timeout = 5000; /* Milliseconds without a packet after which a player is dropped. */
+    std::size_t maxRooms = 1 << 16; /* Rooms of a shard, the next players wait. */
+};
+
+/* Counters of the server between two calls to collectMetrics(). */
+struct ServerMetrics
+{
+    static const int TICK_BUCKETS = 10000; /* Tick durations are counted per microsecond up to this, longer ones in the last bucket. */
+
+    double seconds = 0.0; /* Wall time covered, per shard: the sum over all shards. */
+    double busySeconds = 0.0; /* Time spent ticking rooms and handling packets, over all shards. */
+    double tickSeconds = 0.0; /* Time spent ticking rooms only. */
+    std::uint64_t ticks = 0; /* Shard ticks. */
+    std::uint64_t lateTicks = 0; /* Ticks dropped because a shard fell more than MAX_CATCHUP_TICKS behind. */
+    std::uint64_t roomTicks = 0; /* Room ticks simulated. */
+    std::uint64_t packetsIn = 0;
+    std::uint64_t packetsOut = 0;
+    std::uint64_t matchesStarted = 0;
+    std::uint64_t matchesFinished = 0;
+    std::uint64_t rooms = 0; /* Rooms now, not reset. */
+    std::uint64_t waitingPlayers = 0; /* Players waiting for an opponent now, not reset. */
+    std::uint64_t maxTickTime = 0; /* Longest shard tick, in microseconds. */
+    std::vector<std::uint32_t> tickTimes; /* Shard ticks per duration, in microseconds. */
+
+    void reset(); /* Zero the counters, keep the current rooms and waiting players. */
+    void merge(const ServerMetrics& other); /* Add the counters of another shard or interval. */
+    double tickPercentile(double percentile) const; /* Shard tick duration in microseconds, 0 if there is no tick. */
+    double roomsPerCore(double tickRate) const; /* Rooms a fully busy core could carry at the current cost per room, 0 if unknown. */
+};
+
+/* One worker thread of the server and its rooms. */
+class ServerShard
+{
+public:
+    static const int MAX_CATCHUP_TICKS = 8; /* Ticks simulated at once after a stall, older ones are dropped. */
+
+    ServerShard(const ServerSettings& settings, const PongConfig& config, unsigned int index);
+    ~ServerShard();
+
+    ServerShard(const ServerShard&) = delete;
+    ServerShard& operator=(const ServerShard&) = delete;
+
+    bool open(std::uint16_t port, bool sharedPort);
+    void start();
+    void stop(); /* Returns once the thread is done. */
+    void collectMetrics(ServerMetrics& metrics); /* Add the metrics since the last call and reset them. */
+    std::uint16_t port() const;
+
+private:
+    struct Room
+    {
+        UdpAddress players[2]; /* Left then right. */
+        std::uint8_t inputs[2]; /* Last input of each side. */
+        std::uint32_t sequences[2]; /* Number of the last input of each side, older ones arriving late are ignored. */
+        std::uint32_t lastSeen[2]; /* Tick of the room at the last packet of each side. */
+        std::uint32_t tick;
+        PongState state;
+        bool active;
+    };
+
+    ServerSettings _settings;
+    PongConfig _config;
+    unsigned int _index;
+    UdpSocket _socket;
+    std::thread _thread;
+    std::atomic<bool> _running;
+
+    std::vector<Room> _rooms;
+    std::vector<std::uint32_t> _freeRooms;
+    std::unordered_map<std::uint64_t, std::uint32_t> _players; /* Room of every player, by address. */
+    bool _hasWaiting; /* A player waits for an opponent. */
+    UdpAddress _waiting;
+    std::uint64_t _timeoutTicks;
+
+    std::uint64_t _tick; /* Ticks of the shard. */
+    std::uint64_t _waitingTick; /* Shard tick of the last SERVER_JOIN of the waiting player. */
+    std::size_t _roomCount;
+
+    std::mutex _metricsMutex;
+    ServerMetrics _metrics; /* Shared with collectMetrics(), updated once per tick. */
+    ServerMetrics _pending; /* Counters since the last tick, without the tick histogram: owned by the thread. */
+    std::chrono::steady_clock::time_point _metricsStart;
+
+#if defined(__linux__)
+    int _epoll; /* Waits for the socket, with the time to the next tick as timeout. */
+#endif
+
+    void run();
+    void wait(int milliseconds); /* Until a datagram arrives or the time elapses. */
+    void receive();
+    void handle(const UdpAddress& from, const ServerPacket& packet);
+    void join(const UdpAddress& player);
+    void tick();
+    void endRoom(std::uint32_t index);
+    void send(const UdpAddress& to, ServerPacketType type, std::uint32_t index, bool rightSide);
+};
+
+/* Every shard of the server. */
+class GameServer
+{
+public:
+    explicit GameServer(const ServerSettings& settings = ServerSettings());
+    ~GameServer();
+
+    bool start(); /* Open the sockets and start the shards. */
+    void stop();
+    unsigned int shardCount() const;
+    std::uint16_t shardPort(unsigned int shard) const;
+    ServerMetrics collectMetrics(); /* Metrics of every shard since the last call. */
+
+private:
+    ServerSettings _settings;
+    std::vector<std::unique_ptr<ServerShard>> _shards;
+};
@@ -13,8 +13,8 @@ public:
 
     void freeTexture();
 
-    bool loadFromFile(SDL_Renderer* renderer, std::string path);
-    bool loadFromRenderedText(SDL_Renderer* renderer, std::string textureText, SDL_Color textColour, TTF_Font* font);
+    bool loadFromFile(SDL_Renderer* renderer, const std::string& path);
+    bool loadFromRenderedText(SDL_Renderer* renderer, const std::string& textureText, SDL_Color textColour, TTF_Font* font);
 
     void render(SDL_Renderer* renderer, 
                 int x, 
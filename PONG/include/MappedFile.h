@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/* Read-only memory mapping of a whole file. */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path); /* Map the file, closing the previous one. */
+    void close();
+
+    const unsigned char* data() const;
+    std::size_t size() const;
+
+private:
+    const unsigned char* _data;
+    std::size_t _size;
+#if defined(_WIN32)
+    void* _file; /* HANDLE of the file. */
+    void* _mapping; /* HANDLE of the file mapping. */
+#else
+    int _file; /* File descriptor. */
+#endif
+};
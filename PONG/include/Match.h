@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Controller.h"
+#include "PongState.h"
+
+/* Outcome and statistics of a headless match. */
+struct MatchResult
+{
+    int leftScore;
+    int rightScore;
+    std::uint64_t ticks; /* Simulated ticks. */
+    std::uint32_t rallies; /* Number of served balls that ended in a goal. */
+    std::uint64_t rallyHits; /* Pad hits over all the rallies. */
+    std::uint32_t longestRally; /* Maximum number of pad hits in a single rally. */
+};
+
+/*
+    Play a match between two controllers until one of them reaches goalsToWin, or maxTicks have been simulated.
+    The controllers are reset with the given seed before the match starts.
+*/
+MatchResult playMatch(const PongConfig& config, Controller& left, Controller& right, int goalsToWin, std::uint64_t maxTicks, std::uint32_t seed);
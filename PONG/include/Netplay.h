@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PongState.h"
+#include "UdpSocket.h"
+
+/*
+    Matches between two machines over UDP, with rollback.
+    Both sides simulate the whole match. The remote pad is predicted to keep its last known direction; when its real
+    input arrives and differs, the match is rewound to the state saved before that tick and simulated again up to
+    the current tick, within the same frame. Every packet repeats the local inputs the peer has not acknowledged,
+    so a lost packet only makes the next rollback a little longer.
+*/
+
+const std::uint32_t NETPLAY_MAGIC = 0x504E4F50; /* "PONP" */
+const std::uint16_t NETPLAY_VERSION = 1;
+const std::uint32_t NETPLAY_HISTORY = 256; /* Ticks of states and inputs kept, a power of two. */
+const int NETPLAY_PACKET_INPUTS = 64; /* Most inputs repeated in a packet. */
+const std::uint32_t NETPLAY_SYNC_INTERVAL = 100; /* Milliseconds between two packets while waiting for the peer. */
+const std::uint32_t NETPLAY_TIMEOUT = 5000; /* Milliseconds without a packet after which the peer is considered gone. */
+
+enum NetplayPacketType : std::uint8_t
+{
+    NETPLAY_SYNC, /* Looking for the peer, no inputs yet. */
+    NETPLAY_INPUTS
+};
+
+/* Latency and loss added to the outgoing packets, to try the rollback on a single machine. */
+struct LinkSettings
+{
+    std::uint32_t latency = 0; /* Milliseconds added to every packet. */
+    std::uint32_t jitter = 0; /* Up to this many more milliseconds at random, packets can arrive out of order. */
+    int lossPercent = 0; /* Share of the packets dropped. */
+    std::uint32_t seed = 1;
+};
+
+struct NetplaySettings
+{
+    int inputDelay = 2; /* Ticks between a local input and the tick it applies to, hides part of the latency. */
+    int maxRollback = 48; /* Most ticks simulated again after a late input, the session waits for the peer beyond. */
+    LinkSettings link;
+};
+
+/* Packet of the protocol. Only the used part of the inputs is sent. */
+struct NetplayPacket
+{
+    std::uint32_t magic;
+    std::uint16_t version;
+    std::uint8_t type; /* NetplayPacketType. */
+    std::uint8_t inputCount;
+    std::uint32_t configHash; /* The two sides must simulate the same table. */
+    std::uint32_t tick; /* Next tick the sender simulates. */
+    std::uint32_t firstTick; /* Tick of inputs[0]. */
+    std::uint32_t ackTick; /* Number of inputs of the receiver the sender has. */
+    std::uint32_t sendTime; /* Clock of the sender, in milliseconds. */
+    std::uint32_t echoTime; /* sendTime of the last packet the sender received. */
+    std::uint32_t echoDelay; /* Milliseconds between receiving that packet and sending this one. */
+    std::uint32_t checkTick; /* Tick before which every input is known to the sender. */
+    std::uint64_t checkHash; /* hashState() of the state before checkTick, to detect a desync. */
+    std::uint8_t inputs[NETPLAY_PACKET_INPUTS]; /* Pad bits and INPUT_SERVE of the sender's side. */
+};
+
+/* Holds the outgoing packets for the simulated latency, and drops some of them. */
+class LinkSimulator
+{
+public:
+    static const std::size_t CAPACITY = 1024; /* Packets in flight, the next ones are dropped. */
+
+    explicit LinkSimulator(const LinkSettings& settings);
+
+    void send(UdpSocket& socket, const UdpAddress& to, const void* data, std::size_t size, std::uint32_t now);
+    void flush(UdpSocket& socket, std::uint32_t now); /* Send the held packets that are due. */
+
+private:
+    struct HeldPacket
+    {
+        std::uint32_t time; /* When it is due. */
+        UdpAddress to;
+        std::size_t size;
+        std::uint8_t data[sizeof(NetplayPacket)];
+    };
+
+    LinkSettings _settings;
+    std::uint32_t _random; /* Xorshift state. */
+    std::vector<HeldPacket> _packets;
+
+    std::uint32_t nextRandom();
+};
+
+/* One side of a remote match. The host plays the left pad, the client the right one. */
+class RollbackSession
+{
+public:
+    explicit RollbackSession(const NetplaySettings& settings = NetplaySettings());
+
+    bool host(std::uint16_t port); /* Wait for a client on a UDP port, 0 -> any free port. */
+    bool connect(const std::string& address); /* Join a host at "host:port". */
+    std::uint16_t localPort() const;
+    void start(const PongConfig& config, const PongState& state, std::uint32_t tickRate); /* Both sides must start from the same state. */
+
+    /*
+        Send the local input and simulate the next tick, after simulating again the ticks a late remote input proved
+        wrong. False while the peer is not there, or when this side is too far ahead of it: the tick must wait.
+    */
+    bool advance(std::uint8_t localInputs);
+    bool popConfirmed(PongState& state, std::uint8_t& inputs); /* Oldest tick not popped yet whose two inputs are known: state before it and inputs of both pads. */
+    const PongState& confirmedState() const; /* State after the ticks popped so far. */
+
+    bool isRightSide() const;
+    bool isConnected() const; /* A packet of the peer arrived, and not too long ago. */
+    std::uint32_t tick() const; /* Next tick to simulate. */
+    const PongState& state() const; /* State before tick(). */
+
+    std::uint64_t getRollbacks() const;
+    std::uint64_t getRollbackTicks() const; /* Ticks simulated again, over all the rollbacks. */
+    std::uint32_t getMaxRollback() const; /* Longest rollback, in ticks. */
+    std::uint64_t getWaitedTicks() const; /* Ticks not simulated to wait for the peer. */
+    std::uint32_t getRoundTrip() const; /* Smoothed round trip time, in milliseconds. */
+    std::uint64_t getDesyncs() const; /* Checks in which the peer had a different state. */
+
+private:
+    static const std::uint32_t MASK = NETPLAY_HISTORY - 1;
+
+    NetplaySettings _settings;
+    UdpSocket _socket;
+    LinkSimulator _link;
+    UdpAddress _peer;
+    bool _hasPeer; /* The client knows the host, the host learns the client from its first packet. */
+    bool _rightSide;
+    PongConfig _config;
+    std::uint32_t _configHash;
+    std::uint32_t _tickRate;
+
+    /* Ticks. Every input before _remoteCount is known, the remote inputs after it are predictions. */
+    std::uint32_t _tick;
+    std::uint32_t _localCount; /* Ticks with a local input, inputDelay ahead of _tick. */
+    std::uint32_t _remoteCount;
+    std::uint32_t _peerAck; /* Local inputs the peer has acknowledged. */
+    bool _mispredicted; /* A tick was simulated with a wrong remote input. */
+    std::uint32_t _rollbackTick; /* The oldest such tick. */
+    std::uint32_t _popped; /* Ticks returned by popConfirmed(). */
+
+    PongState _states[NETPLAY_HISTORY]; /* State before every tick. */
+    std::uint8_t _localInputs[NETPLAY_HISTORY];
+    std::uint8_t _remoteInputs[NETPLAY_HISTORY]; /* Known, or predicted when the tick was simulated before it was. */
+
+    /* Connection and time synchronization, clocks in milliseconds. */
+    bool _connected;
+    std::uint32_t _lastReceive; /* Time of the last packet of the peer. */
+    std::uint32_t _lastSend;
+    std::uint32_t _echoTime; /* sendTime of the last packet of the peer. */
+    std::uint32_t _remoteTick; /* Tick of the peer when it sent that packet. */
+    std::uint32_t _roundTrip;
+    std::uint32_t _lastSyncWait; /* Tick at which this side last waited to let the peer catch up. */
+
+    /* Desync check: the last state hash sent by the peer, compared once the tick is final here too. */
+    bool _checkPending;
+    std::uint32_t _checkTick;
+    std::uint64_t _checkHash;
+
+    /* Statistics. */
+    std::uint64_t _rollbacks;
+    std::uint64_t _rollbackTicks;
+    std::uint32_t _maxRollback;
+    std::uint64_t _waitedTicks;
+    std::uint64_t _desyncs;
+
+    void reset();
+    void poll(std::uint32_t now); /* Read every waiting packet of the peer. */
+    void receive(const NetplayPacket& packet, std::size_t size, std::uint32_t now);
+    void sendPacket(NetplayPacketType type, std::uint32_t now);
+    void simulate(std::uint32_t tick); /* Simulate a tick from its saved state, predicting the remote input if it is not known. */
+    void checkDesync();
+    bool aheadOfPeer(std::uint32_t now) const; /* This side runs ahead of the peer's clock and should let it catch up. */
+};
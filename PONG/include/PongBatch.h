@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PongState.h"
+
+/*
+    Many independent matches sharing the same PongConfig, stored as structure of arrays.
+    All matches are advanced together by a vectorized kernel (AVX2 or SSE2, depending on the
+    instruction set the file is compiled for) that reproduces step() bit for bit without branches.
+    Matches that do not fill a whole vector, and builds without SIMD support, fall back to step().
+*/
+class PongBatch
+{
+public:
+    PongBatch(const PongConfig& config, std::size_t size);
+
+    static const char* kernelName(); /* Name of the kernel selected at compile time. */
+
+    std::size_t size() const;
+    const PongConfig& config() const;
+
+    void reset(); /* Start a new match in every slot. */
+    void setState(std::size_t index, const PongState& state);
+    PongState getState(std::size_t index) const;
+
+    /*
+        Advance every match by one tick.
+        inputs holds one PongInput byte per match; if events is not null, it receives the PongEvent bits of each match.
+    */
+    void step(const std::uint8_t* inputs, std::uint8_t* events = nullptr);
+
+    /*
+        Advance the matches [begin, end) only, inputs and events are still indexed from the first match.
+        Disjoint ranges touch disjoint entries of the arrays, so different threads can advance them at the same time.
+    */
+    void step(std::size_t begin, std::size_t end, const std::uint8_t* inputs, std::uint8_t* events = nullptr);
+
+    /* Read-only access to the arrays, size() entries each. */
+    const std::int32_t* leftPlayerY() const;
+    const std::int32_t* rightPlayerY() const;
+    const std::int32_t* ballX() const;
+    const std::int32_t* ballY() const;
+    const std::int32_t* ballSpeedX() const;
+    const std::int32_t* ballSpeedY() const;
+    const std::int32_t* leftScore() const;
+    const std::int32_t* rightScore() const;
+
+private:
+    PongConfig _config;
+    std::size_t _size;
+
+    std::vector<std::int32_t> _leftPlayerY;
+    std::vector<std::int32_t> _rightPlayerY;
+    std::vector<std::int32_t> _ballX;
+    std::vector<std::int32_t> _ballY;
+    std::vector<std::int32_t> _ballSpeedX;
+    std::vector<std::int32_t> _ballSpeedY;
+    std::vector<std::int32_t> _leftScore;
+    std::vector<std::int32_t> _rightScore;
+    std::vector<std::int32_t> _lock; /* 0 -> false, all bits set -> true, so that it can be used as a vector mask. */
+    std::vector<std::int32_t> _lockSide; /* Same encoding as _lock. */
+
+    void stepScalar(std::size_t begin, std::size_t end, const std::uint8_t* inputs, std::uint8_t* events);
+};
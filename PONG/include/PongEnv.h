@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Controller.h"
+#include "PongBatch.h"
+#include "PongState.h"
+
+/* Floats of the observation of one environment, see PongEnv::observe. */
+const std::size_t PONG_ENV_OBSERVATION_SIZE = 8;
+
+/* Action of the agent for one step. */
+enum PongEnvAction : std::int32_t
+{
+    ENV_ACTION_STAY = 0,
+    ENV_ACTION_UP = 1,
+    ENV_ACTION_DOWN = 2
+};
+
+struct PongEnvSettings
+{
+    std::string opponent = "ai-hard"; /* Controller of the right pad. */
+    int goalsToWin = 10; /* Goals that end an episode. */
+    std::uint32_t ticksPerStep = 4; /* Simulation ticks an action is repeated for. */
+    std::uint32_t maxSteps = 0; /* Steps after which an episode is cut, 0 -> no limit. */
+    std::uint32_t seed = 1; /* Seed of the opponents, every episode of every environment gets its own. */
+};
+
+/*
+    Reinforcement learning environment over many independent matches, advanced together by a PongBatch.
+    The agent plays the left pad and serves as soon as it holds the ball, a controller plays the right pad.
+    Every buffer is provided by the caller and indexed from the first environment; the calls only touch the entries
+    of their range [first, first + count), so disjoint ranges can be reset, stepped and observed by different
+    threads at the same time. Nothing is allocated after create().
+*/
+class PongEnv
+{
+public:
+    explicit PongEnv(const PongEnvSettings& settings = PongEnvSettings());
+
+    bool create(std::size_t count); /* Allocate count environments and start their first episode. False if the opponent is unknown. */
+    std::size_t size() const;
+    const PongEnvSettings& settings() const;
+
+    void reset(std::size_t first, std::size_t count, float* observations); /* Start a new episode, observations may be null. */
+
+    /*
+        Apply one action per environment for ticksPerStep ticks.
+        rewards receive the goals of the agent minus those of the opponent, dones 1 when the episode ended. An ended
+        episode is replaced by a new one right away: the next observation is the first of the new episode.
+    */
+    void step(std::size_t first, std::size_t count, const std::int32_t* actions, float* rewards, std::uint8_t* dones);
+
+    /*
+        Write PONG_ENV_OBSERVATION_SIZE floats per environment: ball x and y, ball speed x and y, left pad y and speed,
+        right pad y and speed. Positions are fractions of the table size, speeds fractions of the table size per second.
+    */
+    void observe(std::size_t first, std::size_t count, float* observations) const;
+
+    std::uint64_t getEpisodes() const; /* Episodes ended or reset so far, while no range is being stepped. */
+
+private:
+    PongEnvSettings _settings;
+    PongConfig _config;
+    float _tickRate;
+    std::unique_ptr<PongBatch> _batch;
+    std::vector<std::unique_ptr<Controller>> _opponents;
+    std::vector<std::uint8_t> _inputs; /* Of the current tick, per environment. */
+    std::vector<std::uint8_t> _events;
+    std::vector<std::int32_t> _lastLeftY; /* Pad positions before the last step, for their speed. */
+    std::vector<std::int32_t> _lastRightY;
+    std::vector<std::uint32_t> _steps; /* Steps of the current episode. */
+    std::vector<std::uint32_t> _episodes; /* Episodes started, to seed the opponent. */
+
+    void startEpisode(std::size_t index);
+};
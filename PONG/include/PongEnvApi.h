@@ -0,0 +1,61 @@
+#pragma once
+
+/*
+    C interface of the PongEnv library, for training agents from any language that can load a shared library.
+    Buffers belong to the caller and hold one entry per environment, PONG_ENV_OBSERVATION_FLOATS floats per
+    observation. Calls on disjoint ranges of the same environments may run on different threads at the same time.
+*/
+
+#if defined(_WIN32)
+#if defined(PONG_ENV_EXPORTS)
+#define PONG_ENV_API __declspec(dllexport)
+#else
+#define PONG_ENV_API __declspec(dllimport)
+#endif
+#else
+#define PONG_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PONG_ENV_OBSERVATION_FLOATS 8 /* Ball x, y, speed x, speed y, left pad y, speed, right pad y, speed. */
+
+/* Actions of the agent, which plays the left pad. */
+#define PONG_ENV_STAY 0
+#define PONG_ENV_UP 1
+#define PONG_ENV_DOWN 2
+
+typedef struct PongEnvHandle PongEnvHandle;
+
+typedef struct PongEnvOptions
+{
+    const char* opponent; /* Controller of the right pad: idle, random, follow, ai-easy, ai-medium, ai-hard, ai-perfect or search. */
+    int goalsToWin; /* Goals that end an episode. */
+    unsigned int ticksPerStep; /* Ticks of 1/240 s an action is repeated for. */
+    unsigned int maxSteps; /* Steps after which an episode is cut, 0 -> no limit. */
+    unsigned int seed;
+} PongEnvOptions;
+
+PONG_ENV_API PongEnvOptions pongEnvDefaultOptions(void);
+
+/* Create count environments with their first episode started, null if the options are invalid. */
+PONG_ENV_API PongEnvHandle* pongEnvCreate(unsigned int count, const PongEnvOptions* options);
+PONG_ENV_API void pongEnvDestroy(PongEnvHandle* env);
+PONG_ENV_API unsigned int pongEnvSize(const PongEnvHandle* env);
+
+/*
+    The range variants only touch the environments [first, first + count), the buffers are still indexed from the
+    first environment. Returns 0 if the range does not fit.
+*/
+PONG_ENV_API int pongEnvReset(PongEnvHandle* env, unsigned int first, unsigned int count, float* observations);
+PONG_ENV_API int pongEnvStep(PongEnvHandle* env, unsigned int first, unsigned int count, const int* actions, float* rewards, unsigned char* dones);
+PONG_ENV_API int pongEnvObserve(const PongEnvHandle* env, unsigned int first, unsigned int count, float* observations);
+
+/* Step every environment and observe them, the usual call of a training loop. */
+PONG_ENV_API int pongEnvStepAll(PongEnvHandle* env, const int* actions, float* observations, float* rewards, unsigned char* dones);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+/*
+    Playere movement status for the current frame.
+    -1 -> player moved up, 0 -> player didn't move, 1 -> player moved down.
+*/
+enum class PlayerMoved
+{
+    UP = -1,
+    NA,
+    DOWN
+};
+
+/* Input bits sampled for a single simulation tick. */
+enum PongInput : std::uint8_t
+{
+    INPUT_NONE = 0,
+    INPUT_LEFT_UP = 1 << 0, /* W */
+    INPUT_LEFT_DOWN = 1 << 1, /* S */
+    INPUT_RIGHT_UP = 1 << 2, /* UP */
+    INPUT_RIGHT_DOWN = 1 << 3, /* DOWN */
+    INPUT_SERVE = 1 << 4 /* RETURN */
+};
+
+/* Events raised by a simulation tick. */
+enum PongEvent : std::uint8_t
+{
+    EVENT_NONE = 0,
+    EVENT_SERVE = 1 << 0, /* The ball left the pad it was locked to. */
+    EVENT_WALL_BOUNCE = 1 << 1, /* The ball bounced on the upper or lower border. */
+    EVENT_PAD_HIT = 1 << 2, /* The ball bounced on a player pad. */
+    EVENT_LEFT_SCORED = 1 << 3, /* The ball crossed the right goal. */
+    EVENT_RIGHT_SCORED = 1 << 4 /* The ball crossed the left goal. */
+};
+
+/* Fixed-point units, so that a match gives the same result on any machine and for any window size. */
+const std::int32_t TABLE_HEIGHT = 1 << 20; /* Height of the table in table units. The width follows the aspect ratio of the table texture. */
+const std::int32_t TICK_TIME = 1 << 16; /* Length of a tick in time units, used for the time of impact of collisions. */
+
+/*
+    Table geometry and speeds of a match.
+    Positions are in table units, speeds in table units per tick.
+*/
+struct PongConfig
+{
+    std::int32_t tableWidth; /* Width of the table. */
+    std::int32_t tableHeight; /* Height of the table. */
+    std::int32_t playerUpperLimit; /* Minimum y coordinate of the player. */
+    std::int32_t playerLowerLimit; /* Maximum y coordinate of the player. */
+    std::int32_t ballLowerLimit; /* Lower border for the ball. */
+    std::int32_t leftPlayerX; /* X coordinate of the left pad. */
+    std::int32_t rightPlayerX; /* X coordinate of the right pad. */
+    std::int32_t playerWidth; /* Width of a pad. */
+    std::int32_t playerHeight; /* Height of a pad. */
+    std::int32_t playerLockY; /* Pad reset y coordinate. */
+    std::int32_t ballWidth; /* Width of the ball. */
+    std::int32_t ballHeight; /* Height of the ball. */
+    std::int32_t leftBallLockX; /* Ball left reset x coordinate. */
+    std::int32_t rightBallLockX; /* Ball right reset x coordinate. */
+    std::int32_t ballLockY; /* Ball reset y coordinate. */
+    std::int32_t leftGoal; /* Left goal x coordinate. */
+    std::int32_t rightGoal; /* Right goal x coordinate. */
+    std::int32_t playerSpeed; /* Player speed. */
+    std::int32_t ballDefaultSpeed; /* Default horizontal speed of the ball. */
+};
+
+/*
+    Texture sizes from which a PongConfig is derived.
+    The geometry is taken from the table art, so it does not depend on the window. Defaults match the shipped textures.
+*/
+struct PongLayout
+{
+    /* Table art constants, in pixels of the table texture. */
+    static const int BORDER_OFFSET = 45; /* Offset of the table border from the left margin. */
+    static const int BORDER_WIDTH = 15; /* Width of the border line. */
+    static const int GOAL_WIDTH = 15; /* Width of the goal line. */
+    static const int GOAL_OFFSET = 404; /* Offset of the goal line from the table border. */
+    static const int PAD_BORDER = 10; /* Shadow border of the player pad. */
+    static const int BALL_MARGIN = 8; /* Margin from the surface of the ball. */
+
+    static const int PLAYER_SPEED = 1111; /* Thousandths of the table height covered in one second by the player. */
+    static const int BALL_SPEED = 500; /* Thousandths of the table width covered in one second by the ball. */
+
+    int tableWidth = 3840; /* Size of the table texture. */
+    int tableHeight = 2160;
+    int padWidth = 50; /* Size of the pad texture. */
+    int padHeight = 300;
+    int ballWidth = 70; /* Size of the ball texture. */
+    int ballHeight = 70;
+    unsigned int tickRate = 240; /* Number of simulation ticks per second. */
+};
+
+/*
+    Complete state of a match.
+    Plain data without any SDL dependency: copy it to clone a match.
+*/
+struct PongState
+{
+    std::int32_t leftPlayerY; /* Y coordinate of the left pad. */
+    std::int32_t rightPlayerY; /* Y coordinate of the right pad. */
+    std::int32_t ballX; /* Ball x coordinate. */
+    std::int32_t ballY; /* Ball y coordinate. */
+    std::int32_t ballSpeedX; /* Ball speed on x axis. */
+    std::int32_t ballSpeedY; /* Ball speed on y axis. */
+    std::int32_t leftScore; /* Score for the left player. */
+    std::int32_t rightScore; /* Score for the right player. */
+    bool lock; /* Is the ball locked to a player? */
+    bool lockSide; /* False -> ball to the left, True -> ball to the right. */
+};
+
+/* Searches clone the state at every node: keep it within a cache line and copyable with memcpy. */
+static_assert(sizeof(PongState) <= 64, "PongState must fit in a cache line");
+static_assert(std::is_trivially_copyable<PongState>::value, "PongState must stay plain data");
+
+const int MAX_COLLISIONS = 8; /* Maximum number of collisions resolved in a single tick. */
+const std::int32_t NO_IMPACT = 2 * TICK_TIME; /* Time of impact of a collision that does not happen in this tick. Times are clamped to [-NO_IMPACT, NO_IMPACT]. */
+
+PongConfig makeConfig(const PongLayout& layout); /* Compute the table geometry for the given layout. */
+void resetMatch(PongState& state, const PongConfig& config); /* Start a new match with the ball locked to the left player. */
+std::uint8_t step(PongState& state, const PongConfig& config, std::uint8_t inputs); /* Advance a match by one tick, returns the raised PongEvent bits. */
+std::uint8_t combineInputs(const PongState& state, std::uint8_t left, std::uint8_t right); /* Inputs of a tick from the inputs of each side: every pad moves with its own side's bits, the ball is served by the side that holds it. */
+std::uint64_t hashState(const PongState& state); /* Hash of every field of the state, to find the first tick at which two runs diverge. */
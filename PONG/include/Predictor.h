@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+#include "PongState.h"
+
+/*
+    Closed-form prediction of the ball trajectory.
+    The vertical motion is unfolded in time and folded back between the upper and lower borders,
+    so the cost does not depend on how far away the ball is or on how many bounces happen.
+*/
+
+std::int32_t leftPlayerImpactX(const PongConfig& config); /* Ball x at which the left pad is hit. */
+std::int32_t rightPlayerImpactX(const PongConfig& config); /* Ball x at which the right pad is hit. */
+
+/* Fold an unbounded ball y coordinate back between the borders, applying the wall reflections. */
+std::int32_t foldBallY(const PongConfig& config, std::int64_t y);
+
+/*
+    Horizontal distance the ball covers before reaching the given side, assuming it keeps its horizontal speed.
+    If the ball is moving away, it includes the way to the opposite pad and back. Negative if the ball is not moving.
+*/
+std::int64_t distanceToSide(const PongState& state, const PongConfig& config, bool rightSide);
+
+/* Whole ticks before the ball reaches the given side. Negative if the ball is not moving. */
+std::int32_t ticksToSide(const PongState& state, const PongConfig& config, bool rightSide);
+
+/* Ball y coordinate when it reaches the pad of the given side. Returns the current y if the ball is not moving. */
+std::int32_t predictBallY(const PongState& state, const PongConfig& config, bool rightSide);
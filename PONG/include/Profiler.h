@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <SDL.h>
+
+/* Phases of a frame measured by the profiler. */
+enum ProfilerZone
+{
+    ZONE_INPUT, /* Event polling and keyboard sampling. */
+    ZONE_PHYSICS, /* Simulation ticks. */
+    ZONE_RENDER, /* Building the frame. */
+    ZONE_PRESENT, /* SDL_RenderPresent, including the wait for vsync. */
+    ZONE_FRAME, /* The whole frame. */
+    ZONE_COUNT
+};
+
+/*
+    Frame profiler on the high resolution performance counter.
+    Every zone keeps a histogram of its time per frame for the percentiles, and the last HISTORY frames are kept
+    to be exported, so that a spike can be found in a CSV file after the game ends.
+    A separate histogram holds the input latency: time from a key event to the present of the first frame showing it.
+    The load time of every asset is kept too, to see which one slows the startup down.
+*/
+class Profiler
+{
+public:
+    static const int BUCKET_MICROSECONDS = 10; /* Resolution of the histograms. */
+    static const int BUCKET_COUNT = 10000; /* Histogram range: 100 ms, longer frames go in the last bucket. */
+    static const int HISTORY = 16384; /* Frames kept for the export. */
+
+    Profiler();
+
+    static const char* zoneName(int zone);
+
+    void beginFrame();
+    void endFrame(); /* Commit the times of the zones measured since beginFrame(). */
+    void add(int zone, Uint64 counterTicks); /* Add time to a zone of the current frame. */
+
+    std::uint64_t getFrameCount() const;
+    double getLast(int zone) const; /* Time of the zone in the last frame, in microseconds. */
+    double getPercentile(int zone, double percentile) const; /* Percentile in [0, 100] over all the frames, in microseconds. */
+    double getMaximum(int zone) const; /* In microseconds. */
+
+    void addLatency(Uint64 counterTicks); /* Add an input to present latency. */
+    std::uint64_t getLatencyCount() const;
+    double getLatencyPercentile(double percentile) const; /* In microseconds. */
+    double getLatencyMaximum() const; /* In microseconds. */
+
+    void setLoadTime(const std::string& asset, Uint64 counterTicks); /* Time to load an asset, replaces the previous one of the same name. */
+    std::size_t getLoadCount() const;
+    const std::string& getLoadName(std::size_t index) const;
+    double getLoadTime(std::size_t index) const; /* In microseconds. */
+
+    bool writeCsv(const std::string& path) const; /* Percentiles of every zone, of the input latency if any was measured, and the asset load times. */
+    bool writeFramesCsv(const std::string& path) const; /* Time of every zone in the last HISTORY frames. */
+
+private:
+    double _microsecondsPerTick;
+    Uint64 _frameStart;
+    Uint64 _current[ZONE_COUNT]; /* Counter ticks of the frame being measured. */
+    double _last[ZONE_COUNT];
+    double _maximum[ZONE_COUNT];
+    std::vector<std::uint32_t> _histograms; /* BUCKET_COUNT counts per zone. */
+    std::vector<float> _history; /* ZONE_COUNT times per frame, ring buffer of HISTORY frames. */
+    std::uint64_t _frameCount;
+    std::vector<std::uint32_t> _latencyHistogram; /* BUCKET_COUNT counts. */
+    std::uint64_t _latencyCount;
+    double _latencyMaximum;
+    std::vector<std::string> _loadNames;
+    std::vector<double> _loadTimes; /* Microseconds, in the order of _loadNames. */
+};
+
+/* Adds the time between its construction and its destruction to a zone. */
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler& profiler, int zone);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler& _profiler;
+    int _zone;
+    Uint64 _start;
+};
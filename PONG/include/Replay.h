@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "PongState.h"
+
+/*
+    Replay files: the inputs of every tick of a match, with keyframes of the full state.
+
+    Layout (little endian, every section 8-byte aligned so it can be used in place from a mapping):
+    - ReplayHeader;
+    - keyframeCount ReplayKeyframe records, sorted by tick;
+    - the input stream: one run per change of input, as the changed bits followed by the run length in LEB128.
+*/
+
+const std::uint32_t REPLAY_MAGIC = 0x43455250; /* "PREC" */
+const std::uint32_t REPLAY_VERSION = 1;
+const std::uint32_t REPLAY_KEYFRAME_INTERVAL = 240; /* Default ticks between two keyframes. */
+const std::uint32_t REPLAY_RESERVED_SECONDS = 3600; /* Length of match recorded before the writer needs to allocate. */
+const std::size_t REPLAY_RESERVED_STREAM = 256 * 1024; /* Bytes of input runs reserved by the writer. */
+const std::uint64_t REPLAY_NO_MISMATCH = ~0ull; /* Mismatch tick of a replay that matches all its keyframes. */
+
+struct ReplayHeader
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t tickRate; /* Ticks per second of the recorded game. */
+    std::uint32_t keyframeInterval; /* Ticks between two keyframes. */
+    std::uint64_t tickCount; /* Recorded ticks. */
+    std::uint64_t keyframeCount;
+    std::uint64_t streamSize; /* Size in bytes of the input stream. */
+    PongConfig config; /* Geometry of the recorded match. */
+    std::uint32_t reserved;
+};
+
+/* State of the match before a tick, and position of that tick in the input stream. */
+struct ReplayKeyframe
+{
+    std::uint64_t tick;
+    std::uint64_t streamOffset; /* Offset of the run that contains the tick. */
+    std::uint32_t runSkip; /* Ticks of that run before the keyframe. */
+    std::uint32_t previousInput; /* Input of the run before that one, the run stores the changed bits. */
+    std::int32_t state[10]; /* PongState fields, see packState(). */
+    std::uint64_t hash; /* hashState() of the state. */
+};
+
+/* Records the inputs of a match, tick after tick. */
+class ReplayWriter
+{
+public:
+    ReplayWriter(const PongConfig& config, std::uint32_t tickRate, std::uint32_t keyframeInterval = REPLAY_KEYFRAME_INTERVAL);
+
+    void record(const PongState& state, std::uint8_t inputs); /* Record the inputs of the next tick, given the state before it. */
+    bool save(const std::string& path, const PongState& finalState) const; /* Write the replay file, with a last keyframe for the final state. */
+
+    std::uint64_t tickCount() const;
+
+private:
+    ReplayHeader _header;
+    std::vector<ReplayKeyframe> _keyframes;
+    std::vector<std::uint8_t> _stream; /* Closed runs. */
+    std::uint8_t _runInput; /* Input of the open run. */
+    std::uint8_t _runPreviousInput; /* Input of the run before the open one. */
+    std::uint32_t _runLength; /* Ticks in the open run, 0 before the first tick. */
+
+    void closeRun(std::vector<std::uint8_t>& stream) const; /* Append the open run to a stream. */
+};
+
+/* Memory-mapped replay file, decoded one tick at a time. */
+class Replay
+{
+public:
+    Replay();
+
+    bool open(const std::string& path); /* Map and validate a replay file. */
+
+    const PongConfig& config() const;
+    std::uint32_t tickRate() const;
+    std::uint64_t tickCount() const;
+    std::uint64_t tick() const; /* Next tick returned by next(). */
+
+    /*
+        Restore the state before the given tick and move the input cursor to it.
+        Starts from the closest keyframe, found by binary search, and simulates the remaining ticks.
+    */
+    bool seek(std::uint64_t tick, PongState& state);
+    bool next(std::uint8_t& inputs); /* Input of the next tick, false at the end of the replay. */
+
+    /* Check a state against the keyframe of the current tick, if there is one. False if they differ. */
+    bool verify(const PongState& state) const;
+
+private:
+    MappedFile _file;
+    ReplayHeader _header;
+    const ReplayKeyframe* _keyframes;
+    const std::uint8_t* _stream;
+
+    /* Input cursor. */
+    std::uint64_t _tick;
+    std::size_t _offset; /* Offset of the next run in the stream. */
+    std::uint8_t _input; /* Input of the current run. */
+    std::uint64_t _runLeft; /* Ticks left in the current run. */
+
+    bool readRun(); /* Decode the run at _offset. */
+};
+
+/* Outcome of a headless replay. */
+struct ReplayResult
+{
+    std::uint64_t ticks; /* Simulated ticks. */
+    std::uint64_t mismatchTick; /* First keyframe whose state differs from the simulation, REPLAY_NO_MISMATCH if none. */
+    PongState state; /* State at the end of the replay. */
+};
+
+/*
+    Simulate a replay from the given tick to its end as fast as possible, checking every keyframe on the way.
+    Returns false if the replay cannot be decoded.
+*/
+bool runReplay(Replay& replay, std::uint64_t startTick, ReplayResult& result);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Arena.h"
+#include "Controller.h"
+
+/* Knobs of the lookahead player. */
+struct SearchSettings
+{
+    int ticksPerMove = 4; /* Ticks a searched move is held for. */
+    int window = 64; /* Ticks before the ball reaches the pad from which the moves are searched, before that the pad goes to the predicted ball. */
+    int maxIterations = 4096; /* Rollouts of one search. */
+    std::uint32_t budgetMicroseconds = 0; /* Time cap of one search, 0 -> maxIterations only, which keeps the moves reproducible. */
+    float exploration = 1.4f; /* UCT exploration constant. */
+    std::int32_t opponentNoise = 1000; /* Largest aiming error of the modelled opponent, in thousandths of the pad height like AiDifficulty::noise. */
+    std::size_t arenaBytes = 1 << 20; /* Nodes of one search. */
+};
+
+/*
+    Computer player that searches its pad moves with Monte Carlo tree search when the ball comes to it.
+    Every node clones the state and advances it with step(), the opponent following the ball. A rollout ends when the
+    pad hits the ball or a goal is scored; a hit is worth the chance that an opponent aiming with an error up to
+    opponentNoise misses the return, so the search sends the ball out of reach or away from the borders, where such
+    an error cannot miss. Serves are chosen the same way. A perfect opponent never misses: against it every return
+    is worth the same.
+    Nodes live in an arena reset before every search: a search never allocates.
+    Without a time budget the player is deterministic for a seed, as tournaments and training need.
+*/
+class SearchController : public Controller
+{
+public:
+    explicit SearchController(const SearchSettings& settings = SearchSettings());
+
+    void reset(std::uint32_t seed) override;
+    ControllerAction act(const PongState& state, const PongConfig& config, bool rightSide) override;
+
+    std::uint64_t getSearches() const;
+    std::uint64_t getIterations() const; /* Rollouts over every search. */
+
+private:
+    struct Node;
+
+    SearchSettings _settings;
+    Arena _arena;
+    FollowController _opponent; /* Model of the other pad. */
+    std::uint32_t _random; /* Xorshift state of the rollouts. */
+    PlayerMoved _move; /* Chosen by the last search. */
+    int _moveTicksLeft; /* Ticks before the next search. */
+    std::uint64_t _searches;
+    std::uint64_t _iterations;
+
+    std::uint32_t nextRandom();
+    PlayerMoved search(const PongState& state, const PongConfig& config, bool rightSide); /* Best move of the pad now. */
+    bool advance(PongState& state, const PongConfig& config, bool rightSide, PlayerMoved move, int ticks, float& value); /* True if the rally is decided, value in [0, 1]. */
+    float rollout(PongState state, const PongConfig& config, bool rightSide); /* Random but ball-seeking moves until the rally is decided. */
+    float evaluateReturn(const PongState& state, const PongConfig& config, bool rightSide) const; /* Value of a ball the pad just sent back, from the chance that the opponent misses it. */
+    PlayerMoved moveTowards(const PongState& state, const PongConfig& config, bool rightSide, std::int32_t targetY) const; /* Move bringing the pad centre to targetY. */
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include <SDL.h>
+
+#include "TextureAtlas.h"
+
+/*
+    Quads from a single texture atlas, submitted to the renderer together.
+    With SDL 2.0.18 or later all the quads are drawn by one SDL_RenderGeometry call; older versions
+    draw them one by one with SDL_RenderCopy, still without changing texture.
+*/
+class SpriteBatch
+{
+public:
+    static const int RESERVED_QUADS = 256; /* Quads a frame can queue without growing the buffers. */
+
+    SpriteBatch();
+
+    void begin(const TextureAtlas& atlas); /* Start a batch of quads from the atlas. */
+    void draw(int id, const SDL_Rect& destRect); /* Queue an image of the atlas. */
+    void draw(const SDL_Rect& source, const SDL_Rect& destRect); /* Queue a region of the atlas texture. */
+    void end(SDL_Renderer* renderer); /* Submit the queued quads. */
+
+    int getQuadCount() const; /* Quads queued since begin(). */
+
+private:
+    const TextureAtlas* _atlas;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    std::vector<SDL_Vertex> _vertices; /* Four per quad. */
+    std::vector<int> _indices; /* Six per quad. */
+#else
+    std::vector<SDL_Rect> _sources;
+    std::vector<SDL_Rect> _destinations;
+#endif
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+/*
+    Several images packed into a single texture at load time, so that a frame can be drawn without switching textures.
+    Images are added as surfaces, then build() packs them in shelves and uploads the result.
+    An image can be given the size it is drawn at: build() resamples it once with a tent filter,
+    so that the renderer copies it without scaling every frame.
+    The added images are kept at full size, so that a new window size only needs another build().
+*/
+class TextureAtlas
+{
+public:
+    static const int PADDING = 1; /* Transparent pixels around every image, so that filtering does not bleed between neighbours. */
+
+    TextureAtlas();
+    ~TextureAtlas();
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    /* Decoding without an atlas, for worker threads. Both return null on failure. */
+    static SDL_Surface* loadImage(const std::string& path); /* Decode an image file, cyan is transparent. */
+    static SDL_Surface* renderText(TTF_Font* font, const std::string& text, SDL_Color colour); /* Only one thread at a time may use a font. */
+
+    bool addImage(const std::string& path, int& id); /* Load an image, cyan is transparent. */
+    bool addText(TTF_Font* font, const std::string& text, SDL_Color colour, int& id); /* Rasterize a text. */
+    void addSurface(SDL_Surface* surface, int& id); /* Add an image already in memory, the atlas frees the surface. */
+    void replaceImage(int id, SDL_Surface* surface); /* Use an image already at the size set for id at the next build(), instead of resampling it. */
+    void getImageSize(int id, int& width, int& height) const; /* Original size of an image. */
+    void setImageSize(int id, int width, int height); /* Size of the image in the texture, the original one by default. */
+    SDL_Surface* copyImage(int id) const; /* Image at the size set for it as a new RGBA32 surface, to write it to a bundle. */
+    bool build(SDL_Renderer* renderer); /* Pack the images and create the texture. On failure the previous texture is kept. */
+    void freeTexture();
+
+    SDL_Texture* getTexture() const;
+    int getWidth() const;
+    int getHeight() const;
+    const SDL_Rect& getRegion(int id) const; /* Position of an image in the texture. */
+
+private:
+    std::vector<SDL_Surface*> _surfaces; /* Images at their original size. */
+    std::vector<SDL_Surface*> _prepared; /* Images given by replaceImage() for the next build(), or null. */
+    std::vector<SDL_Point> _sizes; /* Size of every image in the texture. */
+    std::vector<SDL_Rect> _regions;
+    SDL_Texture* _texture;
+    int _width, _height;
+
+    void freeSurfaces();
+    void freePrepared();
+    bool pack(SDL_Renderer* renderer, const std::vector<SDL_Surface*>& images, SDL_Texture*& texture, std::vector<SDL_Rect>& regions, int& atlasWidth, int& atlasHeight) const; /* Shelf-pack images into a new texture. */
+};
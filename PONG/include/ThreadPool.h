@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    Work-stealing thread pool.
+    Every worker owns a task queue: it pops its own tasks from the back and, when it runs out,
+    steals from the front of the other queues. Tasks submitted from a worker go to its own queue.
+*/
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threads = 0); /* 0 -> one worker per hardware thread. */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task); /* Queue a task. */
+    void wait(); /* Block until every submitted task has completed. */
+
+    unsigned int size() const; /* Number of workers. */
+
+private:
+    /* Task queue of a single worker. */
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex; /* Protects sleeping and waking up. */
+    std::condition_variable _workAvailable;
+    std::condition_variable _allDone;
+    std::atomic<std::size_t> _queued; /* Tasks in the queues. */
+    std::atomic<std::size_t> _pending; /* Tasks submitted and not completed yet. */
+    std::atomic<unsigned int> _nextQueue; /* Round robin index for tasks submitted from outside the pool. */
+    bool _stopping;
+
+    bool pop(unsigned int index, std::function<void()>& task); /* Take a task from the own queue, or steal one. */
+    void run(unsigned int index); /* Worker loop. */
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+    Lock-free triple buffer between a single writer and a single reader thread.
+    The writer fills the back buffer and swaps it with the middle one; the reader swaps the middle buffer
+    with the front one when a newer value was published. Neither side ever waits: the reader always gets
+    the latest complete value and skips the ones it was too slow to see.
+*/
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() :
+        _middle(1),
+        _back(2),
+        _front(0)
+    {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /* Writer: value being prepared, not visible to the reader until publish(). */
+    T& back()
+    {
+        return _buffers[_back];
+    }
+
+    /* Writer: make the back buffer the latest value. */
+    void publish()
+    {
+        _back = _middle.exchange(static_cast<std::uint8_t>(_back | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+
+    /* Reader: take the latest published value, returns false if there is none since the last call. */
+    bool update()
+    {
+        if ((_middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    /* Reader: value taken by the last update(). */
+    const T& front() const
+    {
+        return _buffers[_front];
+    }
+
+private:
+    static const std::uint8_t INDEX = 3; /* Bits of the buffer index in _middle. */
+    static const std::uint8_t FRESH = 4; /* Set in _middle when the writer published a value the reader has not taken. */
+
+    T _buffers[3];
+    std::atomic<std::uint8_t> _middle; /* Index of the buffer exchanged by the two sides, with the FRESH bit. */
+    std::uint8_t _back; /* Owned by the writer. */
+    std::uint8_t _front; /* Owned by the reader. */
+};
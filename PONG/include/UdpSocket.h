@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/* IPv4 address and port of a UDP peer, in host byte order. */
+struct UdpAddress
+{
+    std::uint32_t host;
+    std::uint16_t port;
+};
+
+bool operator==(const UdpAddress& a, const UdpAddress& b);
+bool resolveAddress(const std::string& text, UdpAddress& address); /* Parse "host:port", the host can be a name. */
+std::uint32_t networkTime(); /* Milliseconds of a steady clock for timeouts and round trips, wrapping every 49 days: only differences are meaningful. */
+
+/* Non-blocking UDP socket. */
+class UdpSocket
+{
+public:
+#if defined(_WIN32)
+    typedef std::uintptr_t Handle; /* SOCKET. */
+#else
+    typedef int Handle; /* File descriptor. */
+#endif
+
+    UdpSocket();
+    ~UdpSocket();
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    /*
+        Bind to a port of every interface, 0 -> any free port. Closes the previous socket.
+        With sharedPort, several sockets can bind the same port and the system spreads the peers among them, a peer
+        always reaching the same socket. Only Linux does this (SO_REUSEPORT), elsewhere the call fails.
+    */
+    bool open(std::uint16_t port, bool sharedPort = false);
+    void close();
+    bool isOpen() const;
+    std::uint16_t localPort() const;
+    Handle handle() const; /* To wait for datagrams with the system's own calls. */
+    bool setBufferSizes(int receiveBytes, int sendBytes); /* Room for datagrams queued by the system, for bursts of many peers. */
+
+    bool send(const UdpAddress& to, const void* data, std::size_t size); /* False if the datagram could not be queued. */
+    std::size_t sendBatch(const UdpAddress* to, std::size_t count, const void* data, std::size_t size); /* Send the same datagram to many peers without copying it, returns how many were queued; a failed datagram does not stop the others. */
+    int receive(UdpAddress& from, void* buffer, std::size_t size); /* Size of the next datagram, 0 if none is waiting, -1 on error. */
+
+private:
+    Handle _socket;
+    std::uint16_t _port;
+};
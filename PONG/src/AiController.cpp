@@ -0,0 +1,109 @@
+#include "../include/AiController.h"
+
+#include "../include/Predictor.h"
+
+const AiDifficulty AiController::EASY = { 48, 1500, 550, 240 };
+const AiDifficulty AiController::MEDIUM = { 24, 1000, 750, 180 };
+const AiDifficulty AiController::HARD = { 8, 750, AI_ONE, 120 };
+const AiDifficulty AiController::PERFECT = { 0, 0, AI_ONE, 0 };
+
+AiController::AiController(const AiDifficulty& difficulty) :
+    _difficulty(difficulty),
+    _random(1),
+    _targetY(0),
+    _lastSpeedX(0),
+    _lastSpeedY(0),
+    _reactionLeft(0),
+    _serveLeft(difficulty.serveTicks),
+    _moveBudget(0)
+{}
+
+void AiController::reset(std::uint32_t seed)
+{
+    _random = (seed != 0) ? seed : 1;
+    _targetY = 0;
+    _lastSpeedX = 0;
+    _lastSpeedY = 0;
+    _reactionLeft = 0;
+    _serveLeft = _difficulty.serveTicks;
+    _moveBudget = 0;
+}
+
+std::int32_t AiController::nextNoise()
+{
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return static_cast<std::int32_t>(_random % (2 * AI_ONE + 1)) - AI_ONE;
+}
+
+void AiController::plan(const PongState& state, const PongConfig& config, bool rightSide)
+{
+    std::int32_t ballY = predictBallY(state, config, rightSide);
+    /* The pad height times the noise, both in thousandths. */
+    std::int32_t error = static_cast<std::int32_t>(static_cast<std::int64_t>(_difficulty.noise) * config.playerHeight * nextNoise() / (AI_ONE * AI_ONE));
+    _targetY = ballY + config.ballHeight / 2 + error;
+}
+
+PlayerMoved AiController::spin(const PongState& state, const PongConfig& config, bool rightSide) const
+{
+    /* The spin of a moving pad adds its direction to the vertical speed of the ball. */
+    std::int32_t otherY = rightSide ? state.leftPlayerY : state.rightPlayerY;
+    return (otherY + config.playerHeight / 2 < config.tableHeight / 2) ? PlayerMoved::DOWN : PlayerMoved::UP;
+}
+
+ControllerAction AiController::act(const PongState& state, const PongConfig& config, bool rightSide)
+{
+    ControllerAction action = { PlayerMoved::NA, false };
+
+    /* Hold the ball for a while before serving it, with a move so that it leaves with spin. */
+    bool hasBall = state.lock && (state.lockSide == rightSide);
+    if (hasBall)
+    {
+        if (_serveLeft > 0) --_serveLeft;
+        action.serve = (_serveLeft == 0);
+        if (action.serve)
+        {
+            action.move = spin(state, config, rightSide);
+            return action;
+        }
+    }
+    else
+    {
+        _serveLeft = _difficulty.serveTicks;
+    }
+
+    /* React to changes of direction of the ball only after the reaction delay. */
+    if (state.ballSpeedX != _lastSpeedX || state.ballSpeedY != _lastSpeedY)
+    {
+        _lastSpeedX = state.ballSpeedX;
+        _lastSpeedY = state.ballSpeedY;
+        _reactionLeft = _difficulty.reactionTicks;
+    }
+    if (_reactionLeft > 0) --_reactionLeft;
+    if (_reactionLeft == 0)
+    {
+        plan(state, config, rightSide);
+        _reactionLeft = -1;
+    }
+    if (state.lock && !hasBall) _targetY = config.playerLockY + config.playerHeight / 2;
+
+    /* Move towards the target, at most on the allowed fraction of the ticks. */
+    _moveBudget += _difficulty.speedCap;
+    if (_moveBudget < AI_ONE) return action;
+    _moveBudget -= AI_ONE;
+
+    /* A pad standing still returns the ball flat: move through the hit to give it spin. */
+    bool approaching = !state.lock && (state.ballSpeedX > 0) == rightSide;
+    if (approaching && ticksToSide(state, config, rightSide) == 0)
+    {
+        action.move = spin(state, config, rightSide);
+        return action;
+    }
+
+    std::int32_t playerY = rightSide ? state.rightPlayerY : state.leftPlayerY;
+    std::int32_t distance = _targetY - (playerY + config.playerHeight / 2);
+    if (distance < -config.playerSpeed / 2) action.move = PlayerMoved::UP;
+    else if (distance > config.playerSpeed / 2) action.move = PlayerMoved::DOWN;
+    return action;
+}
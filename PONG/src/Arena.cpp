@@ -0,0 +1,33 @@
+#include "../include/Arena.h"
+
+Arena::Arena(std::size_t capacity) :
+    _memory(new std::uint8_t[capacity]),
+    _capacity(capacity),
+    _used(0)
+{}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment)
+{
+    /* Align the address rather than the offset: the block itself is only aligned for the fundamental types. */
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(_memory.get());
+    std::uintptr_t address = (base + _used + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+    std::size_t end = static_cast<std::size_t>(address - base) + size;
+    if (end > _capacity) return nullptr;
+    _used = end;
+    return reinterpret_cast<void*>(address);
+}
+
+void Arena::reset()
+{
+    _used = 0;
+}
+
+std::size_t Arena::used() const
+{
+    return _used;
+}
+
+std::size_t Arena::capacity() const
+{
+    return _capacity;
+}
@@ -0,0 +1,145 @@
+#include "../include/AssetBundle.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+/* Offset rounded up to the alignment of the images. */
+static std::uint64_t alignOffset(std::uint64_t offset)
+{
+    return (offset + BUNDLE_ALIGNMENT - 1) / BUNDLE_ALIGNMENT * BUNDLE_ALIGNMENT;
+}
+
+bool AssetBundleWriter::addImage(const std::string& name, SDL_Surface* surface)
+{
+    if (name.size() >= BUNDLE_NAME_SIZE)
+    {
+        printf("The name %s is too long for a bundle\n", name.c_str());
+        return false;
+    }
+    if (surface->format->format != SDL_PIXELFORMAT_RGBA32)
+    {
+        printf("The image %s is not RGBA32\n", name.c_str());
+        return false;
+    }
+    for (const BundleImage& image : _images)
+    {
+        if (name == image.name && image.width == surface->w && image.height == surface->h) return true;
+    }
+
+    BundleImage image = {};
+    std::copy(name.begin(), name.end(), image.name);
+    image.width = surface->w;
+    image.height = surface->h;
+    image.offset = alignOffset(_pixels.size());
+    _images.push_back(image);
+
+    std::size_t rowSize = static_cast<std::size_t>(surface->w) * 4;
+    _pixels.resize(image.offset + rowSize * surface->h, 0);
+    const std::uint8_t* row = static_cast<const std::uint8_t*>(surface->pixels);
+    for (int y = 0; y < surface->h; ++y, row += surface->pitch)
+    {
+        std::copy(row, row + rowSize, _pixels.begin() + image.offset + y * rowSize);
+    }
+    return true;
+}
+
+bool AssetBundleWriter::save(const std::string& path) const
+{
+    BundleHeader header = {};
+    header.magic = BUNDLE_MAGIC;
+    header.version = BUNDLE_VERSION;
+    header.imageCount = static_cast<std::uint32_t>(_images.size());
+
+    /* The pixels start at the first aligned offset after the records. */
+    std::uint64_t records = sizeof(BundleHeader) + _images.size() * sizeof(BundleImage);
+    std::uint64_t pixelsOffset = alignOffset(records);
+    std::vector<BundleImage> images = _images;
+    for (BundleImage& image : images) image.offset += pixelsOffset;
+    const std::uint8_t padding[BUNDLE_ALIGNMENT] = {};
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        printf("Unable to create %s\n", path.c_str());
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   (images.empty() || fwrite(images.data(), sizeof(BundleImage), images.size(), file) == images.size()) &&
+                   (pixelsOffset == records || fwrite(padding, pixelsOffset - records, 1, file) == 1) &&
+                   (_pixels.empty() || fwrite(_pixels.data(), _pixels.size(), 1, file) == 1);
+    if (fclose(file) != 0) written = false;
+    if (!written) printf("Unable to write %s\n", path.c_str());
+    return written;
+}
+
+AssetBundle::AssetBundle() :
+    _header(),
+    _images(nullptr)
+{}
+
+bool AssetBundle::open(const std::string& path)
+{
+    _images = nullptr;
+    if (!_file.open(path)) return false;
+
+    /* Check that the records and every image fit in the file before using them in place. */
+    if (_file.size() < sizeof(BundleHeader))
+    {
+        printf("%s is not an asset bundle\n", path.c_str());
+        return false;
+    }
+    std::copy(_file.data(), _file.data() + sizeof(BundleHeader), reinterpret_cast<unsigned char*>(&_header));
+    if (_header.magic != BUNDLE_MAGIC || _header.version != BUNDLE_VERSION)
+    {
+        printf("%s is not an asset bundle of version %u\n", path.c_str(), BUNDLE_VERSION);
+        return false;
+    }
+    if (_header.imageCount > (_file.size() - sizeof(BundleHeader)) / sizeof(BundleImage))
+    {
+        printf("%s is truncated or corrupted\n", path.c_str());
+        return false;
+    }
+    const BundleImage* images = reinterpret_cast<const BundleImage*>(_file.data() + sizeof(BundleHeader));
+    for (std::uint32_t i = 0; i < _header.imageCount; ++i)
+    {
+        const BundleImage& image = images[i];
+        bool valid = memchr(image.name, 0, BUNDLE_NAME_SIZE) != nullptr && image.width > 0 && image.height > 0 &&
+                     image.offset % BUNDLE_ALIGNMENT == 0 && image.offset <= _file.size() &&
+                     static_cast<std::uint64_t>(image.width) * image.height * 4 <= _file.size() - image.offset;
+        if (!valid)
+        {
+            printf("%s is truncated or corrupted\n", path.c_str());
+            return false;
+        }
+    }
+    _images = images;
+    return true;
+}
+
+const BundleImage* AssetBundle::find(const std::string& name) const
+{
+    for (std::uint32_t i = 0; _images != nullptr && i < _header.imageCount; ++i)
+    {
+        if (name == _images[i].name) return &_images[i];
+    }
+    return nullptr;
+}
+
+const BundleImage* AssetBundle::find(const std::string& name, int width, int height) const
+{
+    for (std::uint32_t i = 0; _images != nullptr && i < _header.imageCount; ++i)
+    {
+        if (_images[i].width == width && _images[i].height == height && name == _images[i].name) return &_images[i];
+    }
+    return nullptr;
+}
+
+SDL_Surface* AssetBundle::createSurface(const BundleImage& image) const
+{
+    /* SDL does not write to the pixels of a surface it only blits from, the mapping stays read-only. */
+    void* pixels = const_cast<unsigned char*>(_file.data() + image.offset);
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(pixels, image.width, image.height, 32, image.width * 4, SDL_PIXELFORMAT_RGBA32);
+    if (surface == nullptr) printf("%s", SDL_GetError());
+    return surface;
+}
@@ -0,0 +1,527 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+
+#include "../include/Game.h"
+#include "../include/LTexture.h"
+#include "../include/PongBatch.h"
+#include "../include/PongState.h"
+#include "../include/Predictor.h"
+#include "../include/SearchController.h"
+
+/* Benchmark settings, from the command line. */
+struct BenchmarkSettings
+{
+    std::string texturePath = "./textures/"; /* Same media as the game. */
+    std::string fontPath = "./fonts/";
+    std::string output; /* JSON file of the results, empty -> standard output. */
+    std::string baseline; /* JSON file of a previous run to compare with, empty if none. */
+    std::string bundle; /* Asset bundle to also measure the startup with, empty if none. */
+    double threshold = 5.0; /* Percentage by which a result must be worse than the baseline to be a regression. */
+    int repetitions = 5; /* Runs of every benchmark, the median is reported. */
+    int windowWidth = 1280; /* Size of the offscreen window of the render benchmark. */
+    int windowHeight = 720;
+};
+
+/* Result of a benchmark, one entry of the JSON file. */
+struct BenchmarkResult
+{
+    std::string name;
+    double value;
+    std::string unit;
+    bool higherIsBetter;
+};
+
+/* Measures of a named value over several runs. */
+struct BenchmarkSamples
+{
+    std::string name;
+    std::vector<double> values;
+};
+
+typedef std::chrono::steady_clock BenchmarkClock;
+
+static const std::uint32_t SEED = 1; /* Seed of the simulated inputs, fixed so that every run does the same work. */
+static const std::size_t INPUT_COUNT = 1 << 16; /* Length of the simulated input sequence, repeated as needed. */
+static const std::uint64_t PHYSICS_STEPS = 10000000; /* Ticks of a physics run. */
+static const std::size_t BATCH_SIZE = 1024; /* Matches of a batch physics run. */
+static const int BATCH_TICKS = 10000; /* Ticks of a batch physics run. */
+static const int SEARCHES = 100; /* Searches of a lookahead run, each with a fixed number of rollouts. */
+static const int RENDER_WARMUP = 30; /* Frames rendered before measuring, to fill the caches of the renderer. */
+static const int RENDER_FRAMES = 500; /* Frames measured in a render run. */
+static const int TEXTURE_LOADS = 200; /* Textures created in a texture run. */
+static const int INIT_RUNS = 5; /* Game::init calls in an init run. */
+
+static volatile std::uint64_t sink; /* Receives the results of the physics runs, so that they cannot be optimized away. */
+
+static double elapsedSeconds(BenchmarkClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+}
+
+/* Value at the given fraction of the sorted samples. */
+static double percentile(std::vector<double> samples, double fraction)
+{
+    if (samples.empty()) return 0.0;
+    std::sort(samples.begin(), samples.end());
+    std::size_t index = static_cast<std::size_t>(fraction * (samples.size() - 1) + 0.5);
+    return samples[index];
+}
+
+/* Random inputs with the frequency of a real match: the pads move most of the time and the ball is served often. */
+static std::vector<std::uint8_t> makeInputs(std::size_t count, std::uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::vector<std::uint8_t> inputs(count);
+    for (auto& input : inputs)
+    {
+        std::uint32_t bits = random();
+        input = static_cast<std::uint8_t>(((bits & 3) == 1 ? INPUT_LEFT_UP : (bits & 3) == 2 ? INPUT_LEFT_DOWN : 0) |
+                                          (((bits >> 2) & 3) == 1 ? INPUT_RIGHT_UP : ((bits >> 2) & 3) == 2 ? INPUT_RIGHT_DOWN : 0) |
+                                          (((bits >> 4) & 15) == 0 ? INPUT_SERVE : 0));
+    }
+    return inputs;
+}
+
+/* Ticks per second of step() on a single match. */
+static double benchmarkPhysicsStep(const PongConfig& config, const std::vector<std::uint8_t>& inputs)
+{
+    PongState state;
+    resetMatch(state, config);
+    std::uint32_t events = 0;
+    auto start = BenchmarkClock::now();
+    for (std::uint64_t tick = 0; tick < PHYSICS_STEPS; ++tick)
+    {
+        events += step(state, config, inputs[tick & (INPUT_COUNT - 1)]);
+    }
+    double seconds = elapsedSeconds(start);
+
+    sink = sink + events + hashState(state);
+    return PHYSICS_STEPS / seconds;
+}
+
+/* Ticks per second, summed over every match, of PongBatch. */
+static double benchmarkPhysicsBatch(const PongConfig& config, const std::vector<std::uint8_t>& inputs)
+{
+    PongBatch batch(config, BATCH_SIZE);
+    std::vector<std::uint8_t> events(BATCH_SIZE);
+    auto start = BenchmarkClock::now();
+    for (int tick = 0; tick < BATCH_TICKS; ++tick)
+    {
+        batch.step(&inputs[(tick * BATCH_SIZE) & (INPUT_COUNT - 1)], events.data());
+    }
+    double seconds = elapsedSeconds(start);
+
+    sink = sink + static_cast<std::uint32_t>(batch.ballX()[0]) + events[0];
+    return static_cast<double>(BATCH_SIZE) * BATCH_TICKS / seconds;
+}
+
+/* Rollouts per second of SearchController, searching the return of a ball about to reach the right pad. */
+static double benchmarkSearch(const PongConfig& config)
+{
+    PongState state;
+    resetMatch(state, config);
+    step(state, config, INPUT_SERVE | INPUT_LEFT_DOWN);
+    SearchSettings settings;
+    while (ticksToSide(state, config, true) > settings.window) step(state, config, INPUT_NONE);
+
+    /* A search every call, stopped by its rollout count. */
+    settings.ticksPerMove = 1;
+    SearchController controller(settings);
+    controller.reset(SEED);
+    auto start = BenchmarkClock::now();
+    for (int search = 0; search < SEARCHES; ++search) controller.act(state, config, true);
+    double seconds = elapsedSeconds(start);
+
+    sink = sink + controller.getSearches();
+    return controller.getIterations() / seconds;
+}
+
+/* Game options of the offscreen benchmarks: a window of fixed size, SDL's software renderer and no frame pacing. */
+static GameOptions offscreenOptions(const BenchmarkSettings& settings)
+{
+    GameOptions options;
+    options.windowWidth = settings.windowWidth;
+    options.windowHeight = settings.windowHeight;
+    options.softwareRenderer = true;
+    options.vsync = false;
+    options.audio = false;
+    return options;
+}
+
+/* Microseconds of every rendered and presented frame, drawing the whole window or only the dirty rectangles. */
+static bool benchmarkRender(const BenchmarkSettings& settings, bool dirtyRects, std::vector<double>& frameTimes)
+{
+    Game game;
+    GameOptions options = offscreenOptions(settings);
+    options.dirtyRects = dirtyRects;
+    if (!game.init(settings.texturePath, settings.fontPath, options)) return false;
+
+    for (int frame = 0; frame < RENDER_WARMUP; ++frame) game.renderFrame(0.0f);
+    for (int frame = 0; frame < RENDER_FRAMES; ++frame)
+    {
+        auto start = BenchmarkClock::now();
+        game.renderFrame(static_cast<float>(frame % 10) / 10.0f);
+        frameTimes.push_back(elapsedSeconds(start) * 1e6);
+    }
+    return true;
+}
+
+/* Add a measure to the samples of its name. */
+static void addSample(std::vector<BenchmarkSamples>& samples, const std::string& name, double value)
+{
+    for (BenchmarkSamples& entry : samples)
+    {
+        if (entry.name == name)
+        {
+            entry.values.push_back(value);
+            return;
+        }
+    }
+    samples.push_back({ name, std::vector<double>(1, value) });
+}
+
+/*
+    Milliseconds of every Game::init call, including the SDL initialization and the destruction of the previous game.
+    With a bundle, its mapping is part of the time. The load time of every asset, in microseconds, goes to loadTimes.
+*/
+static bool benchmarkInit(const BenchmarkSettings& settings, bool useBundle, std::vector<double>& initTimes, std::vector<BenchmarkSamples>& loadTimes)
+{
+    for (int run = 0; run < INIT_RUNS; ++run)
+    {
+        auto start = BenchmarkClock::now();
+        {
+            Game game;
+            AssetBundle bundle;
+            if (useBundle)
+            {
+                if (!bundle.open(settings.bundle)) return false;
+                game.setBundle(&bundle);
+            }
+            if (!game.init(settings.texturePath, settings.fontPath, offscreenOptions(settings))) return false;
+            initTimes.push_back(elapsedSeconds(start) * 1e3);
+
+            const Profiler& profiler = game.getProfiler();
+            for (std::size_t i = 0; i < profiler.getLoadCount(); ++i) addSample(loadTimes, profiler.getLoadName(i), profiler.getLoadTime(i));
+        }
+    }
+    return true;
+}
+
+/* Microseconds of every LTexture::loadFromFile and LTexture::loadFromRenderedText call, on a software renderer. */
+static bool benchmarkTextures(const BenchmarkSettings& settings, std::vector<double>& fileTimes, std::vector<double>& textTimes)
+{
+    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+        printf("%s\n", SDL_GetError());
+        return false;
+    }
+    if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) || TTF_Init() == -1)
+    {
+        printf("%s\n", SDL_GetError());
+        SDL_Quit();
+        return false;
+    }
+
+    bool success = false;
+    SDL_Window* window = SDL_CreateWindow("Benchmark", 0, 0, settings.windowWidth, settings.windowHeight, SDL_WINDOW_HIDDEN);
+    SDL_Renderer* renderer = (window != nullptr) ? SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE) : nullptr;
+    TTF_Font* font = TTF_OpenFont((settings.fontPath + "lazy.ttf").c_str(), 100);
+    if (renderer == nullptr || font == nullptr)
+    {
+        printf("%s\n", SDL_GetError());
+    }
+    else
+    {
+        LTexture texture;
+        const SDL_Color colour = { 255, 255, 255, 255 };
+        success = true;
+        for (int load = 0; load < TEXTURE_LOADS && success; ++load)
+        {
+            texture.freeTexture();
+            auto start = BenchmarkClock::now();
+            success = texture.loadFromFile(renderer, settings.texturePath + "pad.png");
+            fileTimes.push_back(elapsedSeconds(start) * 1e6);
+        }
+        for (int load = 0; load < TEXTURE_LOADS && success; ++load)
+        {
+            auto start = BenchmarkClock::now();
+            success = texture.loadFromRenderedText(renderer, std::to_string(load), colour, font);
+            textTimes.push_back(elapsedSeconds(start) * 1e6);
+        }
+    }
+
+    if (font != nullptr) TTF_CloseFont(font);
+    if (renderer != nullptr) SDL_DestroyRenderer(renderer);
+    if (window != nullptr) SDL_DestroyWindow(window);
+    TTF_Quit();
+    IMG_Quit();
+    SDL_Quit();
+    return success;
+}
+
+static std::string toJson(const std::vector<BenchmarkResult>& results)
+{
+    std::string json = "{\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        char line[256];
+        snprintf(line, sizeof(line), "    { \"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\", \"higher_is_better\": %s }%s\n",
+                 results[i].name.c_str(), results[i].value, results[i].unit.c_str(),
+                 results[i].higherIsBetter ? "true" : "false", (i + 1 < results.size()) ? "," : "");
+        json += line;
+    }
+    json += "  ]\n}\n";
+    return json;
+}
+
+/* Find the string or literal value of a key in a JSON object, starting at position. Enough for the files written by toJson. */
+static bool findValue(const std::string& json, std::size_t begin, std::size_t end, const char* key, std::string& value)
+{
+    std::string quotedKey = std::string("\"") + key + "\"";
+    std::size_t position = json.find(quotedKey, begin);
+    if (position == std::string::npos || position >= end) return false;
+    position = json.find(':', position + quotedKey.size());
+    if (position == std::string::npos || position >= end) return false;
+    position = json.find_first_not_of(" \t\r\n", position + 1);
+    if (position == std::string::npos || position >= end) return false;
+
+    std::size_t last;
+    if (json[position] == '"')
+    {
+        ++position;
+        last = json.find('"', position);
+    }
+    else
+    {
+        last = json.find_first_of(",} \t\r\n", position);
+    }
+    if (last == std::string::npos || last > end) return false;
+    value = json.substr(position, last - position);
+    return true;
+}
+
+static bool readBaseline(const std::string& path, std::vector<BenchmarkResult>& results)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        printf("Cannot open %s\n", path.c_str());
+        return false;
+    }
+    std::string json;
+    char buffer[4096];
+    std::size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) json.append(buffer, count);
+    fclose(file);
+
+    /* Every benchmark is a flat object of the "benchmarks" array. */
+    std::size_t position = json.find("\"benchmarks\"");
+    while (position != std::string::npos)
+    {
+        std::size_t begin = json.find('{', position);
+        if (begin == std::string::npos) break;
+        std::size_t end = json.find('}', begin);
+        if (end == std::string::npos) break;
+
+        BenchmarkResult result;
+        std::string value, higherIsBetter;
+        if (!findValue(json, begin, end, "name", result.name) || !findValue(json, begin, end, "value", value) ||
+            !findValue(json, begin, end, "higher_is_better", higherIsBetter))
+        {
+            printf("Malformed benchmark in %s\n", path.c_str());
+            return false;
+        }
+        findValue(json, begin, end, "unit", result.unit);
+        result.value = strtod(value.c_str(), nullptr);
+        result.higherIsBetter = higherIsBetter == "true";
+        results.push_back(result);
+        position = end;
+    }
+    return true;
+}
+
+/* Print the change of every result against the baseline. Returns the number of regressions. */
+static int compareResults(const std::vector<BenchmarkResult>& results, const std::vector<BenchmarkResult>& baseline, double threshold)
+{
+    int regressions = 0;
+    for (const auto& result : results)
+    {
+        auto previous = std::find_if(baseline.begin(), baseline.end(), [&](const BenchmarkResult& entry) { return entry.name == result.name; });
+        if (previous == baseline.end() || previous->value == 0.0)
+        {
+            fprintf(stderr, "%-24s %12.6g %-8s (not in the baseline)\n", result.name.c_str(), result.value, result.unit.c_str());
+            continue;
+        }
+
+        /* Positive change -> better, whatever the direction of the benchmark. */
+        double change = (result.value - previous->value) / previous->value * 100.0;
+        if (!result.higherIsBetter) change = -change;
+        bool regression = change < -threshold;
+        if (regression) ++regressions;
+        fprintf(stderr, "%-24s %12.6g %-8s baseline %12.6g %+7.2f%% %s\n", result.name.c_str(), result.value, result.unit.c_str(),
+                previous->value, change, regression ? "REGRESSION" : "ok");
+    }
+    return regressions;
+}
+
+static void printUsage()
+{
+    printf("Usage: Benchmark [--output results.json] [--compare baseline.json] [--threshold percent] [--repetitions N]\n");
+    printf("                 [--textures path/] [--fonts path/] [--bundle assets.bundle] [--size width height]\n");
+}
+
+static bool parseArguments(int argc, char* args[], BenchmarkSettings& settings)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* option = args[i];
+        const char* value = (i + 1 < argc) ? args[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            printf("Missing value for %s\n", option);
+            return false;
+        }
+        if (strcmp(option, "--output") == 0) settings.output = value;
+        else if (strcmp(option, "--compare") == 0) settings.baseline = value;
+        else if (strcmp(option, "--threshold") == 0) settings.threshold = atof(value);
+        else if (strcmp(option, "--repetitions") == 0) settings.repetitions = atoi(value);
+        else if (strcmp(option, "--textures") == 0) settings.texturePath = value;
+        else if (strcmp(option, "--fonts") == 0) settings.fontPath = value;
+        else if (strcmp(option, "--bundle") == 0) settings.bundle = value;
+        else if (strcmp(option, "--size") == 0 && i + 2 < argc)
+        {
+            settings.windowWidth = atoi(value);
+            settings.windowHeight = atoi(args[i + 2]);
+            ++i;
+        }
+        else
+        {
+            printf("Unknown option %s\n", option);
+            return false;
+        }
+        ++i;
+    }
+    if (settings.repetitions <= 0 || settings.windowWidth <= 0 || settings.windowHeight <= 0)
+    {
+        printf("The repetitions and the window size must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+    Measure the physics throughput, the cost of a frame, the texture loading latency and the startup time,
+    and write them as JSON. With --compare, exit with an error if any result is worse than the baseline.
+    Offscreen: SDL uses its dummy video driver unless SDL_VIDEODRIVER is set, so it runs on a headless machine.
+*/
+int main(int argc, char* args[])
+{
+    BenchmarkSettings settings;
+    if (!parseArguments(argc, args, settings))
+    {
+        printUsage();
+        return -1;
+    }
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+
+    PongLayout layout;
+    const PongConfig config = makeConfig(layout);
+    const std::vector<std::uint8_t> inputs = makeInputs(INPUT_COUNT, SEED);
+
+    /* Progress and failures go to stderr, so that the JSON can be piped. */
+    std::vector<BenchmarkResult> results;
+    std::vector<double> stepRates, batchRates, searchRates;
+    for (int run = 0; run < settings.repetitions; ++run)
+    {
+        stepRates.push_back(benchmarkPhysicsStep(config, inputs));
+        batchRates.push_back(benchmarkPhysicsBatch(config, inputs));
+        searchRates.push_back(benchmarkSearch(config));
+    }
+    results.push_back({ "physics_step", percentile(stepRates, 0.5), "steps/s", true });
+    results.push_back({ std::string("physics_batch_") + PongBatch::kernelName(), percentile(batchRates, 0.5), "steps/s", true });
+    results.push_back({ "search_rollouts", percentile(searchRates, 0.5), "rollouts/s", true });
+
+    bool rendered = true;
+    for (int dirtyRects = 0; dirtyRects < 2; ++dirtyRects)
+    {
+        std::vector<double> frameTimes;
+        bool success = true;
+        for (int run = 0; run < settings.repetitions && success; ++run) success = benchmarkRender(settings, dirtyRects != 0, frameTimes);
+        std::string name = dirtyRects ? "render_dirty_rects" : "render_software";
+        if (success)
+        {
+            results.push_back({ name + "_p50", percentile(frameTimes, 0.5), "us", false });
+            results.push_back({ name + "_p99", percentile(frameTimes, 0.99), "us", false });
+        }
+        else fprintf(stderr, "\n%s benchmark failed\n", name.c_str());
+        rendered = rendered && success;
+    }
+
+    std::vector<double> fileTimes, textTimes;
+    bool loaded = benchmarkTextures(settings, fileTimes, textTimes);
+    if (loaded)
+    {
+        results.push_back({ "texture_load_file", percentile(fileTimes, 0.5), "us", false });
+        results.push_back({ "texture_render_text", percentile(textTimes, 0.5), "us", false });
+    }
+    else fprintf(stderr, "\nTexture benchmark failed\n");
+
+    bool initialized = true;
+    for (int useBundle = 0; useBundle < (settings.bundle.empty() ? 1 : 2); ++useBundle)
+    {
+        std::vector<double> initTimes;
+        std::vector<BenchmarkSamples> loadTimes;
+        bool success = true;
+        for (int run = 0; run < settings.repetitions && success; ++run) success = benchmarkInit(settings, useBundle != 0, initTimes, loadTimes);
+        std::string name = useBundle ? "game_init_bundle" : "game_init";
+        if (success)
+        {
+            results.push_back({ name, percentile(initTimes, 0.5), "ms", false });
+            for (const BenchmarkSamples& asset : loadTimes)
+            {
+                results.push_back({ (useBundle ? "load_bundle_" : "load_") + asset.name, percentile(asset.values, 0.5), "us", false });
+            }
+        }
+        else fprintf(stderr, "\n%s benchmark failed\n", name.c_str());
+        initialized = initialized && success;
+    }
+
+    std::string json = toJson(results);
+    if (settings.output.empty())
+    {
+        fputs(json.c_str(), stdout);
+    }
+    else
+    {
+        FILE* file = fopen(settings.output.c_str(), "wb");
+        if (file == nullptr || fwrite(json.data(), 1, json.size(), file) != json.size())
+        {
+            printf("Cannot write %s\n", settings.output.c_str());
+            if (file != nullptr) fclose(file);
+            return -1;
+        }
+        fclose(file);
+    }
+
+    int failures = (rendered ? 0 : 1) + (initialized ? 0 : 1) + (loaded ? 0 : 1);
+    if (!settings.baseline.empty())
+    {
+        std::vector<BenchmarkResult> baseline;
+        if (!readBaseline(settings.baseline, baseline)) return -1;
+        int regressions = compareResults(results, baseline, settings.threshold);
+        fprintf(stderr, "%d regression(s) above %.1f%%\n", regressions, settings.threshold);
+        if (regressions > 0) return 1;
+    }
+    return (failures > 0) ? 2 : 0;
+}
@@ -0,0 +1,444 @@
+#include "../include/Broadcast.h"
+
+#include <algorithm>
+#include <chrono>
+
+static const int WIDTH_CLASSES[4] = { 6, 12, 20, 32 }; /* Bits of a changed field, chosen by a 2-bit prefix. */
+static const int MAX_REQUESTS_PER_TICK = 4096; /* Spectator datagrams handled per published tick. */
+static const std::size_t MAX_SPECTATORS = 1 << 20;
+static const std::uint32_t REQUEST_INTERVAL = 1000; /* Milliseconds between two subscriptions while nothing arrives. */
+static const std::uint32_t ACK_INTERVAL = 4 * BROADCAST_BASELINE; /* Ticks between two acknowledgements: every spectator request is server work. */
+static const int SERVER_BUFFER_SIZE = 4 << 20; /* Bytes, the requests of thousands of spectators arrive together. */
+
+/* Integer fields of the state, in the order they are encoded. */
+static std::int32_t PongState::* const FIELDS[] = {
+    &PongState::leftPlayerY, &PongState::rightPlayerY, &PongState::ballX, &PongState::ballY,
+    &PongState::ballSpeedX, &PongState::ballSpeedY, &PongState::leftScore, &PongState::rightScore
+};
+
+/* Appends bits to a buffer, least significant first. */
+class BitWriter
+{
+public:
+    explicit BitWriter(std::uint8_t* data) :
+        _data(data),
+        _size(0),
+        _accumulator(0),
+        _pending(0)
+    {}
+
+    void write(std::uint32_t value, int bits)
+    {
+        _accumulator |= (static_cast<std::uint64_t>(value) & ((1ull << bits) - 1)) << _pending;
+        _pending += bits;
+        while (_pending >= 8)
+        {
+            _data[_size++] = static_cast<std::uint8_t>(_accumulator);
+            _accumulator >>= 8;
+            _pending -= 8;
+        }
+    }
+
+    std::size_t finish() /* Flush the last partial byte, returns the size in bytes. */
+    {
+        if (_pending > 0) _data[_size++] = static_cast<std::uint8_t>(_accumulator);
+        _accumulator = 0;
+        _pending = 0;
+        return _size;
+    }
+
+private:
+    std::uint8_t* _data;
+    std::size_t _size;
+    std::uint64_t _accumulator;
+    int _pending; /* Bits in the accumulator. */
+};
+
+/* Reads the bits of a BitWriter back, failing past the end of the buffer. */
+class BitReader
+{
+public:
+    BitReader(const std::uint8_t* data, std::size_t size) :
+        _data(data),
+        _size(size),
+        _offset(0),
+        _accumulator(0),
+        _pending(0)
+    {}
+
+    bool read(std::uint32_t& value, int bits)
+    {
+        while (_pending < bits)
+        {
+            if (_offset >= _size) return false;
+            _accumulator |= static_cast<std::uint64_t>(_data[_offset++]) << _pending;
+            _pending += 8;
+        }
+        value = static_cast<std::uint32_t>(_accumulator & ((1ull << bits) - 1));
+        _accumulator >>= bits;
+        _pending -= bits;
+        return true;
+    }
+
+private:
+    const std::uint8_t* _data;
+    std::size_t _size;
+    std::size_t _offset;
+    std::uint64_t _accumulator;
+    int _pending;
+};
+
+/* A field equal to its base costs one bit, a changed one the zigzag of its difference in the smallest width class. */
+static void encodeField(BitWriter& writer, std::int32_t value, std::int32_t base)
+{
+    std::uint32_t difference = static_cast<std::uint32_t>(value) - static_cast<std::uint32_t>(base);
+    if (difference == 0)
+    {
+        writer.write(0, 1);
+        return;
+    }
+    std::uint32_t zigzag = (difference << 1) ^ static_cast<std::uint32_t>(static_cast<std::int32_t>(difference) >> 31);
+    int widthClass = 0;
+    while (widthClass < 3 && (zigzag >> WIDTH_CLASSES[widthClass]) != 0) ++widthClass;
+    writer.write(1, 1);
+    writer.write(static_cast<std::uint32_t>(widthClass), 2);
+    writer.write(zigzag, WIDTH_CLASSES[widthClass]);
+}
+
+static bool decodeField(BitReader& reader, std::int32_t base, std::int32_t& value)
+{
+    std::uint32_t changed;
+    if (!reader.read(changed, 1)) return false;
+    if (changed == 0)
+    {
+        value = base;
+        return true;
+    }
+    std::uint32_t widthClass;
+    std::uint32_t zigzag;
+    if (!reader.read(widthClass, 2) || !reader.read(zigzag, WIDTH_CLASSES[widthClass])) return false;
+    std::uint32_t difference = (zigzag >> 1) ^ (0u - (zigzag & 1));
+    value = static_cast<std::int32_t>(static_cast<std::uint32_t>(base) + difference);
+    return true;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::uint64_t addressKey(const UdpAddress& address)
+{
+    return (static_cast<std::uint64_t>(address.host) << 16) | address.port;
+}
+
+std::size_t encodeSnapshot(std::uint8_t* buffer, std::uint32_t tick, const PongState& state, std::uint32_t baseTick, const PongState* base)
+{
+    /* A full snapshot is a delta against a zero state. */
+    static const PongState ZERO = PongState();
+    const PongState& reference = (base != nullptr) ? *base : ZERO;
+
+    BitWriter writer(buffer);
+    writer.write(BROADCAST_MAGIC, 32);
+    writer.write(tick, 32);
+    writer.write((base != nullptr) ? tick - baseTick : 0, 8);
+    for (auto field : FIELDS) encodeField(writer, state.*field, reference.*field);
+    writer.write(state.lock ? 1 : 0, 1);
+    writer.write(state.lockSide ? 1 : 0, 1);
+    return writer.finish();
+}
+
+bool readSnapshotTicks(const std::uint8_t* data, std::size_t size, std::uint32_t& tick, std::uint32_t& baseTick)
+{
+    BitReader reader(data, size);
+    std::uint32_t magic;
+    std::uint32_t age;
+    if (!reader.read(magic, 32) || magic != BROADCAST_MAGIC) return false;
+    if (!reader.read(tick, 32) || !reader.read(age, 8)) return false;
+    baseTick = tick - age;
+    return true;
+}
+
+bool decodeSnapshot(const std::uint8_t* data, std::size_t size, const PongState& base, PongState& state)
+{
+    static const PongState ZERO = PongState();
+
+    BitReader reader(data, size);
+    std::uint32_t magic;
+    std::uint32_t tick;
+    std::uint32_t age;
+    if (!reader.read(magic, 32) || magic != BROADCAST_MAGIC) return false;
+    if (!reader.read(tick, 32) || !reader.read(age, 8)) return false;
+
+    const PongState& reference = (age != 0) ? base : ZERO;
+    PongState decoded;
+    for (auto field : FIELDS)
+    {
+        if (!decodeField(reader, reference.*field, decoded.*field)) return false;
+    }
+    std::uint32_t lock;
+    std::uint32_t lockSide;
+    if (!reader.read(lock, 1) || !reader.read(lockSide, 1)) return false;
+    decoded.lock = lock != 0;
+    decoded.lockSide = lockSide != 0;
+    state = decoded;
+    return true;
+}
+
+BroadcastServer::BroadcastServer(const BroadcastSettings& settings) :
+    _settings(settings),
+    _tick(0),
+    _encodes(0),
+    _snapshots(0),
+    _failedSends(0),
+    _bytes(0),
+    _encodeSeconds(0.0),
+    _sendSeconds(0.0)
+{
+    /* Snapshots must fall on the baselines. */
+    if (_settings.sendInterval == 0 || BROADCAST_BASELINE % _settings.sendInterval != 0) _settings.sendInterval = 1;
+}
+
+bool BroadcastServer::open(std::uint16_t port)
+{
+    if (!_socket.open(port)) return false;
+    _socket.setBufferSizes(SERVER_BUFFER_SIZE, SERVER_BUFFER_SIZE);
+    return true;
+}
+
+std::uint16_t BroadcastServer::localPort() const
+{
+    return _socket.localPort();
+}
+
+void BroadcastServer::publish(const PongState& state)
+{
+    std::uint32_t now = networkTime();
+    _history[_tick & (BROADCAST_HISTORY - 1)] = state;
+    receive(now);
+    if (_tick % _settings.sendInterval == 0) broadcast(now);
+    ++_tick;
+}
+
+std::size_t BroadcastServer::getSpectators() const
+{
+    return _spectators.size();
+}
+
+std::uint64_t BroadcastServer::getEncodes() const
+{
+    return _encodes;
+}
+
+std::uint64_t BroadcastServer::getSnapshots() const
+{
+    return _snapshots;
+}
+
+std::uint64_t BroadcastServer::getFailedSends() const
+{
+    return _failedSends;
+}
+
+std::uint64_t BroadcastServer::getBytes() const
+{
+    return _bytes;
+}
+
+double BroadcastServer::getEncodeSeconds() const
+{
+    return _encodeSeconds;
+}
+
+double BroadcastServer::getSendSeconds() const
+{
+    return _sendSeconds;
+}
+
+void BroadcastServer::receive(std::uint32_t now)
+{
+    BroadcastRequest request;
+    UdpAddress from;
+    for (int i = 0; i < MAX_REQUESTS_PER_TICK; ++i)
+    {
+        int size = _socket.receive(from, &request, sizeof(request));
+        if (size <= 0) return;
+        if (size != static_cast<int>(sizeof(request)) || request.magic != BROADCAST_MAGIC) continue;
+
+        auto found = _spectatorIndices.find(addressKey(from));
+        if (found == _spectatorIndices.end())
+        {
+            if (_spectators.size() >= MAX_SPECTATORS) continue;
+            found = _spectatorIndices.emplace(addressKey(from), _spectators.size()).first;
+            _spectators.push_back({ from, BROADCAST_NO_ACK, now });
+        }
+        Spectator& spectator = _spectators[found->second];
+        spectator.ackTick = request.ackTick;
+        spectator.lastSeen = now;
+    }
+}
+
+void BroadcastServer::broadcast(std::uint32_t now)
+{
+    for (Group& group : _groups) group.addresses.clear();
+
+    std::size_t i = 0;
+    while (i < _spectators.size())
+    {
+        Spectator& spectator = _spectators[i];
+        if (now - spectator.lastSeen >= BROADCAST_TIMEOUT)
+        {
+            /* Gone: move the last spectator to its place. */
+            _spectatorIndices.erase(addressKey(spectator.address));
+            if (i + 1 < _spectators.size())
+            {
+                spectator = _spectators.back();
+                _spectatorIndices[addressKey(spectator.address)] = i;
+            }
+            _spectators.pop_back();
+            continue;
+        }
+
+        /* A baseline still in the history, or a full snapshot. */
+        std::uint32_t ack = spectator.ackTick;
+        bool usable = ack != BROADCAST_NO_ACK && ack % BROADCAST_BASELINE == 0 && _tick - ack < BROADCAST_HISTORY;
+        std::size_t group = usable ? (ack / BROADCAST_BASELINE) % BROADCAST_BASELINES : BROADCAST_BASELINES;
+        _groups[group].addresses.push_back(spectator.address);
+        ++i;
+    }
+
+    for (std::size_t group = 0; group <= BROADCAST_BASELINES; ++group)
+    {
+        Group& current = _groups[group];
+        if (current.addresses.empty()) continue;
+
+        auto start = std::chrono::steady_clock::now();
+        const PongState& state = _history[_tick & (BROADCAST_HISTORY - 1)];
+        std::size_t size;
+        if (group == BROADCAST_BASELINES)
+        {
+            size = encodeSnapshot(current.snapshot, _tick, state, _tick, nullptr);
+        }
+        else
+        {
+            /* The one baseline of this group within the history. */
+            std::uint32_t baseTick = _tick - (_tick - static_cast<std::uint32_t>(group) * BROADCAST_BASELINE) % BROADCAST_HISTORY;
+            size = encodeSnapshot(current.snapshot, _tick, state, baseTick, &_history[baseTick & (BROADCAST_HISTORY - 1)]);
+        }
+        ++_encodes;
+        _encodeSeconds += secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        std::size_t sent = _socket.sendBatch(current.addresses.data(), current.addresses.size(), current.snapshot, size);
+        _sendSeconds += secondsSince(start);
+        _snapshots += sent;
+        _failedSends += current.addresses.size() - sent;
+        _bytes += sent * size;
+    }
+}
+
+BroadcastClient::BroadcastClient() :
+    _server{ 0, 0 },
+    _hasState(false),
+    _tick(0),
+    _state(),
+    _ackTick(BROADCAST_NO_ACK),
+    _lastReceive(0),
+    _lastRequest(0),
+    _snapshots(0),
+    _dropped(0)
+{
+    std::fill(_baselineTicks, _baselineTicks + BROADCAST_BASELINES, BROADCAST_NO_ACK);
+}
+
+bool BroadcastClient::open(const UdpAddress& server)
+{
+    if (!_socket.open(0)) return false;
+    _server = server;
+    std::uint32_t now = networkTime();
+    _lastReceive = now;
+    request(now);
+    return true;
+}
+
+void BroadcastClient::poll()
+{
+    std::uint32_t now = networkTime();
+    std::uint8_t data[BROADCAST_MAX_SNAPSHOT];
+    UdpAddress from;
+    int size;
+    while ((size = _socket.receive(from, data, sizeof(data))) > 0)
+    {
+        if (!(from == _server)) continue;
+
+        std::uint32_t tick;
+        std::uint32_t baseTick;
+        if (!readSnapshotTicks(data, static_cast<std::size_t>(size), tick, baseTick)) continue;
+
+        /* A delta is only usable against the very baseline it was encoded from. */
+        std::size_t slot = (baseTick / BROADCAST_BASELINE) % BROADCAST_BASELINES;
+        PongState state;
+        if ((baseTick != tick && _baselineTicks[slot] != baseTick) || !decodeSnapshot(data, static_cast<std::size_t>(size), _baselines[slot], state))
+        {
+            ++_dropped;
+            continue;
+        }
+        ++_snapshots;
+        _lastReceive = now;
+
+        if (!_hasState || static_cast<std::int32_t>(tick - _tick) > 0)
+        {
+            _tick = tick;
+            _state = state;
+            _hasState = true;
+        }
+        if (tick % BROADCAST_BASELINE == 0)
+        {
+            slot = (tick / BROADCAST_BASELINE) % BROADCAST_BASELINES;
+            _baselineTicks[slot] = tick;
+            _baselines[slot] = state;
+            if (_ackTick == BROADCAST_NO_ACK || static_cast<std::int32_t>(tick - _ackTick) >= static_cast<std::int32_t>(ACK_INTERVAL))
+            {
+                _ackTick = tick;
+                request(now);
+            }
+        }
+    }
+
+    /* Subscribe again when nothing arrives: the request or the server may have been lost. */
+    if (now - _lastReceive >= REQUEST_INTERVAL && now - _lastRequest >= REQUEST_INTERVAL) request(now);
+}
+
+bool BroadcastClient::hasState() const
+{
+    return _hasState;
+}
+
+std::uint32_t BroadcastClient::tick() const
+{
+    return _tick;
+}
+
+const PongState& BroadcastClient::state() const
+{
+    return _state;
+}
+
+std::uint64_t BroadcastClient::getSnapshots() const
+{
+    return _snapshots;
+}
+
+std::uint64_t BroadcastClient::getDropped() const
+{
+    return _dropped;
+}
+
+void BroadcastClient::request(std::uint32_t now)
+{
+    BroadcastRequest request;
+    request.magic = BROADCAST_MAGIC;
+    request.ackTick = _ackTick;
+    _socket.send(_server, &request, sizeof(request));
+    _lastRequest = now;
+}
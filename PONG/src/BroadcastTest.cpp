@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../include/Broadcast.h"
+#include "../include/Controller.h"
+#include "../include/PongState.h"
+
+static void printUsage()
+{
+    printf("Usage: BroadcastTest [--seconds N] [--spectators N] [--broadcast-interval ticks]\n");
+}
+
+static bool parseArguments(int argc, char* args[], BroadcastSettings& settings, int& seconds, unsigned int& spectators)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* option = args[i];
+        const char* value = (i + 1 < argc) ? args[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            printf("Missing value for %s\n", option);
+            return false;
+        }
+        if (strcmp(option, "--seconds") == 0) seconds = atoi(value);
+        else if (strcmp(option, "--spectators") == 0) spectators = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+        else if (strcmp(option, "--broadcast-interval") == 0) settings.sendInterval = static_cast<std::uint32_t>(strtoul(value, nullptr, 10));
+        else
+        {
+            printf("Unknown option %s\n", option);
+            return false;
+        }
+        ++i;
+    }
+
+    if (seconds <= 0 || spectators == 0)
+    {
+        printf("The test needs at least one second and one spectator\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+    Broadcast a match between two computer players to spectators of this process over loopback, polled by a few
+    threads, and check that every spectator shows a state that was published. Reports what the fan-out costs.
+*/
+static bool runBroadcastTest(const BroadcastSettings& settings, int seconds, unsigned int spectators)
+{
+    BroadcastServer server(settings);
+    if (!server.open(0)) return false;
+    UdpAddress address = { 0x7F000001, server.localPort() };
+
+    const unsigned int threads = 4;
+    std::vector<std::unique_ptr<BroadcastClient>> clients;
+    for (unsigned int i = 0; i < spectators; ++i)
+    {
+        std::unique_ptr<BroadcastClient> client(new BroadcastClient());
+        if (!client->open(address)) break;
+        clients.push_back(std::move(client));
+    }
+    if (clients.size() < spectators) printf("Only %u spectators could be created\n", static_cast<unsigned int>(clients.size()));
+    if (clients.empty()) return false;
+
+    PongLayout layout;
+    PongConfig config = makeConfig(layout);
+    PongState state;
+    resetMatch(state, config);
+    std::unique_ptr<Controller> left = createController("ai-hard");
+    std::unique_ptr<Controller> right = createController("random");
+    left->reset(1);
+    right->reset(2);
+
+    /* Hash of every published tick. */
+    std::uint64_t ticks = static_cast<std::uint64_t>(seconds) * layout.tickRate;
+    std::vector<std::uint64_t> published;
+    published.reserve(ticks);
+    std::atomic<bool> running(true);
+    std::vector<std::thread> pollers;
+    for (unsigned int thread = 0; thread < threads; ++thread)
+    {
+        pollers.emplace_back([&clients, &running, thread, threads]()
+        {
+            while (running)
+            {
+                for (std::size_t i = thread; i < clients.size(); i += threads) clients[i]->poll();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t tick = 0; tick < ticks; ++tick)
+    {
+        std::this_thread::sleep_until(start + std::chrono::microseconds(tick * 1000000 / layout.tickRate));
+        step(state, config, toInput(left->act(state, config, false), false) | toInput(right->act(state, config, true), true));
+        published.push_back(hashState(state));
+        server.publish(state);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    running = false;
+    for (std::thread& poller : pollers) poller.join();
+
+    std::uint64_t received = 0;
+    std::uint64_t dropped = 0;
+    std::size_t watching = 0;
+    std::size_t mismatches = 0;
+    for (const auto& client : clients)
+    {
+        received += client->getSnapshots();
+        dropped += client->getDropped();
+        if (!client->hasState()) continue;
+        ++watching;
+        if (client->tick() >= published.size() || published[client->tick()] != hashState(client->state())) ++mismatches;
+    }
+
+    double sends = static_cast<double>((ticks + settings.sendInterval - 1) / settings.sendInterval);
+    std::uint64_t snapshots = server.getSnapshots();
+    printf("%u spectators, %llu snapshots sent, %llu failed: %.2f encodes per send, %.1f bytes per snapshot, encode %.2f us per send, fan-out %.1f us per send\n",
+           static_cast<unsigned int>(clients.size()), static_cast<unsigned long long>(snapshots),
+           static_cast<unsigned long long>(server.getFailedSends()), server.getEncodes() / sends,
+           (snapshots > 0) ? static_cast<double>(server.getBytes()) / snapshots : 0.0, server.getEncodeSeconds() * 1e6 / sends, server.getSendSeconds() * 1e6 / sends);
+    printf("%llu snapshots received, %llu dropped, %u spectators showing the match, ", static_cast<unsigned long long>(received),
+           static_cast<unsigned long long>(dropped), static_cast<unsigned int>(watching));
+    if (mismatches > 0) printf("%u show a state that was never published\n", static_cast<unsigned int>(mismatches));
+    else printf("ok\n");
+    return watching == clients.size() && mismatches == 0;
+}
+
+int main(int argc, char* args[])
+{
+    BroadcastSettings settings;
+    int seconds = 10;
+    unsigned int spectators = 1000;
+    if (!parseArguments(argc, args, settings, seconds, spectators))
+    {
+        printUsage();
+        return -1;
+    }
+    return runBroadcastTest(settings, seconds, spectators) ? 0 : -1;
+}
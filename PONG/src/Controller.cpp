@@ -0,0 +1,95 @@
+#include "../include/Controller.h"
+
+#include "../include/AiController.h"
+#include "../include/SearchController.h"
+
+/* Signature of a controller factory. */
+typedef std::unique_ptr<Controller> (*ControllerFactory)();
+
+/* Registry of the built-in controllers. Add new controllers here to make them available by name. */
+static const struct
+{
+    const char* name;
+    ControllerFactory create;
+} CONTROLLERS[] =
+{
+    { "idle", []() -> std::unique_ptr<Controller> { return std::unique_ptr<Controller>(new IdleController()); } },
+    { "random", []() -> std::unique_ptr<Controller> { return std::unique_ptr<Controller>(new RandomController()); } },
+    { "follow", []() -> std::unique_ptr<Controller> { return std::unique_ptr<Controller>(new FollowController()); } },
+    { "ai-easy", []() -> std::unique_ptr<Controller> { return std::unique_ptr<Controller>(new AiController(AiController::EASY)); } },
+    { "ai-medium", []() -> std::unique_ptr<Controller> { return std::unique_ptr<Controller>(new AiController(AiController::MEDIUM)); } },
+    { "ai-hard", []() -> std::unique_ptr<Controller> { return std::unique_ptr<Controller>(new AiController(AiController::HARD)); } },
+    { "ai-perfect", []() -> std::unique_ptr<Controller> { return std::unique_ptr<Controller>(new AiController(AiController::PERFECT)); } },
+    { "search", []() -> std::unique_ptr<Controller> { return std::unique_ptr<Controller>(new SearchController()); } } /* Iteration capped, reproducible. */
+};
+
+void Controller::reset(std::uint32_t seed)
+{}
+
+std::uint8_t toInput(const ControllerAction& action, bool rightSide)
+{
+    std::uint8_t inputs = INPUT_NONE;
+    if (action.move == PlayerMoved::UP) inputs |= rightSide ? INPUT_RIGHT_UP : INPUT_LEFT_UP;
+    else if (action.move == PlayerMoved::DOWN) inputs |= rightSide ? INPUT_RIGHT_DOWN : INPUT_LEFT_DOWN;
+    if (action.serve) inputs |= INPUT_SERVE;
+    return inputs;
+}
+
+ControllerAction IdleController::act(const PongState& state, const PongConfig& config, bool rightSide)
+{
+    return { PlayerMoved::NA, true };
+}
+
+RandomController::RandomController() :
+    _random(1),
+    _move(PlayerMoved::NA),
+    _ticksLeft(0)
+{}
+
+void RandomController::reset(std::uint32_t seed)
+{
+    _random = (seed != 0) ? seed : 1;
+    _move = PlayerMoved::NA;
+    _ticksLeft = 0;
+}
+
+ControllerAction RandomController::act(const PongState& state, const PongConfig& config, bool rightSide)
+{
+    if (_ticksLeft <= 0)
+    {
+        _random ^= _random << 13;
+        _random ^= _random >> 17;
+        _random ^= _random << 5;
+        _move = static_cast<PlayerMoved>(static_cast<int>(_random % 3) - 1);
+        _ticksLeft = 1 + static_cast<int>((_random >> 8) % 64);
+    }
+    --_ticksLeft;
+    return { _move, (_random & 0x100) != 0 };
+}
+
+ControllerAction FollowController::act(const PongState& state, const PongConfig& config, bool rightSide)
+{
+    std::int32_t playerY = rightSide ? state.rightPlayerY : state.leftPlayerY;
+    std::int32_t distance = (state.ballY + config.ballHeight / 2) - (playerY + config.playerHeight / 2);
+
+    ControllerAction action = { PlayerMoved::NA, true };
+    if (distance < -config.playerSpeed) action.move = PlayerMoved::UP;
+    else if (distance > config.playerSpeed) action.move = PlayerMoved::DOWN;
+    return action;
+}
+
+std::vector<std::string> controllerNames()
+{
+    std::vector<std::string> names;
+    for (const auto& entry : CONTROLLERS) names.push_back(entry.name);
+    return names;
+}
+
+std::unique_ptr<Controller> createController(const std::string& name)
+{
+    for (const auto& entry : CONTROLLERS)
+    {
+        if (name == entry.name) return entry.create();
+    }
+    return nullptr;
+}
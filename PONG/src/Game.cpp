@@ -1,48 +1,122 @@
 #include "../include/Game.h"
 
 #include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
 #include <sstream>
+#include <thread>
 
 #include <SDL_image.h>
 
-#include "../include/LTimer.h"
+#include "../include/AllocationCounter.h"
+
+/* PongInput bit of a key, 0 if the key is not used by the game. */
+static std::uint8_t scancodeInput(SDL_Scancode scancode)
+{
+    switch (scancode)
+    {
+    case SDL_SCANCODE_W: return INPUT_LEFT_UP;
+    case SDL_SCANCODE_S: return INPUT_LEFT_DOWN;
+    case SDL_SCANCODE_UP: return INPUT_RIGHT_UP;
+    case SDL_SCANCODE_DOWN: return INPUT_RIGHT_DOWN;
+    case SDL_SCANCODE_RETURN: return INPUT_SERVE;
+    default: return INPUT_NONE;
+    }
+}
+
+/* Convert the timestamp of an event, in SDL_GetTicks milliseconds, to the performance counter. */
+static Uint64 eventTime(Uint32 timestamp)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    Sint32 age = static_cast<Sint32>(SDL_GetTicks() - timestamp);
+    Uint64 ageTicks = (age > 0) ? static_cast<Uint64>(age) * SDL_GetPerformanceFrequency() / 1000 : 0;
+    return (ageTicks < now) ? now - ageTicks : 1;
+}
+
+/* Round to the nearest pixel the same way on both sides of 0, a cast would truncate negative values towards 0. */
+static int roundPixels(float pixels)
+{
+    return static_cast<int>(std::floor(pixels + 0.5f));
+}
+
+/* Convert a length in table units to pixels. */
+static int toPixels(std::int32_t units, float pixelsPerUnit)
+{
+    return roundPixels(units * pixelsPerUnit);
+}
+
+/* Linear interpolation between two simulation coordinates, converted to the pixel grid of the table rectangle. */
+static int interpolate(std::int32_t previous, std::int32_t current, float alpha, float pixelsPerUnit, int origin)
+{
+    return origin + roundPixels((previous + (current - previous) * alpha) * pixelsPerUnit);
+}
 
 Game::Game() :
     _window(nullptr),
     _renderer(nullptr),
     _wWidth(0),
     _wHeight(0),
+    _bundle(nullptr),
+    _backgroundSprite(0),
+    _padSprite(0),
+    _ballSprite(0),
+    _colonSprite(0),
+    _decodedSprites(0),
+    _fontTime(0),
+    _staticLayer(nullptr),
+    _layerLeftScore(-1),
+    _layerRightScore(-1),
+    _fullRedraw(true),
+    _keyInputs(INPUT_NONE),
+    _pendingInput(0),
+    _lastPresent(0),
+    _frameCostIndex(0),
+    _refreshRate(60),
+    _simulating(false),
+    _renderIdle(false),
+    _lastKeyEvent(0),
+    _shownHash(0),
+    _skippedFrames(0),
+    _loopFrames(0),
+    _lastAllocationCount(0),
+    _steadyAllocations(0),
+    _maxFrameAllocations(0),
     _backGroundDest({ 0,0,0,0 }),
+    _pixelsPerUnitX(0.0f),
+    _pixelsPerUnitY(0.0f),
     _font(nullptr),
+    _config(),
+    _state(),
+    _previousState(),
+    _replay(nullptr),
+    _replayStart(0),
+    _netplay(nullptr),
+    _broadcast(nullptr),
+    _spectating(nullptr),
     _leftPlayer({ 0,0,0,0 }),
     _rightPlayer({ 0,0,0,0 }),
-    _leftPlayerLock({ 0,0,0,0 }),
-    _rightPlayerLock({ 0,0,0,0 }),
-    _leftScore(0),
-    _rightScore(0),
-    _leftPlayerMoved(PlayerMoved::NA),
-    _rightPlayerMoved(PlayerMoved::NA),
-    _leftScoreRect({ 0,0,0,0 }),
-    _rightScoreRect({ 0,0,0,0 }),
-    _separatorRect({ 0,0,0,0 }),
-    _textScale(0.0f),
     _ballPosition({ 0,0,0,0 }),
-    _leftPlayerBallLock({ 0,0,0,0 }),
-    _rightPlayerBallLock({ 0,0,0,0 }),
-    _ballSpeedX(0.0f),
-    _ballSpeedY(0.0f),
-    _leftGoal(0),
-    _rightGoal(0),
-    _ballLowerLimit(0),
-    _lock(true),
-    _lockSide(false)
-{}
+    _separatorRect({ 0,0,0,0 }),
+    _showProfiler(false)
+{
+    for (int digit = 0; digit < 10; ++digit) _digitSprites[digit] = 0;
+    for (int zone = 0; zone < ZONE_COUNT; ++zone) _zoneSprites[zone] = 0;
+    for (SDL_Rect& sprite : _lastSprites) sprite = { 0,0,0,0 };
+    _keyEvents.reserve(64);
+    _sharedKeyEvents.reserve(64);
+    _dirtyAreas.reserve(5);
+    _frameCosts.assign(PACING_FRAMES, 0);
+}
 
 Game::~Game()
 {
     /* Free resources. */
     TTF_CloseFont(_font);
     _font = nullptr;
+    _atlas.freeTexture();
+    if (_staticLayer != nullptr) SDL_DestroyTexture(_staticLayer);
+    _staticLayer = nullptr;
     SDL_DestroyRenderer(_renderer);
     _renderer = nullptr;
     SDL_DestroyWindow(_window);
@@ -54,14 +128,87 @@ Game::~Game()
     SDL_Quit();
 }
 
-bool Game::init(std::string texturePath, std::string fontPath)
+bool Game::init(const std::string& texturePath, const std::string& fontPath, const GameOptions& options)
 {
     /* Init of SDL subsystems. */
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
+    if (SDL_Init(options.audio ? (SDL_INIT_VIDEO | SDL_INIT_AUDIO) : SDL_INIT_VIDEO) < 0)
     {
         printf("%s", SDL_GetError());
         return false;
     }
+
+    /* Create a fullscreen window, unless a size is given. */
+    if (options.windowWidth > 0 && options.windowHeight > 0)
+    {
+        _window = SDL_CreateWindow(GAME_NAME.c_str(), START_X, START_Y, options.windowWidth, options.windowHeight, SDL_WINDOW_SHOWN);
+    }
+    else
+    {
+        _window = SDL_CreateWindow(GAME_NAME.c_str(), START_X, START_Y, START_WIDTH, START_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_FULLSCREEN_DESKTOP);
+    }
+    if (_window == nullptr)
+    {
+        printf("%s", SDL_GetError());
+        return false;
+    }
+    SDL_GetWindowSize(_window, &_wWidth, &_wHeight);
+
+    /* Create a renderer for the window. */
+    _options = options;
+    if (!createRenderer()) return false;
+
+    /* A bundle has the images decoded and the glyphs rasterized: neither the image nor the font library is needed. */
+    if (_bundle == nullptr && !openMedia()) return false;
+
+    /* Load textures: the static images share a single atlas texture. Only its upload is left to this thread. */
+    _texturePath = texturePath;
+    _fontPath = fontPath;
+    startLoading();
+    bool firstFrame = true;
+    Uint32 lastFrame = 0;
+    while (_decodedSprites < _spriteLoads.size())
+    {
+        /* Show a placeholder until the loader threads are done, the events wait in the queue. */
+        SDL_PumpEvents();
+        if (firstFrame || SDL_GetTicks() - lastFrame >= PLACEHOLDER_INTERVAL)
+        {
+            renderPlaceholder();
+            lastFrame = SDL_GetTicks();
+            firstFrame = false;
+        }
+        else SDL_Delay(1);
+    }
+    if (!finishLoading()) return false;
+
+    /* Compute the table geometry from the texture sizes. The simulation does not depend on the window. */
+    _config = makeConfig(imageLayout());
+
+    /* A replay carries the geometry it was recorded with. */
+    if (_replay != nullptr)
+    {
+        _config = _replay->config();
+        if (_replay->tickRate() != TICK_RATE) printf("The replay was recorded at %u ticks per second, it is played at %u\n", _replay->tickRate(), TICK_RATE);
+    }
+
+    resetMatch(_state, _config);
+    if (_replay != nullptr)
+    {
+        if (!_replay->seek(_replayStart, _state))
+        {
+            printf("Unable to seek the replay to tick %llu\n", static_cast<unsigned long long>(_replayStart));
+            return false;
+        }
+    }
+    _previousState = _state;
+    if (!_recordPath.empty()) _recorder.reset(new ReplayWriter(_config, TICK_RATE));
+    if (_netplay != nullptr) _netplay->start(_config, _state, TICK_RATE);
+
+    /* Place everything on screen and scale the images to their final size. */
+    return fitToWindow();
+}
+
+bool Game::openMedia()
+{
     if (IMG_Init(IMG_INIT_PNG) != IMG_INIT_PNG)
     {
         printf("%s", IMG_GetError());
@@ -72,330 +219,963 @@ bool Game::init(std::string texturePath, std::string fontPath)
         printf("%s", TTF_GetError());
         return false;
     }
+    return true;
+}
 
-    /* Create a fullscreen window. */
-    _window = SDL_CreateWindow(GAME_NAME.c_str(), START_X, START_Y, START_WIDTH, START_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_FULLSCREEN_DESKTOP);
-    if (_window == nullptr)
+bool Game::createRenderer()
+{
+    /* Textures belong to the renderer. */
+    _atlas.freeTexture();
+    if (_staticLayer != nullptr) SDL_DestroyTexture(_staticLayer);
+    _staticLayer = nullptr;
+    if (_renderer != nullptr) SDL_DestroyRenderer(_renderer);
+
+    if (_options.dirtyRects)
     {
-        printf("%s", SDL_GetError());
-        return false;
+        /* Draw in the window surface, present() copies the dirty areas to the screen. */
+        SDL_Surface* surface = SDL_GetWindowSurface(_window);
+        _renderer = (surface != nullptr) ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    }
+    else
+    {
+        Uint32 rendererFlags = _options.softwareRenderer ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED;
+        if (_options.vsync) rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+        _renderer = SDL_CreateRenderer(_window, -1, rendererFlags);
     }
-    SDL_GetWindowSize(_window, &_wWidth, &_wHeight);
-
-    /* Create a renderer for the window. */
-    _renderer = SDL_CreateRenderer(_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (_renderer == nullptr)
     {
         printf("%s", SDL_GetError());
         return false;
     }
     SDL_SetRenderDrawColor(_renderer, DEFAULT_RED, DEFAULT_GREEN, DEFAULT_BLUE, DEFAULT_ALPHA);
+    return true;
+}
 
-    /* Load the main font. */
-    _font = TTF_OpenFont((fontPath + FONT_NAME).c_str(), FONT_SIZE);
+bool Game::loadSprites()
+{
+    startLoading();
+    return finishLoading();
+}
+
+void Game::startLoading()
+{
+    _spriteLoads.clear();
+    _spriteLoads.push_back({ BACKGROUND_NAME, false, &_backgroundSprite, nullptr, 0 });
+    _spriteLoads.push_back({ PAD_NAME, false, &_padSprite, nullptr, 0 });
+    _spriteLoads.push_back({ BALL_NAME, false, &_ballSprite, nullptr, 0 });
+    _spriteLoads.push_back({ SCORE_SEPARATOR, true, &_colonSprite, nullptr, 0 });
+    for (int digit = 0; digit < 10; ++digit) _spriteLoads.push_back({ std::to_string(digit), true, &_digitSprites[digit], nullptr, 0 });
+    for (int zone = 0; zone < ZONE_COUNT; ++zone) _spriteLoads.push_back({ Profiler::zoneName(zone), true, &_zoneSprites[zone], nullptr, 0 });
+    _decodedSprites = 0;
+
+    if (_bundle != nullptr)
+    {
+        /* Nothing to decode: the surfaces point into the mapping. */
+        for (SpriteLoad& load : _spriteLoads)
+        {
+            Uint64 start = SDL_GetPerformanceCounter();
+            const BundleImage* image = _bundle->find(load.name);
+            if (image != nullptr) load.surface = _bundle->createSurface(*image);
+            else printf("The bundle has no image %s\n", load.name.c_str());
+            load.time = SDL_GetPerformanceCounter() - start;
+        }
+        _decodedSprites = _spriteLoads.size();
+        return;
+    }
+
+    /* A task per image file, decoded in parallel. The glyphs share the font, a single task renders them all. */
+    if (_loaders == nullptr) _loaders.reset(new ThreadPool(LOADER_THREADS));
+    for (SpriteLoad& load : _spriteLoads)
+    {
+        if (load.text) continue;
+        SpriteLoad* image = &load;
+        _loaders->submit([this, image]()
+        {
+            Uint64 start = SDL_GetPerformanceCounter();
+            image->surface = TextureAtlas::loadImage(_texturePath + image->name);
+            image->time = SDL_GetPerformanceCounter() - start;
+            ++_decodedSprites;
+        });
+    }
+    _loaders->submit([this]() { decodeGlyphs(); });
+}
+
+void Game::decodeGlyphs()
+{
+    /* The font stays open for the next loads. */
     if (_font == nullptr)
     {
-        printf("%s", TTF_GetError());
-        return false;
+        Uint64 start = SDL_GetPerformanceCounter();
+        _font = TTF_OpenFont((_fontPath + FONT_NAME).c_str(), FONT_SIZE);
+        if (_font == nullptr) printf("%s", TTF_GetError());
+        _fontTime = SDL_GetPerformanceCounter() - start;
+    }
+    for (SpriteLoad& load : _spriteLoads)
+    {
+        if (!load.text) continue;
+        Uint64 start = SDL_GetPerformanceCounter();
+        if (_font != nullptr) load.surface = TextureAtlas::renderText(_font, load.name, SCORE_TEXT_COLOUR);
+        load.time = SDL_GetPerformanceCounter() - start;
+        ++_decodedSprites;
+    }
+}
+
+bool Game::finishLoading()
+{
+    if (_loaders != nullptr) _loaders->wait();
+
+    /* The loaders printed their failures. The atlas takes every surface, even when the load failed. */
+    bool success = true;
+    Uint64 glyphTime = 0;
+    _spriteNames.clear();
+    for (SpriteLoad& load : _spriteLoads)
+    {
+        if (load.surface == nullptr)
+        {
+            success = false;
+            continue;
+        }
+        _atlas.addSurface(load.surface, *load.sprite);
+        load.surface = nullptr;
+        _spriteNames.push_back(load.name);
+        if (load.text) glyphTime += load.time;
+        else _profiler.setLoadTime(load.name, load.time);
     }
+    if (_fontTime > 0) _profiler.setLoadTime(FONT_NAME, _fontTime);
+    _fontTime = 0;
+    _profiler.setLoadTime("glyphs", glyphTime);
+    return success;
+}
 
-    /* Load textures. */
-    if (!_background.loadFromFile(_renderer, texturePath + BACKGROUND_NAME)) return false;
-    if (!_pad.loadFromFile(_renderer, texturePath + PAD_NAME)) return false;
-    if (!_ball.loadFromFile(_renderer, texturePath + BALL_NAME)) return false;
-    if (!_colon.loadFromRenderedText(_renderer, SCORE_SEPARATOR, SCORE_TEXT_COLOUR, _font)) return false;
-    if (!_leftScoreText.loadFromRenderedText(_renderer, std::to_string(_leftScore), SCORE_TEXT_COLOUR, _font)) return false;
-    if (!_rightScoreText.loadFromRenderedText(_renderer, std::to_string(_rightScore), SCORE_TEXT_COLOUR, _font)) return false;
+void Game::renderPlaceholder()
+{
+    /* Progress bar in the middle of the window, in the colour of the score. */
+    SDL_Rect outline = { (_wWidth - PLACEHOLDER_BAR_WIDTH) / 2, (_wHeight - PLACEHOLDER_BAR_HEIGHT) / 2, PLACEHOLDER_BAR_WIDTH, PLACEHOLDER_BAR_HEIGHT };
+    SDL_Rect progress = outline;
+    progress.w = static_cast<int>(PLACEHOLDER_BAR_WIDTH * _decodedSprites.load() / _spriteLoads.size());
+
+    SDL_RenderClear(_renderer);
+    SDL_SetRenderDrawColor(_renderer, SCORE_TEXT_COLOUR.r, SCORE_TEXT_COLOUR.g, SCORE_TEXT_COLOUR.b, DEFAULT_ALPHA);
+    SDL_RenderDrawRect(_renderer, &outline);
+    SDL_RenderFillRect(_renderer, &progress);
+    SDL_SetRenderDrawColor(_renderer, DEFAULT_RED, DEFAULT_GREEN, DEFAULT_BLUE, DEFAULT_ALPHA);
+
+    _dirtyAreas.clear();
+    _dirtyAreas.push_back({ 0, 0, _wWidth, _wHeight });
+    present();
+}
+
+PongLayout Game::imageLayout() const
+{
+    PongLayout layout;
+    _atlas.getImageSize(_backgroundSprite, layout.tableWidth, layout.tableHeight);
+    _atlas.getImageSize(_padSprite, layout.padWidth, layout.padHeight);
+    _atlas.getImageSize(_ballSprite, layout.ballWidth, layout.ballHeight);
+    layout.tickRate = TICK_RATE;
+    return layout;
+}
+
+bool Game::fitToWindow()
+{
+    SDL_GetWindowSize(_window, &_wWidth, &_wHeight);
+    SDL_DisplayMode mode;
+    _refreshRate = (SDL_GetWindowDisplayMode(_window, &mode) == 0 && mode.refresh_rate > 0) ? mode.refresh_rate : DEFAULT_REFRESH_RATE;
+
+    placeSprites(_wWidth, _wHeight);
+    Uint64 buildStart = SDL_GetPerformanceCounter();
+    bool built = _atlas.build(_renderer);
+    if (built) _profiler.setLoadTime("atlas_build", SDL_GetPerformanceCounter() - buildStart);
+
+    /* The static layer is drawn again at the next frame. Without render targets, it is drawn every frame. */
+    if (_staticLayer != nullptr) SDL_DestroyTexture(_staticLayer);
+    _staticLayer = nullptr;
+    if (SDL_RenderTargetSupported(_renderer))
+    {
+        _staticLayer = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, _wWidth, _wHeight);
+        if (_staticLayer != nullptr) SDL_SetTextureBlendMode(_staticLayer, SDL_BLENDMODE_NONE);
+    }
+    _layerLeftScore = -1;
+    _layerRightScore = -1;
+    _fullRedraw = true;
+    return built;
+}
 
+void Game::placeSprites(int width, int height)
+{
     /* Set size and position of the background. */
-    _backGroundDest.w = _wWidth;
-    _backGroundDest.h = TABLE_COEFF * _wHeight;
-    _backGroundDest.y = _wHeight - _backGroundDest.h;
-
-    /* Set size and position of the players. */
-    float hScale = static_cast<float>(_wWidth) / _background.getWidth();
-    float vScale = static_cast<float>(_backGroundDest.h) / _background.getHeight();
-    _leftPlayer.w = _pad.getWidth() * hScale;
-    _rightPlayer.w = _leftPlayer.w;
-    _leftPlayer.h = _pad.getHeight() * vScale;
-    _rightPlayer.h = _leftPlayer.h;
-    
-    int offset = (BORDER_OFFSET + BORDER_WIDTH + GOAL_OFFSET + (GOAL_WIDTH >> 1)) * hScale;
-    _leftPlayer.x = offset - (_leftPlayer.w >> 1);
-    _rightPlayer.x = (_wWidth - offset) - (_rightPlayer.w >> 1);
-    _leftPlayer.y = _backGroundDest.y + (_backGroundDest.h >> 1);
-    _rightPlayer.y = _leftPlayer.y;
-
-    _leftPlayerLock.h = _leftPlayer.h;
-    _leftPlayerLock.w = _leftPlayer.w;
-    _leftPlayerLock.y = _leftPlayer.y;
-    _leftPlayerLock.x = _leftPlayer.x;
-
-    _rightPlayerLock.h = _rightPlayer.h;
-    _rightPlayerLock.w = _rightPlayer.w;
-    _rightPlayerLock.y = _rightPlayer.y;
-    _rightPlayerLock.x = _rightPlayer.x;
-
-    _playerSpeed = PLAYER_SPEED_COEFF * _wHeight;
-    _playerUpperLimit = _backGroundDest.y + (BORDER_OFFSET + BORDER_WIDTH) * vScale;
-    _playerLowerLimit = _wHeight - (BORDER_OFFSET + BORDER_WIDTH + _pad.getHeight() + PAD_BORDER) * vScale;
-
-    /* Set position and speed of the ball. */
-    _ballSpeedX = 0;
-    _ballSpeedY = 0;
-    _ballDefaultSpeed = _wWidth * BALL_SPEED_COEFF;
-
-    _leftPlayerBallLock.h = _ball.getHeight() * vScale;
-    _leftPlayerBallLock.w = _ball.getWidth() * vScale;
-    _leftPlayerBallLock.y = _leftPlayer.y + ((_leftPlayer.h - _ballPosition.h) >> 1);
-    _leftPlayerBallLock.x = _leftPlayer.x + (PAD_BORDER + _pad.getWidth() - BALL_MARGIN) * hScale;
-
-    _rightPlayerBallLock.h = _leftPlayerBallLock.h;
-    _rightPlayerBallLock.w = _leftPlayerBallLock.w;
-    _rightPlayerBallLock.y = _leftPlayerBallLock.y;
-    _rightPlayerBallLock.x = _rightPlayer.x - ((_pad.getWidth() + (BALL_MARGIN << 1)) * hScale);
-
-    _ballPosition.h = _leftPlayerBallLock.h;
-    _ballPosition.w = _leftPlayerBallLock.w;
-    _ballPosition.y = _leftPlayerBallLock.y;
-    _ballPosition.x = _leftPlayerBallLock.x;
-
-    _ballLowerLimit = _wHeight - (BORDER_OFFSET + BORDER_WIDTH + _ballPosition.h) * vScale;
-
-    /* Set the goal positions. */
-    _leftGoal = (BORDER_OFFSET + BORDER_WIDTH + GOAL_OFFSET + GOAL_WIDTH - BALL_MARGIN) * hScale;
-    _rightGoal = _wWidth - _leftGoal;
-
-    /* Set position and size of the score text. */
-    _separatorRect.h = ((1 - TABLE_COEFF) / 2) * _wHeight;
+    _backGroundDest.w = width;
+    _backGroundDest.h = TABLE_COEFF * height;
+    _backGroundDest.y = height - _backGroundDest.h;
+
+    /* The table is stretched over the background rectangle. */
+    _pixelsPerUnitX = static_cast<float>(_backGroundDest.w) / _config.tableWidth;
+    _pixelsPerUnitY = static_cast<float>(_backGroundDest.h) / _config.tableHeight;
+
+    /* Set size and position of the players and the ball. */
+    _leftPlayer = { _backGroundDest.x + toPixels(_config.leftPlayerX, _pixelsPerUnitX), 0,
+                    toPixels(_config.playerWidth, _pixelsPerUnitX), toPixels(_config.playerHeight, _pixelsPerUnitY) };
+    _rightPlayer = { _backGroundDest.x + toPixels(_config.rightPlayerX, _pixelsPerUnitX), 0, _leftPlayer.w, _leftPlayer.h };
+    _ballPosition = { 0, 0, toPixels(_config.ballWidth, _pixelsPerUnitX), toPixels(_config.ballHeight, _pixelsPerUnitY) };
+
+    /* Set position and size of the score text: every glyph is scaled to the height of the separator. */
+    int glyphWidth, glyphHeight;
+    _atlas.getImageSize(_colonSprite, glyphWidth, glyphHeight);
+    _separatorRect.h = ((1 - TABLE_COEFF) / 2) * height;
     _separatorRect.y = UPPER_MARGIN;
-    _separatorRect.w = _colon.getWidth();
-    _separatorRect.x = (_wWidth - _colon.getWidth()) >> 1;
+    _separatorRect.w = glyphWidth * _separatorRect.h / glyphHeight;
+    _separatorRect.x = (width - _separatorRect.w) >> 1;
 
-    _textScale = static_cast<float>(_separatorRect.h) / _colon.getHeight();
+    /* Resample every image once to the size it is drawn at, instead of scaling the full-size art every frame. */
+    sizeSprite(_backgroundSprite, _backGroundDest.w, _backGroundDest.h);
+    sizeSprite(_padSprite, _leftPlayer.w, _leftPlayer.h);
+    sizeSprite(_ballSprite, _ballPosition.w, _ballPosition.h);
+    sizeSprite(_colonSprite, _separatorRect.w, _separatorRect.h);
+    for (int digit = 0; digit < 10; ++digit)
+    {
+        _atlas.getImageSize(_digitSprites[digit], glyphWidth, glyphHeight);
+        sizeSprite(_digitSprites[digit], glyphWidth * _separatorRect.h / glyphHeight, _separatorRect.h);
+    }
+    for (int zone = 0; zone < ZONE_COUNT; ++zone)
+    {
+        _atlas.getImageSize(_zoneSprites[zone], glyphWidth, glyphHeight);
+        sizeSprite(_zoneSprites[zone], glyphWidth * PROFILER_TEXT_HEIGHT / glyphHeight, PROFILER_TEXT_HEIGHT);
+    }
+}
 
-    _leftScoreRect.h = _separatorRect.h;
-    _rightScoreRect.h = _separatorRect.h;
-    _leftScoreRect.y = _separatorRect.y;
-    _rightScoreRect.y = _separatorRect.y;
-    _leftScoreRect.w = _leftScoreText.getWidth() * _textScale;
-    _rightScoreRect.w = _leftScoreRect.w;
-    _leftScoreRect.x = _separatorRect.x - SEPARATOR_MARGIN;
-    _rightScoreRect.x = _separatorRect.x + _separatorRect.w + SEPARATOR_MARGIN;
+void Game::sizeSprite(int id, int width, int height)
+{
+    _atlas.setImageSize(id, width, height);
 
-    return true;
+    /* The bundle may have the image at exactly this size: then build() does not resample it. */
+    const BundleImage* image = (_bundle != nullptr) ? _bundle->find(_spriteNames[id], width, height) : nullptr;
+    SDL_Surface* surface = (image != nullptr) ? _bundle->createSurface(*image) : nullptr;
+    if (surface != nullptr) _atlas.replaceImage(id, surface);
 }
 
 void Game::play()
 {
-    LTimer elapsedTime;
+    _loopFrames = 0;
+    _lastAllocationCount = allocationCount();
+    if (_options.simulationThread) runRenderThread();
+    else runSingleThread();
+    countAllocations();
+
+    if (_recorder) _recorder->save(_recordPath, (_netplay != nullptr) ? _netplay->confirmedState() : _state);
+    if (_skippedFrames > 0) printf("%llu idle frames skipped\n", static_cast<unsigned long long>(_skippedFrames));
+    if (_netplay != nullptr)
+    {
+        printf("Netplay: %llu rollbacks of up to %u ticks, %llu ticks simulated again, %llu ticks waited for the peer, round trip %u ms\n",
+               static_cast<unsigned long long>(_netplay->getRollbacks()), _netplay->getMaxRollback(), static_cast<unsigned long long>(_netplay->getRollbackTicks()),
+               static_cast<unsigned long long>(_netplay->getWaitedTicks()), _netplay->getRoundTrip());
+    }
+    if (allocationCounterEnabled() && _loopFrames > ALLOCATION_WARMUP_FRAMES)
+    {
+        std::uint64_t frames = _loopFrames - ALLOCATION_WARMUP_FRAMES;
+        printf("%llu heap allocations in %llu frames after the warm-up: %.3f per frame, at most %llu in a frame\n",
+               static_cast<unsigned long long>(_steadyAllocations), static_cast<unsigned long long>(frames),
+               static_cast<double>(_steadyAllocations) / frames, static_cast<unsigned long long>(_maxFrameAllocations));
+    }
+    if (_profiler.getLatencyCount() > 0)
+    {
+        printf("Input to present latency over %llu inputs: p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", static_cast<unsigned long long>(_profiler.getLatencyCount()),
+               _profiler.getLatencyPercentile(50.0) / 1000.0, _profiler.getLatencyPercentile(99.0) / 1000.0, _profiler.getLatencyMaximum() / 1000.0);
+    }
+    if (!_profilePath.empty())
+    {
+        _profiler.writeCsv(_profilePath);
+        _profiler.writeFramesCsv(_profilePath + ".frames.csv");
+    }
+}
+
+bool Game::pollEvents(bool& keyEvents)
+{
     SDL_Event event;
+    bool running = true;
+    bool resized = false;
+    keyEvents = false;
+    while (SDL_PollEvent(&event) != 0)
+    {
+        if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && event.key.repeat == 0 && scancodeInput(event.key.keysym.scancode) != INPUT_NONE)
+        {
+            /* Applied at their tick in low latency mode and by the simulation thread, only used to measure the latency otherwise. */
+            KeyEvent key = { eventTime(event.key.timestamp), scancodeInput(event.key.keysym.scancode), event.type == SDL_KEYDOWN };
+            if (_options.simulationThread)
+            {
+                std::lock_guard<std::mutex> lock(_keyMutex);
+                _sharedKeyEvents.push_back(key);
+                if (key.time > _lastKeyEvent) _lastKeyEvent = key.time;
+                _simulationWake.notify_one();
+            }
+            else
+            {
+                _keyEvents.push_back(key);
+            }
+            keyEvents = true;
+        }
+        if (event.type == SDL_KEYDOWN)
+        {
+            if (event.key.keysym.sym == SDLK_ESCAPE)
+            {
+                running = false;
+            }
+            else if (event.key.keysym.sym == PROFILER_KEY && event.key.repeat == 0)
+            {
+                _showProfiler = !_showProfiler;
+                _fullRedraw = true;
+            }
+        }
+        else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+        {
+            /* The display mode changed: the images are resampled for the new size. */
+            resized = resized || event.window.data1 != _wWidth || event.window.data2 != _wHeight;
+        }
+        else if (event.type == SDL_RENDER_DEVICE_RESET)
+        {
+            /* The textures were lost with the device. */
+            resized = true;
+        }
+        else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED)
+        {
+            _fullRedraw = true;
+        }
+        else if (event.type == SDL_RENDER_TARGETS_RESET)
+        {
+            /* Only the content of the static layer was lost. */
+            _layerLeftScore = -1;
+        }
+    }
+    if (resized)
+    {
+        /*
+            A software renderer of the window surface is lost with the surface. The atlas keeps the decoded images:
+            only the resampling and the upload are done again. If they fail, the previous atlas is drawn scaled.
+        */
+        bool ready = !_options.dirtyRects || createRenderer();
+        if (!ready || (!fitToWindow() && _atlas.getTexture() == nullptr)) running = false;
+    }
+    return running;
+}
+
+void Game::runSingleThread()
+{
+    /* Simulation runs at a fixed tick, rendering runs at the display rate (paced by vsync). */
+    const Uint64 tickLength = SDL_GetPerformanceFrequency() / TICK_RATE;
+    Uint64 previousCounter = SDL_GetPerformanceCounter();
+    Uint64 accumulator = 0;
     bool done = false;
+    bool idle = false;
     while (!done)
     {
-        /* If the game is running too fast, slow it down. */
-        elapsedTime.stop();
-        Uint32 deltaSeconds = elapsedTime.getTicks();
-        if (deltaSeconds < MIN_FRAME_TIME)
+        /* Nothing to show until an event arrives: sleep, and do not simulate the time slept. */
+        if (idle)
         {
-            SDL_Delay(MIN_FRAME_TIME - deltaSeconds);
+            SDL_WaitEventTimeout(nullptr, IDLE_WAIT);
+            previousCounter = SDL_GetPerformanceCounter();
         }
-        elapsedTime.start();
+        else if (_options.lowLatency)
+        {
+            waitForFrameStart();
+        }
+
+        countAllocations();
+        _profiler.beginFrame();
+        Uint64 currentCounter = SDL_GetPerformanceCounter();
+        Uint64 frameTime = currentCounter - previousCounter;
+        previousCounter = currentCounter;
+        if (frameTime > tickLength * MAX_TICKS_PER_FRAME) frameTime = tickLength * MAX_TICKS_PER_FRAME;
+        accumulator += frameTime;
 
         /* Input handling. */
-        while (SDL_PollEvent(&event) != 0)
+        std::uint8_t inputs;
         {
-            if (event.type == SDL_KEYDOWN)
-            {
-                if (event.key.keysym.sym == SDLK_ESCAPE)
-                {
-                    done = true;
-                }
-            }
+            ProfileScope zone(_profiler, ZONE_INPUT);
+            bool keyEvents;
+            done = !pollEvents(keyEvents);
+            inputs = _options.lowLatency ? _keyInputs : sampleInput(SDL_GetKeyboardState(nullptr));
         }
 
-        _leftPlayerMoved = PlayerMoved::NA;
-        _rightPlayerMoved = PlayerMoved::NA;
-        const Uint8* currentKeyState = SDL_GetKeyboardState(nullptr);
-        /* Left player controls. */
-        if (currentKeyState[SDL_SCANCODE_W])
+        /* Consume the elapsed time in fixed ticks. */
         {
-            if (_leftPlayer.y > _playerUpperLimit)
+            ProfileScope zone(_profiler, ZONE_PHYSICS);
+            Uint64 tickStart = currentCounter - accumulator; /* Time at which the next tick starts. */
+            while (accumulator >= tickLength)
             {
-                _leftPlayerMoved = PlayerMoved::UP;
-                float diff = (_leftPlayer.y - _playerUpperLimit) - _playerSpeed;
-                float choice = ((diff < 0) ? diff : _playerSpeed);
-                _leftPlayer.y -= choice;
-                if (_lock && !_lockSide)
-                {
-                    if (currentKeyState[SDL_SCANCODE_RETURN])
-                    {
-                        _lock = false;
-                        _ballSpeedX = _ballDefaultSpeed;
-                        _ballSpeedY = -_playerSpeed;
-                    }
-                    else
-                    {
-                        _ballPosition.y -= choice;
-                    }
-                }
+                /* A key event belongs to the tick during which it happened. */
+                if (_options.lowLatency) inputs = applyKeyEvents(tickStart + tickLength);
+                else applyKeyEvents(~0ull);
+                update(inputs);
+                accumulator -= tickLength;
+                tickStart += tickLength;
             }
         }
-        else if (currentKeyState[SDL_SCANCODE_S])
+
+        /*
+            Idle when the ball is held, nobody presses a key and the frame on screen is up to date.
+            Computer players and replays keep the game running, they act without events.
+        */
+        std::uint64_t hash = hashState(_state);
+        idle = _options.idleWait && _state.lock && inputs == INPUT_NONE && !_fullRedraw && !_showProfiler &&
+               _leftController == nullptr && _rightController == nullptr && _replay == nullptr && _netplay == nullptr &&
+               _broadcast == nullptr && _spectating == nullptr &&
+               hash == hashState(_previousState) && hash == _shownHash && _keyEvents.empty();
+        if (idle)
         {
-            if (_leftPlayer.y < _playerLowerLimit)
-            {
-                _leftPlayerMoved = PlayerMoved::DOWN;
-                float diff = _playerSpeed - (_playerLowerLimit - _leftPlayer.y);
-                float choice = ((diff < 0) ? _playerSpeed : diff);
-                _leftPlayer.y += choice;
-                if (_lock && !_lockSide)
-                {
-                    if (currentKeyState[SDL_SCANCODE_RETURN])
-                    {
-                        _lock = false;
-                        _ballSpeedX = _ballDefaultSpeed;
-                        _ballSpeedY = _playerSpeed;
-                    }
-                    else
-                    {
-                        _ballPosition.y += choice;
-                    }
-                }
-            }
+            ++_skippedFrames;
+            _pendingInput = 0;
+            continue;
         }
-        /* Right player controls. */
-        if (currentKeyState[SDL_SCANCODE_UP])
+
+        /* Render the current frame. */
         {
-            if (_rightPlayer.y > _playerUpperLimit)
-            {
-                _rightPlayerMoved = PlayerMoved::UP;
-                float diff = (_rightPlayer.y - _playerUpperLimit) - _playerSpeed;
-                float choice = ((diff < 0) ? diff : _playerSpeed);
-                _rightPlayer.y -= choice;
-                if (_lock && _lockSide)
-                {
-                    if (currentKeyState[SDL_SCANCODE_RETURN])
-                    {
-                        _lock = false;
-                        _ballSpeedX = -_ballDefaultSpeed;
-                        _ballSpeedY = -_playerSpeed;
-                    }
-                    else
-                    {
-                        _ballPosition.y -= choice;
-                    }
-                }
-            }
+            ProfileScope zone(_profiler, ZONE_RENDER);
+            render(_previousState, _state, static_cast<float>(accumulator) / tickLength);
+            _shownHash = hash;
         }
-        else if (currentKeyState[SDL_SCANCODE_DOWN])
+        Uint64 presentStart = SDL_GetPerformanceCounter();
         {
-            if (_rightPlayer.y < _playerLowerLimit)
-            {
-                _rightPlayerMoved = PlayerMoved::DOWN;
-                float diff = _playerSpeed - (_playerLowerLimit - _rightPlayer.y);
-                float choice = ((diff < 0) ? _playerSpeed : diff);
-                _rightPlayer.y += choice;
-                if (_lock && _lockSide)
-                {
-                    if (currentKeyState[SDL_SCANCODE_RETURN])
-                    {
-                        _lock = false;
-                        _ballSpeedX = -_ballDefaultSpeed;
-                        _ballSpeedY = _playerSpeed;
-                    }
-                    else
-                    {
-                        _ballPosition.y += choice;
-                    }
-                }
-            }
+            ProfileScope zone(_profiler, ZONE_PRESENT);
+            present();
+        }
+        _profiler.endFrame();
+
+        /* Input latency, and cost of the frame for the pacing. */
+        _lastPresent = SDL_GetPerformanceCounter();
+        if (_pendingInput != 0) _profiler.addLatency(_lastPresent - _pendingInput);
+        _pendingInput = 0;
+        _frameCosts[_frameCostIndex++ % _frameCosts.size()] = presentStart - currentCounter;
+
+        if (_replay != nullptr && _replay->tick() == _replay->tickCount()) done = true;
+    }
+}
+
+void Game::runRenderThread()
+{
+    const Uint64 tickLength = SDL_GetPerformanceFrequency() / TICK_RATE;
+
+    /* The first snapshot is the state set by init(), then the simulation owns the match until it is joined. */
+    GameSnapshot& first = _snapshots.back();
+    first = { _previousState, _state, SDL_GetPerformanceCounter(), 0, 0, false };
+    _snapshots.publish();
+    _simulating = true;
+    std::thread simulation(&Game::simulationLoop, this);
+
+    bool done = false;
+    bool idle = false;
+    Uint64 pendingInput = 0; /* _pendingInput belongs to the simulation thread. */
+    Uint64 physicsShown = 0; /* Simulation time already added to the profiler. */
+    while (!done)
+    {
+        if (idle) SDL_WaitEventTimeout(nullptr, IDLE_WAIT);
+        else if (_options.lowLatency) waitForFrameStart();
+
+        countAllocations();
+        _profiler.beginFrame();
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        bool keyEvents;
+        {
+            ProfileScope zone(_profiler, ZONE_INPUT);
+            done = !pollEvents(keyEvents);
         }
 
-        if (_lock && currentKeyState[SDL_SCANCODE_RETURN])
+        /* Always the latest complete state, the simulation never waits for the frame. */
+        if (_snapshots.update() && _snapshots.front().inputTime != 0)
         {
-            if (!_lockSide) _ballSpeedX = _ballDefaultSpeed;
-            else _ballSpeedX = -_ballDefaultSpeed;
-            _lock = false;
+            if (pendingInput == 0 || _snapshots.front().inputTime < pendingInput) pendingInput = _snapshots.front().inputTime;
         }
+        const GameSnapshot& snapshot = _snapshots.front();
+        if (snapshot.finished) done = true;
 
-        /* Ball movement. */
-        _ballPosition.y += _ballSpeedY;
-        _ballPosition.x += _ballSpeedX;
+        /* Not idle before the simulation has applied every key event, or the first move would wait for the next wake up. */
+        std::uint64_t hash = hashState(snapshot.current);
+        idle = _options.idleWait && snapshot.current.lock && !keyEvents && !_fullRedraw && !_showProfiler &&
+               _leftController == nullptr && _rightController == nullptr && _replay == nullptr && _netplay == nullptr &&
+               _broadcast == nullptr && _spectating == nullptr &&
+               hash == hashState(snapshot.previous) && hash == _shownHash && snapshot.time > _lastKeyEvent;
+        {
+            std::lock_guard<std::mutex> lock(_keyMutex);
+            _renderIdle = idle;
+        }
+        if (!idle) _simulationWake.notify_one();
+        if (idle)
+        {
+            ++_skippedFrames;
+            pendingInput = 0;
+            continue;
+        }
+
+        /* The ticks run on the simulation thread: charge this frame with the ones simulated since the last frame. */
+        _profiler.add(ZONE_PHYSICS, snapshot.physicsTime - physicsShown);
+        physicsShown = snapshot.physicsTime;
 
-        /* If the ball hits a border, reverse its vertical speed. */
-        if (!_lock)
         {
-            if (_ballPosition.y <= _playerUpperLimit && _ballSpeedY < 0)
-            {
-                _ballSpeedY = -_ballSpeedY;
-            }
-            else if (_ballPosition.y >= _ballLowerLimit && _ballSpeedY > 0)
-            {
-                _ballSpeedY = -_ballSpeedY;
-            }
+            ProfileScope zone(_profiler, ZONE_RENDER);
+            Uint64 now = SDL_GetPerformanceCounter();
+            float alpha = (now > snapshot.time) ? static_cast<float>(now - snapshot.time) / tickLength : 0.0f;
+            render(snapshot.previous, snapshot.current, (alpha < 1.0f) ? alpha : 1.0f);
+            _shownHash = hash;
+        }
+        Uint64 presentStart = SDL_GetPerformanceCounter();
+        {
+            ProfileScope zone(_profiler, ZONE_PRESENT);
+            present();
+        }
+        _profiler.endFrame();
 
-            /* If the ball hits a player pad, compute the collision. */
-            if (_ballPosition.x <= _leftPlayer.x + _leftPlayer.w &&
-                _ballPosition.y >= _leftPlayer.y &&
-                _ballPosition.y <= _leftPlayer.y + _leftPlayer.h &&
-                _ballSpeedX < 0)
-            {
-                _ballSpeedX = -_ballSpeedX;
-                _ballSpeedY = _ballSpeedY + _playerSpeed * static_cast<int>(_leftPlayerMoved);
-                if (std::abs(_ballSpeedY) > _ballDefaultSpeed) _ballSpeedY = _ballDefaultSpeed;
-            }
-            else if (_ballPosition.x + _ballPosition.w >= _rightPlayer.x &&
-                     _ballPosition.y >= _rightPlayer.y &&
-                     _ballPosition.y <= _rightPlayer.y + _rightPlayer.h &&
-                     _ballSpeedX > 0)
-            {
-                _ballSpeedX = -_ballSpeedX;
-                _ballSpeedY = _ballSpeedY + _playerSpeed * static_cast<int>(_rightPlayerMoved);
-                if (std::abs(_ballSpeedY) > _ballDefaultSpeed) _ballSpeedY = _ballDefaultSpeed;
-            }
+        _lastPresent = SDL_GetPerformanceCounter();
+        if (pendingInput != 0) _profiler.addLatency(_lastPresent - pendingInput);
+        pendingInput = 0;
+        _frameCosts[_frameCostIndex++ % _frameCosts.size()] = presentStart - frameStart;
+    }
 
-            /* If the ball hits a goal, score and reset. */
-            if (_ballPosition.x < _leftGoal)
-            {
-                _lock = true;
-                _lockSide = true;
-                _ballSpeedX = 0;
-                _ballSpeedY = 0;
-                ++_rightScore;
-                _rightScoreText.loadFromRenderedText(_renderer, std::to_string(_rightScore), SCORE_TEXT_COLOUR, _font);
-                _leftPlayer = _leftPlayerLock;
-                _rightPlayer = _rightPlayerLock;
-                _ballPosition = _rightPlayerBallLock;
-            }
-            else if (_ballPosition.x > _rightGoal)
+    {
+        std::lock_guard<std::mutex> lock(_keyMutex);
+        _simulating = false;
+        _renderIdle = false;
+    }
+    _simulationWake.notify_one();
+    simulation.join();
+}
+
+void Game::simulationLoop()
+{
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    const Uint64 tickLength = frequency / TICK_RATE;
+    Uint64 tickStart = SDL_GetPerformanceCounter(); /* Time at which the next tick starts. */
+    Uint64 inputTime = 0; /* Oldest input applied since the last snapshot. */
+    Uint64 physicsTime = 0;
+    while (_simulating.load(std::memory_order_acquire))
+    {
+        /* Sleep while the render thread is idle, and do not simulate the time slept: nothing could change meanwhile. */
+        {
+            std::unique_lock<std::mutex> lock(_keyMutex);
+            if (_renderIdle && _sharedKeyEvents.empty())
             {
-                _lock = true;
-                _lockSide = false;
-                _ballSpeedX = 0;
-                _ballSpeedY = 0;
-                ++_leftScore;
-                _leftScoreText.loadFromRenderedText(_renderer, std::to_string(_leftScore), SCORE_TEXT_COLOUR, _font);
-                _leftPlayer = _leftPlayerLock;
-                _rightPlayer = _rightPlayerLock;
-                _ballPosition = _leftPlayerBallLock;
+                _simulationWake.wait(lock, [this]() { return !_renderIdle || !_sharedKeyEvents.empty(); });
+                tickStart = SDL_GetPerformanceCounter() - tickLength;
             }
         }
 
-        /* Render the current frame. */
-        render();
+        /* A tick is simulated once it is over, with every key event that happened during it. */
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now < tickStart + tickLength)
+        {
+            Uint32 milliseconds = static_cast<Uint32>((tickStart + tickLength - now) * 1000 / frequency);
+            if (milliseconds > 0) SDL_Delay(milliseconds);
+            else std::this_thread::yield();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_keyMutex);
+            _keyEvents.insert(_keyEvents.end(), _sharedKeyEvents.begin(), _sharedKeyEvents.end());
+            _sharedKeyEvents.clear();
+        }
+
+        /* After a stall, give up the time that cannot be caught up. */
+        if (now - tickStart > tickLength * MAX_TICKS_PER_FRAME) tickStart = now - tickLength * MAX_TICKS_PER_FRAME;
+        Uint64 physicsStart = SDL_GetPerformanceCounter();
+        while (tickStart + tickLength <= now)
+        {
+            _pendingInput = 0;
+            std::uint8_t inputs = applyKeyEvents(tickStart + tickLength);
+            if (_pendingInput != 0 && (inputTime == 0 || _pendingInput < inputTime)) inputTime = _pendingInput;
+            update(inputs);
+            tickStart += tickLength;
+        }
+        physicsTime += SDL_GetPerformanceCounter() - physicsStart;
+
+        bool finished = _replay != nullptr && _replay->tick() == _replay->tickCount();
+        GameSnapshot& snapshot = _snapshots.back();
+        snapshot = { _previousState, _state, tickStart, inputTime, physicsTime, finished };
+        _snapshots.publish();
+        inputTime = 0;
+        if (finished) break;
     }
 }
 
-void Game::render()
+void Game::setController(bool rightSide, std::unique_ptr<Controller> controller)
 {
-    SDL_RenderClear(_renderer);
-    _background.render(_renderer, _backGroundDest.x, _backGroundDest.y, nullptr, &_backGroundDest);
-    _pad.render(_renderer, _leftPlayer.x, _leftPlayer.y, nullptr, &_leftPlayer);
-    _pad.render(_renderer, _rightPlayer.x, _rightPlayer.y, nullptr, &_rightPlayer);
-    _ball.render(_renderer, _ballPosition.x, _ballSpeedY, nullptr, &_ballPosition);
-    _colon.render(_renderer, _separatorRect.x, _separatorRect.y, nullptr, &_separatorRect);
-    _leftScoreText.render(_renderer, _leftScoreRect.x, _leftScoreRect.y, nullptr, &_leftScoreRect);
-    _rightScoreText.render(_renderer, _rightScoreRect.x, _rightScoreRect.y, nullptr, &_rightScoreRect);
-    SDL_RenderPresent(_renderer);
+    if (controller) controller->reset(std::random_device()());
+    if (rightSide) _rightController = std::move(controller);
+    else _leftController = std::move(controller);
+}
+
+void Game::setRecording(const std::string& path)
+{
+    _recordPath = path;
+}
+
+void Game::setReplay(Replay* replay, std::uint64_t startTick)
+{
+    _replay = replay;
+    _replayStart = startTick;
+}
+
+void Game::setNetplay(RollbackSession* session)
+{
+    _netplay = session;
+}
+
+void Game::setBroadcast(BroadcastServer* server)
+{
+    _broadcast = server;
+}
+
+void Game::setSpectating(BroadcastClient* client)
+{
+    _spectating = client;
+}
+
+void Game::setProfiling(const std::string& path)
+{
+    _profilePath = path;
+}
+
+void Game::setBundle(AssetBundle* bundle)
+{
+    _bundle = bundle;
+}
+
+bool Game::packBundle(const std::string& texturePath, const std::string& fontPath, const std::string& bundlePath)
+{
+    /* Offline: the images are loaded and resampled as the game does, but never uploaded, so no window is needed. */
+    if (!openMedia()) return false;
+    _bundle = nullptr;
+    _texturePath = texturePath;
+    _fontPath = fontPath;
+    if (!loadSprites()) return false;
+    _config = makeConfig(imageLayout());
+
+    /* The original sizes first, then the sizes of every resolution. */
+    AssetBundleWriter writer;
+    for (int resolution = -1; resolution < static_cast<int>(sizeof(BUNDLE_RESOLUTIONS) / sizeof(BUNDLE_RESOLUTIONS[0])); ++resolution)
+    {
+        if (resolution >= 0) placeSprites(BUNDLE_RESOLUTIONS[resolution].x, BUNDLE_RESOLUTIONS[resolution].y);
+        for (std::size_t id = 0; id < _spriteNames.size(); ++id)
+        {
+            SDL_Surface* image = _atlas.copyImage(static_cast<int>(id));
+            if (image == nullptr) return false;
+            bool added = writer.addImage(_spriteNames[id], image);
+            SDL_FreeSurface(image);
+            if (!added) return false;
+        }
+    }
+    return writer.save(bundlePath);
+}
+
+std::uint64_t Game::getSkippedFrames() const
+{
+    return _skippedFrames;
+}
+
+std::uint64_t Game::getSteadyAllocations() const
+{
+    return _steadyAllocations;
+}
+
+const Profiler& Game::getProfiler() const
+{
+    return _profiler;
+}
+
+void Game::renderFrame(float alpha)
+{
+    render(_previousState, _state, alpha);
+    present();
+}
+
+std::uint8_t Game::sampleInput(const Uint8* currentKeyState)
+{
+    std::uint8_t inputs = INPUT_NONE;
+    /* Left player controls. */
+    if (currentKeyState[SDL_SCANCODE_W]) inputs |= INPUT_LEFT_UP;
+    if (currentKeyState[SDL_SCANCODE_S]) inputs |= INPUT_LEFT_DOWN;
+    /* Right player controls. */
+    if (currentKeyState[SDL_SCANCODE_UP]) inputs |= INPUT_RIGHT_UP;
+    if (currentKeyState[SDL_SCANCODE_DOWN]) inputs |= INPUT_RIGHT_DOWN;
+    if (currentKeyState[SDL_SCANCODE_RETURN]) inputs |= INPUT_SERVE;
+    return inputs;
+}
+
+std::uint8_t Game::applyKeyEvents(Uint64 until)
+{
+    std::size_t count = 0;
+    for (; count < _keyEvents.size() && _keyEvents[count].time < until; ++count)
+    {
+        const KeyEvent& key = _keyEvents[count];
+        if (key.down) _keyInputs |= key.input;
+        else _keyInputs &= ~key.input;
+        if (_pendingInput == 0 || key.time < _pendingInput) _pendingInput = key.time;
+    }
+    _keyEvents.erase(_keyEvents.begin(), _keyEvents.begin() + count);
+    return _keyInputs;
+}
+
+void Game::countAllocations()
+{
+    std::uint64_t count = allocationCount();
+    if (_loopFrames > ALLOCATION_WARMUP_FRAMES)
+    {
+        /* Counted on every thread: the simulation thread must not allocate either. */
+        std::uint64_t frameAllocations = count - _lastAllocationCount;
+        _steadyAllocations += frameAllocations;
+        if (frameAllocations > _maxFrameAllocations) _maxFrameAllocations = frameAllocations;
+    }
+    _lastAllocationCount = count;
+    ++_loopFrames;
+}
+
+void Game::waitForFrameStart()
+{
+    if (_lastPresent == 0) return;
+
+    /* With vsync, the present returns at a vblank: the next one is a period later. */
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 period = frequency / _refreshRate;
+    Uint64 cost = *std::max_element(_frameCosts.begin(), _frameCosts.end()) + frequency * PACING_MARGIN / 1000000;
+    if (cost >= period) return;
+
+    Uint64 start = _lastPresent + period - cost;
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (now >= start) return;
+    Uint32 milliseconds = static_cast<Uint32>((start - now) * 1000 / frequency); /* Rounded down: waking early only adds a little latency. */
+    if (milliseconds > 0) SDL_Delay(milliseconds);
+}
+
+std::uint8_t Game::applyController(Controller* controller, bool rightSide, std::uint8_t inputs)
+{
+    if (controller == nullptr) return inputs;
+
+    /* Only the controller can move its pad and serve the ball it holds. */
+    bool hasBall = _state.lock && (_state.lockSide == rightSide);
+    inputs &= ~(rightSide ? (INPUT_RIGHT_UP | INPUT_RIGHT_DOWN) : (INPUT_LEFT_UP | INPUT_LEFT_DOWN));
+    if (hasBall) inputs &= ~INPUT_SERVE;
+
+    ControllerAction action = controller->act(_state, _config, rightSide);
+    action.serve = action.serve && hasBall;
+    return inputs | toInput(action, rightSide);
+}
+
+void Game::update(std::uint8_t inputs)
+{
+    if (_spectating != nullptr)
+    {
+        /* The state comes from the snapshots, a few ticks apart: hold the last one between them. */
+        _spectating->poll();
+        _previousState = _state;
+        if (!_spectating->hasState()) return;
+        std::int32_t scores = _state.leftScore + _state.rightScore;
+        _state = _spectating->state();
+        if (_state.leftScore + _state.rightScore != scores) _previousState = _state;
+        return;
+    }
+
+    if (_netplay != nullptr)
+    {
+        /* Only the local pad is driven from here, the remote one follows the packets of the peer. */
+        bool rightSide = _netplay->isRightSide();
+        inputs = applyController(rightSide ? _rightController.get() : _leftController.get(), rightSide, inputs);
+        if (!_netplay->advance(inputs)) return;
+
+        /* A rollback may have changed the previous tick too: interpolate from what was on screen. */
+        std::int32_t scores = _state.leftScore + _state.rightScore;
+        _previousState = _state;
+        _state = _netplay->state();
+        if (_state.leftScore + _state.rightScore != scores) _previousState = _state;
+
+        /* Only the ticks whose two inputs are known are recorded and broadcast: spectators never see a rollback. */
+        PongState confirmed;
+        std::uint8_t confirmedInputs;
+        while ((_recorder || _broadcast != nullptr) && _netplay->popConfirmed(confirmed, confirmedInputs))
+        {
+            if (_recorder) _recorder->record(confirmed, confirmedInputs);
+            if (_broadcast != nullptr) _broadcast->publish(confirmed);
+        }
+        return;
+    }
+
+    if (_replay != nullptr)
+    {
+        /* The recorded inputs replace the keyboard and the controllers. */
+        if (!_replay->verify(_state)) printf("The replay diverges at tick %llu\n", static_cast<unsigned long long>(_replay->tick()));
+        if (!_replay->next(inputs)) return;
+    }
+    else
+    {
+        inputs = applyController(_leftController.get(), false, inputs);
+        inputs = applyController(_rightController.get(), true, inputs);
+    }
+    if (_recorder) _recorder->record(_state, inputs);
+
+    _previousState = _state;
+    std::uint8_t events = step(_state, _config, inputs);
+
+    /* If a player scored, do not interpolate from the pre-goal positions. */
+    if (events & (EVENT_LEFT_SCORED | EVENT_RIGHT_SCORED)) _previousState = _state;
+    if (_broadcast != nullptr) _broadcast->publish(_state);
+}
+
+void Game::drawNumber(std::uint32_t value, int x, int y, int height, bool alignRight)
+{
+    /* Split the number in digits, least significant first. */
+    int digits[10];
+    int count = 0;
+    do
+    {
+        digits[count++] = value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    if (alignRight)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const SDL_Rect& glyph = _atlas.getRegion(_digitSprites[digits[i]]);
+            x -= glyph.w * height / glyph.h;
+        }
+    }
+    for (int i = count - 1; i >= 0; --i)
+    {
+        const SDL_Rect& glyph = _atlas.getRegion(_digitSprites[digits[i]]);
+        SDL_Rect destRect = { x, y, glyph.w * height / glyph.h, height };
+        _batch.draw(_digitSprites[digits[i]], destRect);
+        x += destRect.w;
+    }
+}
+
+void Game::drawStaticLayer(const PongState& state)
+{
+    _batch.draw(_backgroundSprite, _backGroundDest);
+    _batch.draw(_colonSprite, _separatorRect);
+    drawNumber(static_cast<std::uint32_t>(state.leftScore), _separatorRect.x - SEPARATOR_MARGIN, _separatorRect.y, _separatorRect.h, true);
+    drawNumber(static_cast<std::uint32_t>(state.rightScore), _separatorRect.x + _separatorRect.w + SEPARATOR_MARGIN, _separatorRect.y, _separatorRect.h, false);
+}
+
+void Game::render(const PongState& previous, const PongState& current, float alpha)
+{
+    SDL_Rect leftPlayer = _leftPlayer;
+    leftPlayer.y = interpolate(previous.leftPlayerY, current.leftPlayerY, alpha, _pixelsPerUnitY, _backGroundDest.y);
+    SDL_Rect rightPlayer = _rightPlayer;
+    rightPlayer.y = interpolate(previous.rightPlayerY, current.rightPlayerY, alpha, _pixelsPerUnitY, _backGroundDest.y);
+    SDL_Rect ballPosition = _ballPosition;
+    ballPosition.x = interpolate(previous.ballX, current.ballX, alpha, _pixelsPerUnitX, _backGroundDest.x);
+    ballPosition.y = interpolate(previous.ballY, current.ballY, alpha, _pixelsPerUnitY, _backGroundDest.y);
+    const SDL_Rect sprites[3] = { leftPlayer, rightPlayer, ballPosition };
+
+    /* Redraw the static layer only when a score changed. */
+    if (_staticLayer != nullptr && (current.leftScore != _layerLeftScore || current.rightScore != _layerRightScore))
+    {
+        SDL_SetRenderTarget(_renderer, _staticLayer);
+        SDL_RenderClear(_renderer);
+        _batch.begin(_atlas);
+        drawStaticLayer(current);
+        _batch.end(_renderer);
+        SDL_SetRenderTarget(_renderer, nullptr);
+        _layerLeftScore = current.leftScore;
+        _layerRightScore = current.rightScore;
+        _fullRedraw = true;
+    }
+
+    _dirtyAreas.clear();
+    if (_staticLayer == nullptr)
+    {
+        SDL_RenderClear(_renderer);
+        _batch.begin(_atlas);
+        drawStaticLayer(current);
+        _batch.end(_renderer);
+    }
+    else if (_options.dirtyRects && !_fullRedraw)
+    {
+        /*
+            The window surface still holds the previous frame: restore the static layer where the sprites were
+            and where they are now, and update only those areas.
+        */
+        const SDL_Rect window = { 0, 0, _wWidth, _wHeight };
+        for (int i = 0; i < 3; ++i)
+        {
+            SDL_Rect area;
+            SDL_UnionRect(&_lastSprites[i], &sprites[i], &area);
+            if (SDL_IntersectRect(&area, &window, &area)) _dirtyAreas.push_back(area);
+        }
+        if (_showProfiler) _dirtyAreas.push_back(profilerArea());
+        for (const SDL_Rect& area : _dirtyAreas) SDL_RenderCopy(_renderer, _staticLayer, &area, &area);
+    }
+    else
+    {
+        SDL_RenderCopy(_renderer, _staticLayer, nullptr, nullptr);
+        _dirtyAreas.push_back({ 0, 0, _wWidth, _wHeight });
+    }
+    _fullRedraw = false;
+
+    _batch.begin(_atlas);
+    _batch.draw(_padSprite, leftPlayer);
+    _batch.draw(_padSprite, rightPlayer);
+    _batch.draw(_ballSprite, ballPosition);
+    _batch.end(_renderer);
+    for (int i = 0; i < 3; ++i) _lastSprites[i] = sprites[i];
+
+    if (_showProfiler) renderProfiler();
+}
+
+void Game::present()
+{
+    if (!_options.dirtyRects)
+    {
+        SDL_RenderPresent(_renderer);
+        return;
+    }
+
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+    /* Execute the batched draw calls before reading the surface. */
+    SDL_RenderFlush(_renderer);
+#endif
+    if (!_dirtyAreas.empty()) SDL_UpdateWindowSurfaceRects(_window, _dirtyAreas.data(), static_cast<int>(_dirtyAreas.size()));
+}
+
+SDL_Rect Game::profilerArea() const
+{
+    return { 0, 0, PROFILER_MARGIN + PROFILER_LABEL_WIDTH + PROFILER_BAR_WIDTH + 3 * PROFILER_COLUMN_WIDTH + PROFILER_MARGIN,
+             2 * PROFILER_MARGIN + ZONE_COUNT * PROFILER_ROW_HEIGHT };
+}
+
+void Game::renderProfiler()
+{
+    const SDL_Color barColours[ZONE_COUNT] = { { 80, 160, 255, 255 }, { 80, 220, 120, 255 }, { 240, 200, 60, 255 }, { 220, 90, 220, 255 }, { 240, 80, 80, 255 } };
+    const float pixelsPerMicrosecond = PROFILER_BAR_WIDTH / 16667.0f;
+    int barX = PROFILER_MARGIN + PROFILER_LABEL_WIDTH;
+    int columnsX = barX + PROFILER_BAR_WIDTH + PROFILER_COLUMN_WIDTH;
+    int textHeight = PROFILER_TEXT_HEIGHT;
+
+    /* Background and bars. */
+    SDL_Rect background = profilerArea();
+    SDL_SetRenderDrawBlendMode(_renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(_renderer, 0, 0, 0, 192);
+    SDL_RenderFillRect(_renderer, &background);
+    for (int zone = 0; zone < ZONE_COUNT; ++zone)
+    {
+        int y = PROFILER_MARGIN + zone * PROFILER_ROW_HEIGHT;
+        SDL_Rect bar = { barX, y + 4, static_cast<int>(_profiler.getLast(zone) * pixelsPerMicrosecond), PROFILER_ROW_HEIGHT - 8 };
+        SDL_Rect p99 = { barX + static_cast<int>(_profiler.getPercentile(zone, 99.0) * pixelsPerMicrosecond), y + 2, 2, PROFILER_ROW_HEIGHT - 4 };
+        if (bar.w > PROFILER_BAR_WIDTH) bar.w = PROFILER_BAR_WIDTH;
+        if (p99.x > barX + PROFILER_BAR_WIDTH) p99.x = barX + PROFILER_BAR_WIDTH;
+        SDL_SetRenderDrawColor(_renderer, barColours[zone].r, barColours[zone].g, barColours[zone].b, barColours[zone].a);
+        SDL_RenderFillRect(_renderer, &bar);
+        SDL_SetRenderDrawColor(_renderer, 255, 255, 255, 255);
+        SDL_RenderFillRect(_renderer, &p99);
+    }
+    SDL_SetRenderDrawBlendMode(_renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(_renderer, DEFAULT_RED, DEFAULT_GREEN, DEFAULT_BLUE, DEFAULT_ALPHA);
+
+    /* Names and statistics. */
+    _batch.begin(_atlas);
+    for (int zone = 0; zone < ZONE_COUNT; ++zone)
+    {
+        int y = PROFILER_MARGIN + zone * PROFILER_ROW_HEIGHT + 2;
+        const SDL_Rect& name = _atlas.getRegion(_zoneSprites[zone]);
+        SDL_Rect nameRect = { PROFILER_MARGIN, y, name.w * textHeight / name.h, textHeight };
+        _batch.draw(_zoneSprites[zone], nameRect);
+        drawNumber(static_cast<std::uint32_t>(_profiler.getPercentile(zone, 50.0)), columnsX, y, textHeight, true);
+        drawNumber(static_cast<std::uint32_t>(_profiler.getPercentile(zone, 99.0)), columnsX + PROFILER_COLUMN_WIDTH, y, textHeight, true);
+        drawNumber(static_cast<std::uint32_t>(_profiler.getMaximum(zone)), columnsX + 2 * PROFILER_COLUMN_WIDTH, y, textHeight, true);
+    }
+    _batch.end(_renderer);
 }
@@ -0,0 +1,445 @@
+#include "../include/GameServer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#else
+#include <sys/select.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+static const int MAX_PACKETS_PER_WAKE = 1024; /* Datagrams handled before checking the tick schedule again. */
+
+static std::uint64_t playerKey(const UdpAddress& address)
+{
+    return (static_cast<std::uint64_t>(address.host) << 16) | address.port;
+}
+
+static double toSeconds(Clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+void ServerMetrics::reset()
+{
+    seconds = 0.0;
+    busySeconds = 0.0;
+    tickSeconds = 0.0;
+    ticks = 0;
+    lateTicks = 0;
+    roomTicks = 0;
+    packetsIn = 0;
+    packetsOut = 0;
+    matchesStarted = 0;
+    matchesFinished = 0;
+    maxTickTime = 0;
+    std::fill(tickTimes.begin(), tickTimes.end(), 0);
+}
+
+void ServerMetrics::merge(const ServerMetrics& other)
+{
+    seconds += other.seconds;
+    busySeconds += other.busySeconds;
+    tickSeconds += other.tickSeconds;
+    ticks += other.ticks;
+    lateTicks += other.lateTicks;
+    roomTicks += other.roomTicks;
+    packetsIn += other.packetsIn;
+    packetsOut += other.packetsOut;
+    matchesStarted += other.matchesStarted;
+    matchesFinished += other.matchesFinished;
+    rooms += other.rooms;
+    waitingPlayers += other.waitingPlayers;
+    maxTickTime = std::max(maxTickTime, other.maxTickTime);
+    if (tickTimes.size() < other.tickTimes.size()) tickTimes.resize(other.tickTimes.size(), 0);
+    for (std::size_t i = 0; i < other.tickTimes.size(); ++i) tickTimes[i] += other.tickTimes[i];
+}
+
+double ServerMetrics::tickPercentile(double percentile) const
+{
+    if (ticks == 0) return 0.0;
+
+    std::uint64_t rank = static_cast<std::uint64_t>(percentile / 100.0 * (ticks - 1)) + 1;
+    std::uint64_t count = 0;
+    for (std::size_t bucket = 0; bucket < tickTimes.size(); ++bucket)
+    {
+        count += tickTimes[bucket];
+        if (count >= rank) return std::min(static_cast<double>(bucket + 1), static_cast<double>(maxTickTime));
+    }
+    return static_cast<double>(maxTickTime);
+}
+
+double ServerMetrics::roomsPerCore(double tickRate) const
+{
+    /* Everything a shard does, packets included, is charged to the rooms it ticked. */
+    if (roomTicks == 0 || busySeconds <= 0.0) return 0.0;
+    double secondsPerRoomTick = busySeconds / roomTicks;
+    return 1.0 / (secondsPerRoomTick * tickRate);
+}
+
+ServerShard::ServerShard(const ServerSettings& settings, const PongConfig& config, unsigned int index) :
+    _settings(settings),
+    _config(config),
+    _index(index),
+    _running(false),
+    _hasWaiting(false),
+    _waiting{ 0, 0 },
+    _timeoutTicks(static_cast<std::uint64_t>(settings.timeout) * settings.tickRate / 1000),
+    _tick(0),
+    _waitingTick(0),
+    _roomCount(0)
+{
+    _metrics.tickTimes.assign(ServerMetrics::TICK_BUCKETS, 0);
+#if defined(__linux__)
+    _epoll = -1;
+#endif
+}
+
+ServerShard::~ServerShard()
+{
+    stop();
+#if defined(__linux__)
+    if (_epoll >= 0) ::close(_epoll);
+#endif
+}
+
+bool ServerShard::open(std::uint16_t port, bool sharedPort)
+{
+    if (!_socket.open(port, sharedPort)) return false;
+
+#if defined(__linux__)
+    _epoll = epoll_create1(0);
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    if (_epoll < 0 || epoll_ctl(_epoll, EPOLL_CTL_ADD, _socket.handle(), &event) != 0)
+    {
+        printf("Unable to create the event loop of shard %u\n", _index);
+        return false;
+    }
+#endif
+    return true;
+}
+
+void ServerShard::start()
+{
+    _metricsStart = Clock::now();
+    _running = true;
+    _thread = std::thread(&ServerShard::run, this);
+}
+
+void ServerShard::stop()
+{
+    _running = false;
+    if (_thread.joinable()) _thread.join();
+}
+
+std::uint16_t ServerShard::port() const
+{
+    return _socket.localPort();
+}
+
+void ServerShard::collectMetrics(ServerMetrics& metrics)
+{
+    std::lock_guard<std::mutex> lock(_metricsMutex);
+    Clock::time_point now = Clock::now();
+    _metrics.seconds = toSeconds(now - _metricsStart);
+    metrics.merge(_metrics);
+    _metrics.reset();
+    _metricsStart = now;
+}
+
+void ServerShard::run()
+{
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(1000000000ll / _settings.tickRate));
+    Clock::time_point nextTick = Clock::now() + period;
+    while (_running)
+    {
+        Clock::time_point now = Clock::now();
+        if (now < nextTick)
+        {
+            /* Rounded up: a tick starts at most a millisecond late, and the schedule does not drift. */
+            auto left = std::chrono::duration_cast<std::chrono::microseconds>(nextTick - now).count();
+            wait(static_cast<int>((left + 999) / 1000));
+            Clock::time_point woken = Clock::now();
+            receive();
+            _pending.busySeconds += toSeconds(Clock::now() - woken);
+            continue;
+        }
+
+        /* Past a few ticks behind, drop the missed ticks rather than running every room in a burst. */
+        std::uint64_t late = static_cast<std::uint64_t>((now - nextTick) / period);
+        if (late > static_cast<std::uint64_t>(MAX_CATCHUP_TICKS))
+        {
+            _pending.lateTicks += late;
+            nextTick += period * static_cast<Clock::rep>(late);
+        }
+        nextTick += period;
+
+        Clock::time_point tickStart = Clock::now();
+        tick();
+        Clock::time_point tickEnd = Clock::now();
+        std::uint64_t microseconds = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(tickEnd - tickStart).count());
+        double seconds = toSeconds(tickEnd - tickStart);
+
+        std::lock_guard<std::mutex> lock(_metricsMutex);
+        _pending.busySeconds += seconds;
+        _pending.tickSeconds += seconds;
+        ++_pending.ticks;
+        _metrics.merge(_pending);
+        _metrics.rooms = _roomCount;
+        _metrics.waitingPlayers = _hasWaiting ? 1 : 0;
+        _metrics.maxTickTime = std::max(_metrics.maxTickTime, microseconds);
+        ++_metrics.tickTimes[std::min<std::uint64_t>(microseconds, ServerMetrics::TICK_BUCKETS - 1)];
+        _pending.reset();
+    }
+}
+
+void ServerShard::wait(int milliseconds)
+{
+#if defined(__linux__)
+    epoll_event event;
+    epoll_wait(_epoll, &event, 1, milliseconds);
+#else
+    /* Without epoll, select() on the one socket of the shard does the same job. */
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(_socket.handle(), &readable);
+    timeval timeout;
+    timeout.tv_sec = milliseconds / 1000;
+    timeout.tv_usec = (milliseconds % 1000) * 1000;
+    select(static_cast<int>(_socket.handle() + 1), &readable, nullptr, nullptr, &timeout);
+#endif
+}
+
+void ServerShard::receive()
+{
+    ServerPacket packet;
+    UdpAddress from;
+    for (int i = 0; i < MAX_PACKETS_PER_WAKE; ++i)
+    {
+        int size = _socket.receive(from, &packet, sizeof(packet));
+        if (size <= 0) return;
+        ++_pending.packetsIn;
+        if (static_cast<std::size_t>(size) >= offsetof(ServerPacket, state) && packet.magic == SERVER_MAGIC) handle(from, packet);
+    }
+}
+
+void ServerShard::handle(const UdpAddress& from, const ServerPacket& packet)
+{
+    auto found = _players.find(playerKey(from));
+    if (found == _players.end())
+    {
+        if (packet.type == SERVER_JOIN) join(from);
+        else if (packet.type == SERVER_LEAVE && _hasWaiting && _waiting == from) _hasWaiting = false;
+        return;
+    }
+
+    std::uint32_t index = found->second;
+    Room& room = _rooms[index];
+    int side = (room.players[1] == from) ? 1 : 0;
+    room.lastSeen[side] = room.tick;
+    switch (packet.type)
+    {
+    case SERVER_JOIN:
+        /* The welcome was lost. */
+        send(from, SERVER_WELCOME, index, side == 1);
+        break;
+    case SERVER_INPUT:
+        if (static_cast<std::int32_t>(packet.sequence - room.sequences[side]) > 0)
+        {
+            /* A player only drives its own pad. */
+            std::uint8_t pad = (side == 1) ? (INPUT_RIGHT_UP | INPUT_RIGHT_DOWN) : (INPUT_LEFT_UP | INPUT_LEFT_DOWN);
+            room.inputs[side] = packet.input & (pad | INPUT_SERVE);
+            room.sequences[side] = packet.sequence;
+        }
+        break;
+    case SERVER_LEAVE:
+        endRoom(index);
+        break;
+    default:
+        break;
+    }
+}
+
+void ServerShard::join(const UdpAddress& player)
+{
+    /* Players are paired in the order they arrive; a waiting player that stopped asking is replaced. */
+    if (_hasWaiting && _waiting == player)
+    {
+        _waitingTick = _tick;
+        return;
+    }
+    if (!_hasWaiting || _tick - _waitingTick > _timeoutTicks)
+    {
+        _hasWaiting = true;
+        _waiting = player;
+        _waitingTick = _tick;
+        return;
+    }
+    if (_freeRooms.empty() && _rooms.size() >= _settings.maxRooms) return;
+
+    std::uint32_t index;
+    if (_freeRooms.empty())
+    {
+        index = static_cast<std::uint32_t>(_rooms.size());
+        _rooms.emplace_back();
+    }
+    else
+    {
+        index = _freeRooms.back();
+        _freeRooms.pop_back();
+    }
+
+    Room& room = _rooms[index];
+    room.players[0] = _waiting;
+    room.players[1] = player;
+    for (int side = 0; side < 2; ++side)
+    {
+        room.inputs[side] = INPUT_NONE;
+        room.sequences[side] = 0;
+        room.lastSeen[side] = 0;
+    }
+    room.tick = 0;
+    resetMatch(room.state, _config);
+    room.active = true;
+
+    _players[playerKey(room.players[0])] = index;
+    _players[playerKey(room.players[1])] = index;
+    _hasWaiting = false;
+    ++_roomCount;
+    ++_pending.matchesStarted;
+    send(room.players[0], SERVER_WELCOME, index, false);
+    send(room.players[1], SERVER_WELCOME, index, true);
+}
+
+void ServerShard::tick()
+{
+    ++_tick;
+    std::uint64_t roomTicks = 0;
+    for (std::uint32_t index = 0; index < _rooms.size(); ++index)
+    {
+        Room& room = _rooms[index];
+        if (!room.active) continue;
+
+        step(room.state, _config, combineInputs(room.state, room.inputs[0], room.inputs[1]));
+        ++room.tick;
+        ++roomTicks;
+
+        bool won = _settings.goalsToWin > 0 && (room.state.leftScore >= _settings.goalsToWin || room.state.rightScore >= _settings.goalsToWin);
+        bool gone = room.tick - room.lastSeen[0] > _timeoutTicks || room.tick - room.lastSeen[1] > _timeoutTicks;
+        if (won || gone)
+        {
+            endRoom(index);
+            continue;
+        }
+        if (room.tick % _settings.snapshotInterval == 0)
+        {
+            send(room.players[0], SERVER_STATE, index, false);
+            send(room.players[1], SERVER_STATE, index, true);
+        }
+    }
+    _pending.roomTicks += roomTicks;
+}
+
+void ServerShard::endRoom(std::uint32_t index)
+{
+    Room& room = _rooms[index];
+    send(room.players[0], SERVER_END, index, false);
+    send(room.players[1], SERVER_END, index, true);
+    _players.erase(playerKey(room.players[0]));
+    _players.erase(playerKey(room.players[1]));
+    room.active = false;
+    _freeRooms.push_back(index);
+    --_roomCount;
+    ++_pending.matchesFinished;
+}
+
+void ServerShard::send(const UdpAddress& to, ServerPacketType type, std::uint32_t index, bool rightSide)
+{
+    const Room& room = _rooms[index];
+    ServerPacket packet;
+    packet.magic = SERVER_MAGIC;
+    packet.type = type;
+    packet.rightSide = rightSide ? 1 : 0;
+    packet.input = INPUT_NONE;
+    packet.reserved = 0;
+    packet.room = index;
+    packet.sequence = room.sequences[rightSide ? 1 : 0];
+    packet.tick = room.tick;
+    packet.state = room.state;
+    if (_socket.send(to, &packet, sizeof(packet))) ++_pending.packetsOut;
+}
+
+GameServer::GameServer(const ServerSettings& settings) :
+    _settings(settings)
+{
+    if (_settings.shards == 0) _settings.shards = std::thread::hardware_concurrency();
+    if (_settings.shards == 0) _settings.shards = 1;
+    if (_settings.tickRate == 0) _settings.tickRate = 240;
+    if (_settings.snapshotInterval == 0) _settings.snapshotInterval = 1;
+}
+
+GameServer::~GameServer()
+{
+    stop();
+}
+
+bool GameServer::start()
+{
+    /* The same geometry and speeds as a match of the game at this tick rate. */
+    PongLayout layout;
+    layout.tickRate = _settings.tickRate;
+    PongConfig config = makeConfig(layout);
+
+    for (unsigned int i = 0; i < _settings.shards; ++i)
+    {
+        _shards.emplace_back(new ServerShard(_settings, config, i));
+#if defined(__linux__)
+        bool opened = _shards.back()->open(_settings.port, true);
+#else
+        bool opened = _shards.back()->open(static_cast<std::uint16_t>(_settings.port + i), false);
+#endif
+        if (!opened)
+        {
+            _shards.clear();
+            return false;
+        }
+    }
+    for (auto& shard : _shards) shard->start();
+    return true;
+}
+
+void GameServer::stop()
+{
+    for (auto& shard : _shards) shard->stop();
+}
+
+unsigned int GameServer::shardCount() const
+{
+    return static_cast<unsigned int>(_shards.size());
+}
+
+std::uint16_t GameServer::shardPort(unsigned int shard) const
+{
+    return _shards[shard]->port();
+}
+
+ServerMetrics GameServer::collectMetrics()
+{
+    ServerMetrics metrics;
+    metrics.tickTimes.assign(ServerMetrics::TICK_BUCKETS, 0);
+    for (auto& shard : _shards) shard->collectMetrics(metrics);
+    return metrics;
+}
@@ -23,7 +23,7 @@ void LTexture::freeTexture()
     }
 }
 
-bool LTexture::loadFromFile(SDL_Renderer* renderer, std::string path)
+bool LTexture::loadFromFile(SDL_Renderer* renderer, const std::string& path)
 {
     SDL_Surface* tempSurface = IMG_Load(path.c_str());
     if (tempSurface == nullptr)
@@ -45,7 +45,7 @@ bool LTexture::loadFromFile(SDL_Renderer* renderer, std::string path)
     return true;
 }
 
-bool LTexture::loadFromRenderedText(SDL_Renderer* renderer, std::string textureText, SDL_Color textColour, TTF_Font* font)
+bool LTexture::loadFromRenderedText(SDL_Renderer* renderer, const std::string& textureText, SDL_Color textColour, TTF_Font* font)
 {
     freeTexture();
 
@@ -70,7 +70,9 @@ bool LTexture::loadFromRenderedText(SDL_Renderer* renderer, std::string textureT
 
 void LTexture::render(SDL_Renderer* renderer, int x, int y, SDL_Rect* clip, SDL_Rect* destRect, double angle, SDL_Point * centre, SDL_RendererFlip flip)
 {
-    SDL_RenderCopyEx(renderer, _texture, clip, destRect, angle, centre, flip);
+    /* The Ex path is only needed to rotate or flip. */
+    if (angle == 0.0 && flip == SDL_FLIP_NONE) SDL_RenderCopy(renderer, _texture, clip, destRect);
+    else SDL_RenderCopyEx(renderer, _texture, clip, destRect, angle, centre, flip);
 }
 
 void LTexture::setColour(Uint8 red, Uint8 green, Uint8 blue)
@@ -0,0 +1,343 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+#include "../include/Controller.h"
+#include "../include/GameServer.h"
+#include "../include/UdpSocket.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/* Load generator settings, from the command line. */
+struct LoadSettings
+{
+    std::string server = "127.0.0.1:27015"; /* Address of the first shard. */
+    unsigned int ports = 1; /* Consecutive server ports to spread the clients over, for servers without a shared port. */
+    unsigned int clients = 1000;
+    unsigned int threads = 4;
+    unsigned int inputRate = 60; /* Inputs sent per second by every client. */
+    double duration = 10.0; /* Seconds. */
+    std::string controller = "follow"; /* Player of every client. */
+};
+
+/* Counters of one thread, collected once per second. */
+struct LoadStats
+{
+    static const int RTT_BUCKETS = 2000; /* Round trips are counted per 100 us up to 200 ms. */
+
+    std::uint64_t packetsIn = 0;
+    std::uint64_t packetsOut = 0;
+    std::uint64_t states = 0;
+    std::uint64_t matches = 0; /* Matches finished. */
+    std::uint64_t playing = 0; /* Clients in a match now, not reset. */
+    std::uint64_t roundTrips = 0;
+    std::vector<std::uint32_t> rttHistogram = std::vector<std::uint32_t>(RTT_BUCKETS, 0);
+
+    void merge(const LoadStats& other)
+    {
+        packetsIn += other.packetsIn;
+        packetsOut += other.packetsOut;
+        states += other.states;
+        matches += other.matches;
+        playing += other.playing;
+        roundTrips += other.roundTrips;
+        for (int i = 0; i < RTT_BUCKETS; ++i) rttHistogram[i] += other.rttHistogram[i];
+    }
+
+    void reset() /* Keeps playing. */
+    {
+        packetsIn = packetsOut = states = matches = roundTrips = 0;
+        std::fill(rttHistogram.begin(), rttHistogram.end(), 0);
+    }
+
+    double rttPercentile(double percentile) const /* In milliseconds. */
+    {
+        if (roundTrips == 0) return 0.0;
+        std::uint64_t rank = static_cast<std::uint64_t>(percentile / 100.0 * (roundTrips - 1)) + 1;
+        std::uint64_t count = 0;
+        for (int bucket = 0; bucket < RTT_BUCKETS; ++bucket)
+        {
+            count += rttHistogram[bucket];
+            if (count >= rank) return (bucket + 1) * 0.1;
+        }
+        return RTT_BUCKETS * 0.1;
+    }
+};
+
+/* One simulated player. */
+struct LoadClient
+{
+    static const int SENT_TIMES = 256; /* Send times of the last inputs, by sequence. */
+
+    UdpSocket socket;
+    UdpAddress server;
+    std::unique_ptr<Controller> controller;
+    bool playing = false;
+    bool rightSide = false;
+    std::uint32_t sequence = 0; /* Last input sent. */
+    std::uint32_t acknowledged = 0; /* Last input the server applied. */
+    Clock::time_point lastJoin;
+    Clock::time_point lastState; /* Of the last SERVER_WELCOME or SERVER_STATE, to notice a lost SERVER_END. */
+    Clock::time_point sentTimes[SENT_TIMES];
+    PongState state;
+};
+
+/* Clients of one thread. */
+struct LoadWorker
+{
+    std::vector<std::unique_ptr<LoadClient>> clients;
+    std::mutex mutex;
+    LoadStats stats; /* Shared under mutex. */
+    std::thread thread;
+};
+
+static std::atomic<bool> running(true);
+
+static void printUsage()
+{
+    printf("Usage: LoadGenerator [--server host:port] [--ports N] [--clients N] [--threads N] [--input-rate N] [--duration s] [--controller name]\n");
+}
+
+static bool parseArguments(int argc, char* args[], LoadSettings& settings)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* option = args[i];
+        const char* value = (i + 1 < argc) ? args[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            printf("Missing value for %s\n", option);
+            return false;
+        }
+        if (strcmp(option, "--server") == 0) settings.server = value;
+        else if (strcmp(option, "--ports") == 0) settings.ports = static_cast<unsigned int>(atoi(value));
+        else if (strcmp(option, "--clients") == 0) settings.clients = static_cast<unsigned int>(atoi(value));
+        else if (strcmp(option, "--threads") == 0) settings.threads = static_cast<unsigned int>(atoi(value));
+        else if (strcmp(option, "--input-rate") == 0) settings.inputRate = static_cast<unsigned int>(atoi(value));
+        else if (strcmp(option, "--duration") == 0) settings.duration = atof(value);
+        else if (strcmp(option, "--controller") == 0) settings.controller = value;
+        else
+        {
+            printf("Unknown option %s\n", option);
+            return false;
+        }
+        ++i;
+    }
+
+    if (createController(settings.controller) == nullptr)
+    {
+        printf("Unknown controller %s\n", settings.controller.c_str());
+        return false;
+    }
+    if (settings.clients == 0 || settings.threads == 0 || settings.ports == 0 || settings.inputRate == 0)
+    {
+        printf("At least one client, thread, port and input per second are required\n");
+        return false;
+    }
+    return true;
+}
+
+/* Every client needs its own socket: raise the limit of open files to what the system allows. */
+static void raiseFileLimit()
+{
+#if defined(__linux__)
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+#endif
+}
+
+static void sendPacket(LoadClient& client, ServerPacketType type, std::uint8_t input, LoadStats& stats)
+{
+    ServerPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.magic = SERVER_MAGIC;
+    packet.type = type;
+    packet.input = input;
+    packet.room = SERVER_NO_ROOM;
+    packet.sequence = client.sequence;
+    if (client.socket.send(client.server, &packet, sizeof(packet))) ++stats.packetsOut;
+}
+
+static void receivePackets(LoadClient& client, LoadStats& stats)
+{
+    ServerPacket packet;
+    UdpAddress from;
+    int size;
+    while ((size = client.socket.receive(from, &packet, sizeof(packet))) > 0)
+    {
+        /* Timestamped one by one: the packets of the whole loop would otherwise share a time. */
+        Clock::time_point now = Clock::now();
+        ++stats.packetsIn;
+        if (static_cast<std::size_t>(size) < sizeof(packet) || packet.magic != SERVER_MAGIC) continue;
+
+        switch (packet.type)
+        {
+        case SERVER_WELCOME:
+            if (!client.playing)
+            {
+                client.playing = true;
+                client.rightSide = packet.rightSide != 0;
+                client.acknowledged = client.sequence;
+                client.state = packet.state;
+                client.lastState = now;
+            }
+            break;
+        case SERVER_STATE:
+            /* Round trip of the newest input the server applied, measured once. */
+            if (client.playing && static_cast<std::int32_t>(packet.sequence - client.acknowledged) > 0 && client.sequence - packet.sequence < LoadClient::SENT_TIMES)
+            {
+                client.acknowledged = packet.sequence;
+                auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(now - client.sentTimes[packet.sequence % LoadClient::SENT_TIMES]).count();
+                ++stats.rttHistogram[std::min<long long>(microseconds / 100, LoadStats::RTT_BUCKETS - 1)];
+                ++stats.roundTrips;
+            }
+            client.state = packet.state;
+            client.lastState = now;
+            ++stats.states;
+            break;
+        case SERVER_END:
+            if (client.playing)
+            {
+                client.playing = false;
+                ++stats.matches;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void runWorker(LoadWorker& worker, const LoadSettings& settings, const PongConfig& config)
+{
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(1000000000ll / settings.inputRate));
+    const Clock::duration joinInterval = std::chrono::milliseconds(500);
+    const Clock::duration stateTimeout = std::chrono::seconds(2); /* Without a state the match is taken as over, its SERVER_END lost. */
+    LoadStats stats; /* Since the last publication. */
+    Clock::time_point next = Clock::now();
+    while (running)
+    {
+        std::this_thread::sleep_until(next);
+        next += period;
+
+        Clock::time_point now = Clock::now();
+        std::uint64_t playing = 0;
+        for (auto& client : worker.clients)
+        {
+            receivePackets(*client, stats);
+            now = Clock::now();
+            if (client->playing && now - client->lastState >= stateTimeout) client->playing = false;
+            if (client->playing) ++playing;
+            if (!client->playing)
+            {
+                if (now - client->lastJoin >= joinInterval)
+                {
+                    sendPacket(*client, SERVER_JOIN, INPUT_NONE, stats);
+                    client->lastJoin = now;
+                }
+                continue;
+            }
+
+            ControllerAction action = client->controller->act(client->state, config, client->rightSide);
+            ++client->sequence;
+            client->sentTimes[client->sequence % LoadClient::SENT_TIMES] = now;
+            sendPacket(*client, SERVER_INPUT, toInput(action, client->rightSide), stats);
+        }
+
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.stats.merge(stats);
+        worker.stats.playing = playing;
+        stats.reset();
+    }
+
+    /* Let the server free the rooms now rather than after its timeout. */
+    for (auto& client : worker.clients)
+    {
+        if (client->playing) sendPacket(*client, SERVER_LEAVE, INPUT_NONE, stats);
+    }
+}
+
+int main(int argc, char* args[])
+{
+    LoadSettings settings;
+    if (!parseArguments(argc, args, settings))
+    {
+        printUsage();
+        return -1;
+    }
+
+    UdpAddress server;
+    if (!resolveAddress(settings.server, server)) return -1;
+    raiseFileLimit();
+
+    /* Clients are dealt to the threads in turn, and to the server ports in turn. */
+    std::vector<std::unique_ptr<LoadWorker>> workers;
+    for (unsigned int i = 0; i < settings.threads; ++i) workers.emplace_back(new LoadWorker());
+    unsigned int opened = 0;
+    for (; opened < settings.clients; ++opened)
+    {
+        std::unique_ptr<LoadClient> client(new LoadClient());
+        if (!client->socket.open(0)) break;
+        client->server = { server.host, static_cast<std::uint16_t>(server.port + opened % settings.ports) };
+        client->controller = createController(settings.controller);
+        client->controller->reset(opened + 1);
+        workers[opened % settings.threads]->clients.push_back(std::move(client));
+    }
+    if (opened < settings.clients) printf("Only %u clients could be created\n", opened);
+    if (opened == 0) return -1;
+
+    PongLayout layout;
+    PongConfig config = makeConfig(layout);
+    for (auto& worker : workers)
+    {
+        LoadWorker* current = worker.get();
+        current->thread = std::thread([current, &settings, &config]() { runWorker(*current, settings, config); });
+    }
+
+    LoadStats total;
+    auto start = Clock::now();
+    auto lastReport = start;
+    while (std::chrono::duration<double>(Clock::now() - start).count() < settings.duration)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        Clock::time_point now = Clock::now();
+        double seconds = std::chrono::duration<double>(now - lastReport).count();
+        lastReport = now;
+
+        LoadStats interval;
+        for (auto& worker : workers)
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            interval.merge(worker->stats);
+            worker->stats.reset();
+        }
+        printf("%llu/%u clients playing, %.0f states/s, %.0f/%.0f packets/s in/out, input round trip p50 %.1f ms p99 %.1f ms, %llu matches finished\n",
+               static_cast<unsigned long long>(interval.playing), opened, interval.states / seconds, interval.packetsIn / seconds, interval.packetsOut / seconds,
+               interval.rttPercentile(50.0), interval.rttPercentile(99.0), static_cast<unsigned long long>(interval.matches));
+        total.merge(interval);
+    }
+
+    running = false;
+    for (auto& worker : workers) worker->thread.join();
+    printf("Total: %llu states, %llu matches finished, input round trip p50 %.1f ms p99 %.1f ms\n",
+           static_cast<unsigned long long>(total.states), static_cast<unsigned long long>(total.matches),
+           total.rttPercentile(50.0), total.rttPercentile(99.0));
+    return 0;
+}
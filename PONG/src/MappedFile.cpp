@@ -0,0 +1,130 @@
+#include "../include/MappedFile.h"
+
+#include <stdio.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+    _data(nullptr),
+    _size(0),
+#if defined(_WIN32)
+    _file(INVALID_HANDLE_VALUE),
+    _mapping(nullptr)
+#else
+    _file(-1)
+#endif
+{}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#if defined(_WIN32)
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE)
+    {
+        printf("Unable to open %s\n", path.c_str());
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_file, &size))
+    {
+        printf("Unable to read the size of %s\n", path.c_str());
+        close();
+        return false;
+    }
+    _size = static_cast<std::size_t>(size.QuadPart);
+    if (_size == 0) return true;
+
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping == nullptr)
+    {
+        printf("Unable to map %s\n", path.c_str());
+        close();
+        return false;
+    }
+    _data = static_cast<const unsigned char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (_data == nullptr)
+    {
+        printf("Unable to map %s\n", path.c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data != nullptr) UnmapViewOfFile(_data);
+    if (_mapping != nullptr) CloseHandle(_mapping);
+    if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+    _data = nullptr;
+    _size = 0;
+    _mapping = nullptr;
+    _file = INVALID_HANDLE_VALUE;
+}
+#else
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    _file = ::open(path.c_str(), O_RDONLY);
+    if (_file < 0)
+    {
+        printf("Unable to open %s\n", path.c_str());
+        return false;
+    }
+    struct stat info;
+    if (fstat(_file, &info) != 0)
+    {
+        printf("Unable to read the size of %s\n", path.c_str());
+        close();
+        return false;
+    }
+    _size = static_cast<std::size_t>(info.st_size);
+    if (_size == 0) return true;
+
+    void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+    if (data == MAP_FAILED)
+    {
+        printf("Unable to map %s\n", path.c_str());
+        close();
+        return false;
+    }
+    _data = static_cast<const unsigned char*>(data);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data != nullptr) munmap(const_cast<unsigned char*>(_data), _size);
+    if (_file >= 0) ::close(_file);
+    _data = nullptr;
+    _size = 0;
+    _file = -1;
+}
+#endif
+
+const unsigned char* MappedFile::data() const
+{
+    return _data;
+}
+
+std::size_t MappedFile::size() const
+{
+    return _size;
+}
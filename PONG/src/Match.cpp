@@ -0,0 +1,35 @@
+#include "../include/Match.h"
+
+MatchResult playMatch(const PongConfig& config, Controller& left, Controller& right, int goalsToWin, std::uint64_t maxTicks, std::uint32_t seed)
+{
+    MatchResult result = {};
+    left.reset(seed);
+    right.reset(seed ^ 0x9E3779B9u);
+
+    PongState state;
+    resetMatch(state, config);
+    std::uint32_t rallyHits = 0;
+    while (result.ticks < maxTicks && state.leftScore < goalsToWin && state.rightScore < goalsToWin)
+    {
+        /* Only the player holding the ball can serve. */
+        ControllerAction leftAction = left.act(state, config, false);
+        ControllerAction rightAction = right.act(state, config, true);
+        leftAction.serve = leftAction.serve && state.lock && !state.lockSide;
+        rightAction.serve = rightAction.serve && state.lock && state.lockSide;
+
+        std::uint8_t events = step(state, config, toInput(leftAction, false) | toInput(rightAction, true));
+        ++result.ticks;
+
+        if (events & EVENT_PAD_HIT) ++rallyHits;
+        if (events & (EVENT_LEFT_SCORED | EVENT_RIGHT_SCORED))
+        {
+            ++result.rallies;
+            result.rallyHits += rallyHits;
+            if (rallyHits > result.longestRally) result.longestRally = rallyHits;
+            rallyHits = 0;
+        }
+    }
+    result.leftScore = state.leftScore;
+    result.rightScore = state.rightScore;
+    return result;
+}
@@ -0,0 +1,417 @@
+#include "../include/Netplay.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cstddef>
+
+static const std::size_t PACKET_HEADER = offsetof(NetplayPacket, inputs); /* Bytes of a packet before its inputs. */
+static const std::int64_t SYNC_TOLERANCE = 2; /* Ticks this side can run ahead of the peer before it waits. */
+static const std::uint32_t SYNC_WAIT_SPACING = 4; /* Ticks between two waits, so that catching up slows the match down without freezing it. */
+
+/* FNV-1a of the table geometry, the two sides must agree on it. */
+static std::uint32_t hashConfig(const PongConfig& config)
+{
+    const std::int32_t* words = &config.tableWidth;
+    std::uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < sizeof(PongConfig) / sizeof(std::int32_t); ++i)
+    {
+        hash ^= static_cast<std::uint32_t>(words[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Keep the pad bits of one side whichever keys were used, so that both key sets move the local pad. */
+static std::uint8_t sideInput(std::uint8_t inputs, bool rightSide)
+{
+    bool up = (inputs & (INPUT_LEFT_UP | INPUT_RIGHT_UP)) != 0;
+    bool down = (inputs & (INPUT_LEFT_DOWN | INPUT_RIGHT_DOWN)) != 0;
+    std::uint8_t result = inputs & INPUT_SERVE;
+    if (up) result |= rightSide ? INPUT_RIGHT_UP : INPUT_LEFT_UP;
+    if (down) result |= rightSide ? INPUT_RIGHT_DOWN : INPUT_LEFT_DOWN;
+    return result;
+}
+
+LinkSimulator::LinkSimulator(const LinkSettings& settings) :
+    _settings(settings),
+    _random(settings.seed != 0 ? settings.seed : 1)
+{
+    _packets.reserve(CAPACITY);
+}
+
+std::uint32_t LinkSimulator::nextRandom()
+{
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return _random;
+}
+
+void LinkSimulator::send(UdpSocket& socket, const UdpAddress& to, const void* data, std::size_t size, std::uint32_t now)
+{
+    if (_settings.lossPercent > 0 && static_cast<int>(nextRandom() % 100) < _settings.lossPercent) return;
+
+    std::uint32_t delay = _settings.latency;
+    if (_settings.jitter > 0) delay += nextRandom() % (_settings.jitter + 1);
+    if (delay == 0)
+    {
+        socket.send(to, data, size);
+        return;
+    }
+
+    /* Beyond the capacity the packet is lost, as on a congested link. */
+    if (size > sizeof(HeldPacket::data) || _packets.size() >= CAPACITY) return;
+    _packets.emplace_back();
+    HeldPacket& packet = _packets.back();
+    packet.time = now + delay;
+    packet.to = to;
+    packet.size = size;
+    memcpy(packet.data, data, size);
+}
+
+void LinkSimulator::flush(UdpSocket& socket, std::uint32_t now)
+{
+    std::size_t i = 0;
+    while (i < _packets.size())
+    {
+        if (static_cast<std::int32_t>(now - _packets[i].time) < 0)
+        {
+            ++i;
+            continue;
+        }
+        socket.send(_packets[i].to, _packets[i].data, _packets[i].size);
+        std::swap(_packets[i], _packets.back());
+        _packets.pop_back();
+    }
+}
+
+RollbackSession::RollbackSession(const NetplaySettings& settings) :
+    _settings(settings),
+    _link(settings.link),
+    _peer{ 0, 0 },
+    _hasPeer(false),
+    _rightSide(false),
+    _config(),
+    _configHash(0),
+    _tickRate(240)
+{
+    /* A rollback must never reach states the ring has overwritten. */
+    _settings.inputDelay = std::max(0, std::min(_settings.inputDelay, 8));
+    _settings.maxRollback = std::max(1, std::min(_settings.maxRollback, static_cast<int>(NETPLAY_HISTORY / 4)));
+    reset();
+}
+
+void RollbackSession::reset()
+{
+    _tick = 0;
+    _localCount = 0;
+    _remoteCount = 0;
+    _peerAck = 0;
+    _mispredicted = false;
+    _rollbackTick = 0;
+    _popped = 0;
+    _connected = false;
+    _lastReceive = 0;
+    _lastSend = 0;
+    _echoTime = 0;
+    _remoteTick = 0;
+    _roundTrip = 0;
+    _lastSyncWait = 0;
+    _checkPending = false;
+    _checkTick = 0;
+    _checkHash = 0;
+    _rollbacks = 0;
+    _rollbackTicks = 0;
+    _maxRollback = 0;
+    _waitedTicks = 0;
+    _desyncs = 0;
+}
+
+bool RollbackSession::host(std::uint16_t port)
+{
+    _rightSide = false;
+    _hasPeer = false;
+    return _socket.open(port);
+}
+
+bool RollbackSession::connect(const std::string& address)
+{
+    _rightSide = true;
+    _hasPeer = resolveAddress(address, _peer);
+    if (!_hasPeer) return false;
+    return _socket.open(0);
+}
+
+std::uint16_t RollbackSession::localPort() const
+{
+    return _socket.localPort();
+}
+
+void RollbackSession::start(const PongConfig& config, const PongState& state, std::uint32_t tickRate)
+{
+    reset();
+    _config = config;
+    _configHash = hashConfig(config);
+    _tickRate = tickRate;
+    _states[0] = state;
+
+    /* The first ticks have no local input from before the match. */
+    for (int i = 0; i < _settings.inputDelay; ++i) _localInputs[_localCount++ & MASK] = INPUT_NONE;
+}
+
+bool RollbackSession::advance(std::uint8_t localInputs)
+{
+    std::uint32_t now = networkTime();
+    poll(now);
+    _link.flush(_socket, now);
+
+    if (!_connected)
+    {
+        if (_hasPeer && now - _lastSend >= NETPLAY_SYNC_INTERVAL) sendPacket(NETPLAY_SYNC, now);
+        return false;
+    }
+
+    /* Correct the ticks simulated with a wrong prediction. */
+    if (_mispredicted)
+    {
+        std::uint32_t depth = _tick - _rollbackTick;
+        for (std::uint32_t tick = _rollbackTick; tick < _tick; ++tick) simulate(tick);
+        _mispredicted = false;
+        ++_rollbacks;
+        _rollbackTicks += depth;
+        _maxRollback = std::max(_maxRollback, depth);
+    }
+    checkDesync();
+
+    /* Too far ahead of the last known remote input, or of the peer's clock: let it catch up. */
+    bool wait = _tick >= _remoteCount + static_cast<std::uint32_t>(_settings.maxRollback);
+    if (!wait && _tick - _lastSyncWait >= SYNC_WAIT_SPACING && aheadOfPeer(now))
+    {
+        _lastSyncWait = _tick;
+        wait = true;
+    }
+    if (wait)
+    {
+        ++_waitedTicks;
+        sendPacket(NETPLAY_INPUTS, now);
+        return false;
+    }
+
+    _localInputs[_localCount++ & MASK] = sideInput(localInputs, _rightSide);
+    simulate(_tick);
+    ++_tick;
+    sendPacket(NETPLAY_INPUTS, now);
+    return true;
+}
+
+bool RollbackSession::popConfirmed(PongState& state, std::uint8_t& inputs)
+{
+    if (_popped >= std::min(_remoteCount, _tick)) return false;
+
+    std::uint32_t slot = _popped & MASK;
+    state = _states[slot];
+    std::uint8_t left = _rightSide ? _remoteInputs[slot] : _localInputs[slot];
+    std::uint8_t right = _rightSide ? _localInputs[slot] : _remoteInputs[slot];
+    inputs = combineInputs(state, left, right);
+    ++_popped;
+    return true;
+}
+
+const PongState& RollbackSession::confirmedState() const
+{
+    return _states[_popped & MASK];
+}
+
+bool RollbackSession::isRightSide() const
+{
+    return _rightSide;
+}
+
+bool RollbackSession::isConnected() const
+{
+    return _connected && networkTime() - _lastReceive < NETPLAY_TIMEOUT;
+}
+
+std::uint32_t RollbackSession::tick() const
+{
+    return _tick;
+}
+
+const PongState& RollbackSession::state() const
+{
+    return _states[_tick & MASK];
+}
+
+std::uint64_t RollbackSession::getRollbacks() const
+{
+    return _rollbacks;
+}
+
+std::uint64_t RollbackSession::getRollbackTicks() const
+{
+    return _rollbackTicks;
+}
+
+std::uint32_t RollbackSession::getMaxRollback() const
+{
+    return _maxRollback;
+}
+
+std::uint64_t RollbackSession::getWaitedTicks() const
+{
+    return _waitedTicks;
+}
+
+std::uint32_t RollbackSession::getRoundTrip() const
+{
+    return _roundTrip;
+}
+
+std::uint64_t RollbackSession::getDesyncs() const
+{
+    return _desyncs;
+}
+
+void RollbackSession::poll(std::uint32_t now)
+{
+    NetplayPacket packet;
+    UdpAddress from;
+    int size;
+    while ((size = _socket.receive(from, &packet, sizeof(packet))) > 0)
+    {
+        /* The host plays against the first client that speaks to it, anybody else is ignored. */
+        if (!_hasPeer)
+        {
+            _peer = from;
+            _hasPeer = true;
+        }
+        if (!(from == _peer)) continue;
+        receive(packet, static_cast<std::size_t>(size), now);
+    }
+}
+
+void RollbackSession::receive(const NetplayPacket& packet, std::size_t size, std::uint32_t now)
+{
+    if (size < PACKET_HEADER || packet.magic != NETPLAY_MAGIC || packet.version != NETPLAY_VERSION) return;
+    if (packet.inputCount > NETPLAY_PACKET_INPUTS || size < PACKET_HEADER + packet.inputCount) return;
+    if (packet.configHash != _configHash)
+    {
+        if (!_connected && now - _lastReceive >= NETPLAY_TIMEOUT) printf("The peer plays on a different table\n");
+        _lastReceive = now;
+        return;
+    }
+
+    /* Round trip: our packet left at echoTime and the peer held it for echoDelay. */
+    if (packet.echoTime != 0)
+    {
+        std::uint32_t sample = now - packet.echoTime - packet.echoDelay;
+        if (sample < NETPLAY_TIMEOUT) _roundTrip = (_roundTrip == 0) ? sample : (_roundTrip * 7 + sample) / 8;
+    }
+    if (!_connected || static_cast<std::int32_t>(packet.sendTime - _echoTime) > 0)
+    {
+        _echoTime = packet.sendTime;
+        _remoteTick = packet.tick;
+        _lastReceive = now;
+    }
+    _connected = true;
+
+    if (packet.ackTick > _peerAck) _peerAck = std::min(packet.ackTick, _localCount);
+
+    /* Inputs are taken in order only; the ones after a gap come again in the next packets. */
+    for (std::uint32_t i = 0; i < packet.inputCount; ++i)
+    {
+        std::uint32_t tick = packet.firstTick + i;
+        if (tick < _remoteCount) continue;
+        if (tick > _remoteCount || tick >= _tick + NETPLAY_HISTORY / 2) break;
+
+        std::uint32_t slot = tick & MASK;
+        std::uint8_t input = packet.inputs[i];
+        if (tick < _tick && _remoteInputs[slot] != input)
+        {
+            if (!_mispredicted || tick < _rollbackTick) _rollbackTick = tick;
+            _mispredicted = true;
+        }
+        _remoteInputs[slot] = input;
+        ++_remoteCount;
+    }
+
+    if (packet.checkTick > _checkTick || !_checkPending)
+    {
+        _checkPending = true;
+        _checkTick = packet.checkTick;
+        _checkHash = packet.checkHash;
+    }
+}
+
+void RollbackSession::sendPacket(NetplayPacketType type, std::uint32_t now)
+{
+    if (!_hasPeer) return;
+
+    NetplayPacket packet;
+    packet.magic = NETPLAY_MAGIC;
+    packet.version = NETPLAY_VERSION;
+    packet.type = type;
+    packet.configHash = _configHash;
+    packet.tick = _tick;
+    packet.ackTick = _remoteCount;
+    packet.sendTime = (now != 0) ? now : 1;
+    packet.echoTime = _echoTime;
+    packet.echoDelay = now - _lastReceive;
+    packet.checkTick = std::min(_remoteCount, _tick);
+    packet.checkHash = hashState(_states[packet.checkTick & MASK]);
+
+    /* Repeat every local input the peer has not acknowledged, as many as fit. */
+    std::uint32_t count = (type == NETPLAY_INPUTS) ? _localCount - _peerAck : 0;
+    count = std::min(count, static_cast<std::uint32_t>(NETPLAY_PACKET_INPUTS));
+    packet.firstTick = _peerAck;
+    packet.inputCount = static_cast<std::uint8_t>(count);
+    for (std::uint32_t i = 0; i < count; ++i) packet.inputs[i] = _localInputs[(_peerAck + i) & MASK];
+
+    _link.send(_socket, _peer, &packet, PACKET_HEADER + count, now);
+    _lastSend = now;
+}
+
+void RollbackSession::simulate(std::uint32_t tick)
+{
+    std::uint32_t slot = tick & MASK;
+
+    /*
+        The remote pad is predicted to keep its last known direction. The serve is never predicted: a wrong serve
+        would be the most visible correction.
+    */
+    if (tick >= _remoteCount)
+    {
+        std::uint8_t last = (_remoteCount > 0) ? _remoteInputs[(_remoteCount - 1) & MASK] : static_cast<std::uint8_t>(INPUT_NONE);
+        _remoteInputs[slot] = last & ~INPUT_SERVE;
+    }
+
+    PongState state = _states[slot];
+    std::uint8_t left = _rightSide ? _remoteInputs[slot] : _localInputs[slot];
+    std::uint8_t right = _rightSide ? _localInputs[slot] : _remoteInputs[slot];
+    step(state, _config, combineInputs(state, left, right));
+    _states[(tick + 1) & MASK] = state;
+}
+
+void RollbackSession::checkDesync()
+{
+    /* The peer's state is compared once every input before it is known here too. */
+    if (!_checkPending || _checkTick > _remoteCount || _checkTick > _tick) return;
+    _checkPending = false;
+    if (_checkTick + NETPLAY_HISTORY / 2 < _tick) return;
+
+    if (hashState(_states[_checkTick & MASK]) != _checkHash)
+    {
+        if (_desyncs == 0) printf("The match diverged from the peer at tick %u\n", _checkTick);
+        ++_desyncs;
+    }
+}
+
+bool RollbackSession::aheadOfPeer(std::uint32_t now) const
+{
+    /* Tick of the peer now: its tick in the last packet, plus the ticks since it was sent. */
+    std::uint32_t elapsed = now - _lastReceive + _roundTrip / 2;
+    std::int64_t remoteTick = _remoteTick + static_cast<std::int64_t>(elapsed) * _tickRate / 1000;
+    return static_cast<std::int64_t>(_tick) - remoteTick > SYNC_TOLERANCE;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/Controller.h"
+#include "../include/Netplay.h"
+#include "../include/PongState.h"
+
+static void printUsage()
+{
+    printf("Usage: NetplayTest [--seconds N] [--net-latency ms] [--net-jitter ms] [--net-loss percent] [--net-delay ticks] [--net-rollback ticks]\n");
+}
+
+static bool parseArguments(int argc, char* args[], NetplaySettings& settings, int& seconds)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* option = args[i];
+        const char* value = (i + 1 < argc) ? args[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            printf("Missing value for %s\n", option);
+            return false;
+        }
+        if (strcmp(option, "--seconds") == 0) seconds = atoi(value);
+        else if (strcmp(option, "--net-latency") == 0) settings.link.latency = static_cast<std::uint32_t>(strtoul(value, nullptr, 10));
+        else if (strcmp(option, "--net-jitter") == 0) settings.link.jitter = static_cast<std::uint32_t>(strtoul(value, nullptr, 10));
+        else if (strcmp(option, "--net-loss") == 0) settings.link.lossPercent = atoi(value);
+        else if (strcmp(option, "--net-delay") == 0) settings.inputDelay = atoi(value);
+        else if (strcmp(option, "--net-rollback") == 0) settings.maxRollback = atoi(value);
+        else
+        {
+            printf("Unknown option %s\n", option);
+            return false;
+        }
+        ++i;
+    }
+
+    if (seconds <= 0)
+    {
+        printf("The test needs at least one second\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+    Play a match between two sessions of this process over loopback, with computer players on both pads, and check
+    that the two sides confirmed the same ticks. The simulated latency and loss apply in both directions.
+*/
+static bool runNetplayTest(const NetplaySettings& settings, int seconds)
+{
+    RollbackSession host(settings);
+    RollbackSession client(settings);
+    if (!host.host(0)) return false;
+    if (!client.connect("127.0.0.1:" + std::to_string(host.localPort()))) return false;
+
+    PongLayout layout;
+    PongConfig config = makeConfig(layout);
+    PongState state;
+    resetMatch(state, config);
+    host.start(config, state, layout.tickRate);
+    client.start(config, state, layout.tickRate);
+
+    std::unique_ptr<Controller> left = createController("ai-hard");
+    std::unique_ptr<Controller> right = createController("random");
+    left->reset(1);
+    right->reset(2);
+
+    /* Hash of every confirmed tick with its inputs, on each side. */
+    std::vector<std::uint64_t> hostTicks;
+    std::vector<std::uint64_t> clientTicks;
+    std::uint64_t ticks = static_cast<std::uint64_t>(seconds) * layout.tickRate;
+    hostTicks.reserve(ticks);
+    clientTicks.reserve(ticks);
+    PongState confirmed;
+    std::uint8_t inputs;
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t tick = 0; tick < ticks; ++tick)
+    {
+        std::this_thread::sleep_until(start + std::chrono::microseconds(tick * 1000000 / layout.tickRate));
+        host.advance(toInput(left->act(host.state(), config, false), false));
+        client.advance(toInput(right->act(client.state(), config, true), true));
+        while (host.popConfirmed(confirmed, inputs)) hostTicks.push_back(hashState(confirmed) ^ inputs);
+        while (client.popConfirmed(confirmed, inputs)) clientTicks.push_back(hashState(confirmed) ^ inputs);
+    }
+
+    std::size_t common = std::min(hostTicks.size(), clientTicks.size());
+    std::size_t mismatch = common;
+    for (std::size_t i = 0; i < common && mismatch == common; ++i)
+    {
+        if (hostTicks[i] != clientTicks[i]) mismatch = i;
+    }
+
+    const RollbackSession* sides[2] = { &host, &client };
+    for (const RollbackSession* side : sides)
+    {
+        printf("%s: %u ticks, %llu rollbacks of up to %u ticks, %llu ticks simulated again, %llu ticks waited, round trip %u ms\n",
+               side->isRightSide() ? "Client" : "Host", side->tick(), static_cast<unsigned long long>(side->getRollbacks()), side->getMaxRollback(),
+               static_cast<unsigned long long>(side->getRollbackTicks()), static_cast<unsigned long long>(side->getWaitedTicks()), side->getRoundTrip());
+    }
+    printf("%llu ticks confirmed by both sides, ", static_cast<unsigned long long>(common));
+    if (common == 0) printf("the sessions never connected\n");
+    else if (mismatch != common) printf("diverged at tick %llu\n", static_cast<unsigned long long>(mismatch));
+    else printf("ok\n");
+    return common > 0 && mismatch == common && host.getDesyncs() == 0 && client.getDesyncs() == 0;
+}
+
+int main(int argc, char* args[])
+{
+    NetplaySettings settings;
+    int seconds = 30;
+    if (!parseArguments(argc, args, settings, seconds))
+    {
+        printUsage();
+        return -1;
+    }
+    return runNetplayTest(settings, seconds) ? 0 : -1;
+}
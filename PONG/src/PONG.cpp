@@ -1,17 +1,284 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
 
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 #include <SDL_mixer.h>
 
+#include "../include/AllocationCounter.h"
+#include "../include/AssetBundle.h"
+#include "../include/Broadcast.h"
 #include "../include/Game.h"
+#include "../include/Netplay.h"
+#include "../include/Replay.h"
+#include "../include/SearchController.h"
+
+/* Simulate every replay as fast as possible and check it against its keyframes. Returns false if any of them fails. */
+static bool runHeadless(const std::vector<std::string>& replays, std::uint64_t startTick)
+{
+    if (replays.empty())
+    {
+        printf("No replay to run, use --replay <file>\n");
+        return false;
+    }
+
+    bool success = true;
+    for (const auto& path : replays)
+    {
+        Replay replay;
+        if (!replay.open(path))
+        {
+            success = false;
+            continue;
+        }
+
+        ReplayResult result;
+        auto start = std::chrono::steady_clock::now();
+        bool decoded = runReplay(replay, startTick, result);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        printf("%s: %llu ticks, score %d:%d, %.2f Mticks/s, ", path.c_str(), static_cast<unsigned long long>(result.ticks),
+               result.state.leftScore, result.state.rightScore, (seconds > 0.0) ? result.ticks / seconds / 1e6 : 0.0);
+        if (!decoded) printf("corrupted input stream\n");
+        else if (result.mismatchTick != REPLAY_NO_MISMATCH) printf("diverges at tick %llu\n", static_cast<unsigned long long>(result.mismatchTick));
+        else printf("ok\n");
+        success = success && decoded && result.mismatchTick == REPLAY_NO_MISMATCH;
+    }
+    return success;
+}
 
 int main(int argc, char* args[])
 {
     Game game;
-    if (!game.init("./textures/", "./fonts/")) return -1;
+    std::vector<std::string> replays;
+    std::uint64_t startTick = 0;
+    bool headless = false;
+    bool checkAllocations = false;
+    std::string bundlePath; /* Bundle to load the images from, empty -> the image and font files. */
+    std::string packPath; /* Bundle to write instead of playing, empty if none. */
+    NetplaySettings netplay;
+    std::string hostPort; /* Port to host a remote match on, empty if none. */
+    std::string connectAddress; /* Host to join, empty if none. */
+    BroadcastSettings broadcast;
+    std::string broadcastPort; /* Port to broadcast the match on, empty if none. */
+    std::string spectateAddress; /* Broadcast to show, empty if none. */
+    GameOptions options;
+
+    /*
+        Options:
+        --left <controller>, --right <controller>: computer players;
+        --record <file>: record the match;
+        --profile <file>: write the frame profile to a CSV file, and the last frames to <file>.frames.csv;
+        --replay <file>: play a replay, --seek <tick> starts it from the given tick;
+        --headless: simulate the replays without a window and check them, several --replay can be given;
+        --software: use SDL's software renderer;
+        --dirty-rects: software rendering that updates only the parts of the window that changed;
+        --no-idle: keep drawing frames while nobody plays;
+        --low-latency: apply the keys at the tick they were pressed and start the frames just in time for the vblank;
+        --sim-thread: simulate on a separate thread, so that a slow present does not delay the ticks;
+        --bundle <file>: load the images and glyphs from a bundle, --pack <file> writes one from the media files and exits;
+        --check-allocations: fail if the game loop allocates after its warm-up, needs a build with PONG_COUNT_ALLOCATIONS;
+        --host <port>, --connect <host:port>: play against another machine, the host plays the left pad;
+        --net-latency <ms>, --net-jitter <ms>, --net-loss <percent>: delay or drop the outgoing packets, to try netplay on one machine;
+        --net-delay <ticks>: ticks of input delay, --net-rollback <ticks>: longest rollback before waiting for the peer;
+        --broadcast <port>: send the match to spectators, --broadcast-interval <ticks>: ticks between two snapshots;
+        --spectate <host:port>: show a broadcast match.
+    */
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(args[i], "--headless") == 0)
+        {
+            headless = true;
+        }
+        else if (strcmp(args[i], "--software") == 0)
+        {
+            options.softwareRenderer = true;
+        }
+        else if (strcmp(args[i], "--dirty-rects") == 0)
+        {
+            options.dirtyRects = true;
+        }
+        else if (strcmp(args[i], "--no-idle") == 0)
+        {
+            options.idleWait = false;
+        }
+        else if (strcmp(args[i], "--low-latency") == 0)
+        {
+            options.lowLatency = true;
+        }
+        else if (strcmp(args[i], "--sim-thread") == 0)
+        {
+            options.simulationThread = true;
+        }
+        else if (strcmp(args[i], "--check-allocations") == 0)
+        {
+            checkAllocations = true;
+        }
+        else if ((strcmp(args[i], "--left") == 0 || strcmp(args[i], "--right") == 0) && hasValue)
+        {
+            std::unique_ptr<Controller> controller = createController(args[i + 1]);
+            if (strcmp(args[i + 1], "search") == 0)
+            {
+                /* On screen a search must not hold up the frame: cap it at about a tick at 240 Hz. */
+                SearchSettings settings;
+                settings.budgetMicroseconds = 4000;
+                controller.reset(new SearchController(settings));
+            }
+            if (controller == nullptr)
+            {
+                printf("Unknown controller %s\n", args[i + 1]);
+                return -1;
+            }
+            game.setController(strcmp(args[i], "--right") == 0, std::move(controller));
+            ++i;
+        }
+        else if (strcmp(args[i], "--record") == 0 && hasValue)
+        {
+            game.setRecording(args[++i]);
+        }
+        else if (strcmp(args[i], "--profile") == 0 && hasValue)
+        {
+            game.setProfiling(args[++i]);
+        }
+        else if (strcmp(args[i], "--replay") == 0 && hasValue)
+        {
+            replays.push_back(args[++i]);
+        }
+        else if (strcmp(args[i], "--bundle") == 0 && hasValue)
+        {
+            bundlePath = args[++i];
+        }
+        else if (strcmp(args[i], "--pack") == 0 && hasValue)
+        {
+            packPath = args[++i];
+        }
+        else if (strcmp(args[i], "--host") == 0 && hasValue)
+        {
+            hostPort = args[++i];
+        }
+        else if (strcmp(args[i], "--connect") == 0 && hasValue)
+        {
+            connectAddress = args[++i];
+        }
+        else if (strcmp(args[i], "--net-latency") == 0 && hasValue)
+        {
+            netplay.link.latency = static_cast<std::uint32_t>(strtoul(args[++i], nullptr, 10));
+        }
+        else if (strcmp(args[i], "--net-jitter") == 0 && hasValue)
+        {
+            netplay.link.jitter = static_cast<std::uint32_t>(strtoul(args[++i], nullptr, 10));
+        }
+        else if (strcmp(args[i], "--net-loss") == 0 && hasValue)
+        {
+            netplay.link.lossPercent = atoi(args[++i]);
+        }
+        else if (strcmp(args[i], "--net-delay") == 0 && hasValue)
+        {
+            netplay.inputDelay = atoi(args[++i]);
+        }
+        else if (strcmp(args[i], "--net-rollback") == 0 && hasValue)
+        {
+            netplay.maxRollback = atoi(args[++i]);
+        }
+        else if (strcmp(args[i], "--broadcast") == 0 && hasValue)
+        {
+            broadcastPort = args[++i];
+        }
+        else if (strcmp(args[i], "--broadcast-interval") == 0 && hasValue)
+        {
+            broadcast.sendInterval = static_cast<std::uint32_t>(strtoul(args[++i], nullptr, 10));
+        }
+        else if (strcmp(args[i], "--spectate") == 0 && hasValue)
+        {
+            spectateAddress = args[++i];
+        }
+        else if (strcmp(args[i], "--seek") == 0 && hasValue)
+        {
+            startTick = strtoull(args[++i], nullptr, 10);
+        }
+        else
+        {
+            printf("Unknown option %s\n", args[i]);
+            return -1;
+        }
+    }
+
+    if (headless) return runHeadless(replays, startTick) ? 0 : -1;
+    if (!packPath.empty()) return game.packBundle("./textures/", "./fonts/", packPath) ? 0 : -1;
+    if (checkAllocations && !allocationCounterEnabled())
+    {
+        printf("Allocations are only counted in builds with PONG_COUNT_ALLOCATIONS\n");
+        return -1;
+    }
+
+    Replay replay;
+    if (replays.size() > 1)
+    {
+        printf("Only one replay can be shown at a time\n");
+        return -1;
+    }
+    if (!replays.empty())
+    {
+        if (!replay.open(replays.front())) return -1;
+        game.setReplay(&replay, startTick);
+    }
+
+    RollbackSession session(netplay);
+    if (!hostPort.empty() || !connectAddress.empty())
+    {
+        if (!hostPort.empty() && !connectAddress.empty())
+        {
+            printf("Either host a match or connect to one\n");
+            return -1;
+        }
+        if (!replays.empty())
+        {
+            printf("A replay cannot be played over the network\n");
+            return -1;
+        }
+        if (!hostPort.empty() && !session.host(static_cast<std::uint16_t>(atoi(hostPort.c_str())))) return -1;
+        if (!connectAddress.empty() && !session.connect(connectAddress)) return -1;
+        if (!hostPort.empty()) printf("Waiting for a player on port %u\n", session.localPort());
+        game.setNetplay(&session);
+    }
+
+    BroadcastServer broadcastServer(broadcast);
+    BroadcastClient spectator;
+    if (!spectateAddress.empty())
+    {
+        if (!replays.empty() || !hostPort.empty() || !connectAddress.empty() || !broadcastPort.empty())
+        {
+            printf("A broadcast match can only be watched\n");
+            return -1;
+        }
+        UdpAddress address;
+        if (!resolveAddress(spectateAddress, address) || !spectator.open(address)) return -1;
+        game.setSpectating(&spectator);
+    }
+    if (!broadcastPort.empty())
+    {
+        if (!broadcastServer.open(static_cast<std::uint16_t>(atoi(broadcastPort.c_str())))) return -1;
+        printf("Broadcasting on port %u\n", broadcastServer.localPort());
+        game.setBroadcast(&broadcastServer);
+    }
+
+    AssetBundle bundle;
+    if (!bundlePath.empty())
+    {
+        if (!bundle.open(bundlePath)) return -1;
+        game.setBundle(&bundle);
+    }
+
+    if (!game.init("./textures/", "./fonts/", options)) return -1;
     game.play();
 
+    if (checkAllocations && game.getSteadyAllocations() > 0) return -1;
     return 0;
-}
\ No newline at end of file
+}
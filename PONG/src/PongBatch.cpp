@@ -0,0 +1,474 @@
+#include "../include/PongBatch.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#define PONG_BATCH_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PONG_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+    The kernels work on double precision lanes: every value of the fixed-point state and every intermediate product
+    fits in the 53-bit mantissa, so additions, products and divisions by powers of two are exact, and truncating a
+    correctly rounded quotient gives the same result as the integer division of step().
+*/
+namespace
+{
+#if defined(PONG_BATCH_AVX2)
+    /* AVX2 operations on 4 matches at a time. Masks are doubles with all bits set or cleared. */
+    struct SimdOps
+    {
+        typedef __m256d Float;
+        typedef __m256i Int;
+        static const std::size_t WIDTH = 4;
+
+        static Float load(const std::int32_t* p) { return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+        static void store(std::int32_t* p, Float v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvttpd_epi32(v)); }
+        static Int loadBytes(const std::uint8_t* p)
+        {
+            std::int32_t packed;
+            std::memcpy(&packed, p, sizeof(packed));
+            return _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(packed));
+        }
+        static void storeBytes(std::uint8_t* p, Float v)
+        {
+            __m128i words = _mm_packs_epi32(_mm256_cvttpd_epi32(v), _mm_setzero_si128());
+            std::int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+            std::memcpy(p, &packed, sizeof(packed));
+        }
+
+        static Float set(double v) { return _mm256_set1_pd(v); }
+        static Float add(Float a, Float b) { return _mm256_add_pd(a, b); }
+        static Float sub(Float a, Float b) { return _mm256_sub_pd(a, b); }
+        static Float mul(Float a, Float b) { return _mm256_mul_pd(a, b); }
+        static Float div(Float a, Float b) { return _mm256_div_pd(a, b); }
+        static Float min(Float a, Float b) { return _mm256_min_pd(a, b); }
+        static Float max(Float a, Float b) { return _mm256_max_pd(a, b); }
+        static Float truncate(Float v) { return _mm256_round_pd(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+        static Float lt(Float a, Float b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+        static Float le(Float a, Float b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+        static Float gt(Float a, Float b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+        static Float eq(Float a, Float b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+        static Float ne(Float a, Float b) { return _mm256_cmp_pd(a, b, _CMP_NEQ_UQ); }
+        static bool any(Float mask) { return _mm256_movemask_pd(mask) != 0; }
+        static Float and_(Float a, Float b) { return _mm256_and_pd(a, b); }
+        static Float or_(Float a, Float b) { return _mm256_or_pd(a, b); }
+        static Float andNot(Float a, Float b) { return _mm256_andnot_pd(b, a); } /* a & ~b */
+        static Float hasBits(Int v, std::int32_t bits)
+        {
+            __m256i mask = _mm256_set1_epi64x(bits);
+            return _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(v, mask), mask));
+        }
+    };
+#elif defined(PONG_BATCH_SSE2)
+    /* SSE2 operations on 2 matches at a time. Masks are doubles with all bits set or cleared. */
+    struct SimdOps
+    {
+        typedef __m128d Float;
+        typedef __m128i Int;
+        static const std::size_t WIDTH = 2;
+
+        static Float load(const std::int32_t* p) { return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+        static void store(std::int32_t* p, Float v) { _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_cvttpd_epi32(v)); }
+        static Int loadBytes(const std::uint8_t* p)
+        {
+            std::uint16_t packed;
+            std::memcpy(&packed, p, sizeof(packed));
+            __m128i zero = _mm_setzero_si128();
+            __m128i words = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+            return _mm_unpacklo_epi32(words, words); /* Each byte in both halves of its 64-bit lane. */
+        }
+        static void storeBytes(std::uint8_t* p, Float v)
+        {
+            __m128i words = _mm_packs_epi32(_mm_cvttpd_epi32(v), _mm_setzero_si128());
+            std::uint16_t packed = static_cast<std::uint16_t>(_mm_cvtsi128_si32(_mm_packus_epi16(words, words)));
+            std::memcpy(p, &packed, sizeof(packed));
+        }
+
+        static Float set(double v) { return _mm_set1_pd(v); }
+        static Float add(Float a, Float b) { return _mm_add_pd(a, b); }
+        static Float sub(Float a, Float b) { return _mm_sub_pd(a, b); }
+        static Float mul(Float a, Float b) { return _mm_mul_pd(a, b); }
+        static Float div(Float a, Float b) { return _mm_div_pd(a, b); }
+        static Float min(Float a, Float b) { return _mm_min_pd(a, b); }
+        static Float max(Float a, Float b) { return _mm_max_pd(a, b); }
+        static Float truncate(Float v) { return _mm_cvtepi32_pd(_mm_cvttpd_epi32(v)); } /* Only for values in the int32 range. */
+        static Float lt(Float a, Float b) { return _mm_cmplt_pd(a, b); }
+        static Float le(Float a, Float b) { return _mm_cmple_pd(a, b); }
+        static Float gt(Float a, Float b) { return _mm_cmpgt_pd(a, b); }
+        static Float eq(Float a, Float b) { return _mm_cmpeq_pd(a, b); }
+        static Float ne(Float a, Float b) { return _mm_cmpneq_pd(a, b); }
+        static bool any(Float mask) { return _mm_movemask_pd(mask) != 0; }
+        static Float and_(Float a, Float b) { return _mm_and_pd(a, b); }
+        static Float or_(Float a, Float b) { return _mm_or_pd(a, b); }
+        static Float andNot(Float a, Float b) { return _mm_andnot_pd(b, a); } /* a & ~b */
+        static Float hasBits(Int v, std::int32_t bits)
+        {
+            __m128i mask = _mm_set1_epi32(bits);
+            return _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(v, mask), mask));
+        }
+    };
+#endif
+
+#if defined(PONG_BATCH_AVX2) || defined(PONG_BATCH_SSE2)
+    typedef SimdOps::Float Float;
+    typedef SimdOps::Int Int;
+
+    /* mask ? a : b */
+    inline Float select(Float mask, Float a, Float b)
+    {
+        return SimdOps::or_(SimdOps::and_(mask, a), SimdOps::andNot(b, mask));
+    }
+
+    /* Load a 0 / -1 boolean array as a mask. */
+    inline Float loadMask(const std::int32_t* p)
+    {
+        return SimdOps::ne(SimdOps::load(p), SimdOps::set(0.0));
+    }
+
+    /* Store a mask as a 0 / -1 boolean array. */
+    inline void storeMask(std::int32_t* p, Float mask)
+    {
+        SimdOps::store(p, SimdOps::and_(mask, SimdOps::set(-1.0)));
+    }
+
+    /* PongEvent bit for every lane of the mask. The bits are distinct, so they can be combined by addition. */
+    inline Float eventBits(Float mask, std::int32_t bit)
+    {
+        return SimdOps::and_(mask, SimdOps::set(bit));
+    }
+
+    /* impactTime() from PongState.cpp. */
+    inline Float impactTime(Float distance, Float speed)
+    {
+        Float time = SimdOps::div(SimdOps::mul(distance, SimdOps::set(TICK_TIME)), speed);
+        return SimdOps::truncate(SimdOps::min(SimdOps::max(time, SimdOps::set(-NO_IMPACT)), SimdOps::set(NO_IMPACT)));
+    }
+
+    /* travel() from PongState.cpp. */
+    inline Float travel(Float speed, Float time)
+    {
+        return SimdOps::truncate(SimdOps::mul(SimdOps::mul(speed, time), SimdOps::set(1.0 / TICK_TIME)));
+    }
+
+    /* Broadcast configuration values. */
+    struct SimdConfig
+    {
+        Float playerUpperLimit, playerLowerLimit, ballLowerLimit;
+        Float leftImpactX, rightImpactX, playerHeight, ballHeight;
+        Float playerLockY, leftBallLockX, rightBallLockX, ballLockY;
+        Float leftGoal, rightGoal;
+        Float playerSpeed, ballDefaultSpeed, negBallDefaultSpeed;
+
+        explicit SimdConfig(const PongConfig& config) :
+            playerUpperLimit(SimdOps::set(config.playerUpperLimit)),
+            playerLowerLimit(SimdOps::set(config.playerLowerLimit)),
+            ballLowerLimit(SimdOps::set(config.ballLowerLimit)),
+            leftImpactX(SimdOps::set(config.leftPlayerX + config.playerWidth)),
+            rightImpactX(SimdOps::set(config.rightPlayerX - config.ballWidth)),
+            playerHeight(SimdOps::set(config.playerHeight)),
+            ballHeight(SimdOps::set(config.ballHeight)),
+            playerLockY(SimdOps::set(config.playerLockY)),
+            leftBallLockX(SimdOps::set(config.leftBallLockX)),
+            rightBallLockX(SimdOps::set(config.rightBallLockX)),
+            ballLockY(SimdOps::set(config.ballLockY)),
+            leftGoal(SimdOps::set(config.leftGoal)),
+            rightGoal(SimdOps::set(config.rightGoal)),
+            playerSpeed(SimdOps::set(config.playerSpeed)),
+            ballDefaultSpeed(SimdOps::set(config.ballDefaultSpeed)),
+            negBallDefaultSpeed(SimdOps::set(-config.ballDefaultSpeed))
+        {}
+    };
+
+    /* Branch-free movePlayer() from PongState.cpp. Returns the movement of the pad as -1, 0 or 1. */
+    inline Float movePlayer(const SimdConfig& c, Float& playerY, Float up, Float down, Float hasBall, Float serve, Float serveSpeedX,
+                            Float& lock, Float& ballY, Float& ballSpeedX, Float& ballSpeedY, Float& serveEvent)
+    {
+        Float movedUp = SimdOps::and_(up, SimdOps::gt(playerY, c.playerUpperLimit));
+        Float movedDown = SimdOps::andNot(SimdOps::and_(down, SimdOps::lt(playerY, c.playerLowerLimit)), up);
+        Float moved = SimdOps::or_(movedUp, movedDown);
+
+        Float upChoice = SimdOps::sub(SimdOps::set(0.0), SimdOps::min(SimdOps::sub(playerY, c.playerUpperLimit), c.playerSpeed));
+        Float downChoice = SimdOps::min(SimdOps::sub(c.playerLowerLimit, playerY), c.playerSpeed);
+        Float choice = SimdOps::or_(SimdOps::and_(movedUp, upChoice), SimdOps::and_(movedDown, downChoice));
+        Float direction = SimdOps::or_(SimdOps::and_(movedUp, SimdOps::set(-1.0)), SimdOps::and_(movedDown, SimdOps::set(1.0)));
+        playerY = SimdOps::add(playerY, choice);
+
+        Float dragging = SimdOps::and_(hasBall, moved);
+        Float serving = SimdOps::and_(dragging, serve);
+        lock = SimdOps::andNot(lock, serving);
+        ballSpeedX = select(serving, serveSpeedX, ballSpeedX);
+        ballSpeedY = select(serving, SimdOps::mul(direction, c.playerSpeed), ballSpeedY);
+        ballY = select(SimdOps::andNot(dragging, serve), SimdOps::add(ballY, choice), ballY);
+        serveEvent = SimdOps::or_(serveEvent, serving);
+        return direction;
+    }
+#endif
+}
+
+PongBatch::PongBatch(const PongConfig& config, std::size_t size) :
+    _config(config),
+    _size(size),
+    _leftPlayerY(size),
+    _rightPlayerY(size),
+    _ballX(size),
+    _ballY(size),
+    _ballSpeedX(size),
+    _ballSpeedY(size),
+    _leftScore(size),
+    _rightScore(size),
+    _lock(size),
+    _lockSide(size)
+{
+    reset();
+}
+
+const char* PongBatch::kernelName()
+{
+#if defined(PONG_BATCH_AVX2)
+    return "avx2";
+#elif defined(PONG_BATCH_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+std::size_t PongBatch::size() const
+{
+    return _size;
+}
+
+const PongConfig& PongBatch::config() const
+{
+    return _config;
+}
+
+void PongBatch::reset()
+{
+    PongState state;
+    resetMatch(state, _config);
+    for (std::size_t i = 0; i < _size; ++i) setState(i, state);
+}
+
+void PongBatch::setState(std::size_t index, const PongState& state)
+{
+    _leftPlayerY[index] = state.leftPlayerY;
+    _rightPlayerY[index] = state.rightPlayerY;
+    _ballX[index] = state.ballX;
+    _ballY[index] = state.ballY;
+    _ballSpeedX[index] = state.ballSpeedX;
+    _ballSpeedY[index] = state.ballSpeedY;
+    _leftScore[index] = state.leftScore;
+    _rightScore[index] = state.rightScore;
+    _lock[index] = state.lock ? -1 : 0;
+    _lockSide[index] = state.lockSide ? -1 : 0;
+}
+
+PongState PongBatch::getState(std::size_t index) const
+{
+    PongState state;
+    state.leftPlayerY = _leftPlayerY[index];
+    state.rightPlayerY = _rightPlayerY[index];
+    state.ballX = _ballX[index];
+    state.ballY = _ballY[index];
+    state.ballSpeedX = _ballSpeedX[index];
+    state.ballSpeedY = _ballSpeedY[index];
+    state.leftScore = _leftScore[index];
+    state.rightScore = _rightScore[index];
+    state.lock = _lock[index] != 0;
+    state.lockSide = _lockSide[index] != 0;
+    return state;
+}
+
+void PongBatch::step(const std::uint8_t* inputs, std::uint8_t* events)
+{
+    step(0, _size, inputs, events);
+}
+
+void PongBatch::step(std::size_t begin, std::size_t end, const std::uint8_t* inputs, std::uint8_t* events)
+{
+    std::size_t i = begin;
+#if defined(PONG_BATCH_AVX2) || defined(PONG_BATCH_SSE2)
+    const SimdConfig c(_config);
+    const Float zero = SimdOps::set(0.0);
+    const Float one = SimdOps::set(1.0);
+    const Float allSet = SimdOps::eq(zero, zero);
+    const Float noImpact = SimdOps::set(NO_IMPACT);
+    for (; i + SimdOps::WIDTH <= end; i += SimdOps::WIDTH)
+    {
+        Float leftPlayerY = SimdOps::load(&_leftPlayerY[i]);
+        Float rightPlayerY = SimdOps::load(&_rightPlayerY[i]);
+        Float ballX = SimdOps::load(&_ballX[i]);
+        Float ballY = SimdOps::load(&_ballY[i]);
+        Float ballSpeedX = SimdOps::load(&_ballSpeedX[i]);
+        Float ballSpeedY = SimdOps::load(&_ballSpeedY[i]);
+        Float lock = loadMask(&_lock[i]);
+        Float lockSide = loadMask(&_lockSide[i]);
+        Int input = SimdOps::loadBytes(&inputs[i]);
+        Float serve = SimdOps::hasBits(input, INPUT_SERVE);
+        Float serveEvent = zero;
+
+        /* Player controls. */
+        Float leftPlayerMoved = movePlayer(c, leftPlayerY, SimdOps::hasBits(input, INPUT_LEFT_UP), SimdOps::hasBits(input, INPUT_LEFT_DOWN),
+                                           SimdOps::andNot(lock, lockSide), serve, c.ballDefaultSpeed,
+                                           lock, ballY, ballSpeedX, ballSpeedY, serveEvent);
+        Float rightPlayerMoved = movePlayer(c, rightPlayerY, SimdOps::hasBits(input, INPUT_RIGHT_UP), SimdOps::hasBits(input, INPUT_RIGHT_DOWN),
+                                            SimdOps::and_(lock, lockSide), serve, c.negBallDefaultSpeed,
+                                            lock, ballY, ballSpeedX, ballSpeedY, serveEvent);
+
+        Float straightServe = SimdOps::and_(lock, serve);
+        ballSpeedX = select(straightServe, select(lockSide, c.negBallDefaultSpeed, c.ballDefaultSpeed), ballSpeedX);
+        lock = SimdOps::andNot(lock, straightServe);
+        serveEvent = SimdOps::or_(serveEvent, straightServe);
+        Float active = SimdOps::andNot(allSet, lock);
+
+        /* Branch-free moveBall() from PongState.cpp: every lane resolves its collisions in order of time of impact. */
+        Float live = active;
+        Float remaining = SimdOps::set(TICK_TIME);
+        Float wallBounce = zero;
+        Float padHit = zero;
+        Float leftScored = zero;
+        Float rightScored = zero;
+        for (int collision = 0; collision < MAX_COLLISIONS && SimdOps::any(live); ++collision)
+        {
+            /* Time of impact with the border the ball is moving towards. Still lanes divide by one, their result is discarded. */
+            Float upward = SimdOps::lt(ballSpeedY, zero);
+            Float stillY = SimdOps::eq(ballSpeedY, zero);
+            Float divisorY = select(stillY, one, ballSpeedY);
+            Float wallY = select(upward, c.playerUpperLimit, c.ballLowerLimit);
+            Float wallTime = select(stillY, noImpact, SimdOps::max(impactTime(SimdOps::sub(wallY, ballY), divisorY), zero));
+
+            /* Time of impact with the face of the pad the ball is moving towards. */
+            Float right = SimdOps::gt(ballSpeedX, zero);
+            Float still = SimdOps::eq(ballSpeedX, zero);
+            Float divisorX = select(still, one, ballSpeedX);
+            Float padX = select(right, c.rightImpactX, c.leftImpactX);
+            Float padY = select(right, rightPlayerY, leftPlayerY);
+            Float padTime = impactTime(SimdOps::sub(padX, ballX), divisorX);
+            Float impactY = SimdOps::add(ballY, travel(ballSpeedY, padTime));
+            Float padMiss = SimdOps::or_(SimdOps::or_(still, SimdOps::lt(padTime, zero)),
+                                         SimdOps::or_(SimdOps::lt(SimdOps::add(impactY, c.ballHeight), padY),
+                                                      SimdOps::gt(impactY, SimdOps::add(padY, c.playerHeight))));
+            padTime = select(padMiss, noImpact, padTime);
+
+            /* Time at which the ball crosses the goal line. */
+            Float goalX = select(right, c.rightGoal, c.leftGoal);
+            Float goalTime = select(still, noImpact, SimdOps::max(impactTime(SimdOps::sub(goalX, ballX), divisorX), zero));
+
+            Float time = SimdOps::min(SimdOps::min(wallTime, padTime), goalTime);
+            Float finish = SimdOps::gt(time, remaining);
+            Float advance = select(finish, remaining, time);
+            ballX = select(live, SimdOps::add(ballX, travel(ballSpeedX, advance)), ballX);
+            ballY = select(live, SimdOps::add(ballY, travel(ballSpeedY, advance)), ballY);
+            remaining = select(live, SimdOps::sub(remaining, time), remaining);
+
+            Float impact = SimdOps::andNot(live, finish);
+            Float goal = SimdOps::and_(impact, SimdOps::and_(SimdOps::le(goalTime, padTime), SimdOps::le(goalTime, wallTime)));
+            Float pad = SimdOps::and_(SimdOps::andNot(impact, goal), SimdOps::le(padTime, wallTime));
+            Float wall = SimdOps::andNot(SimdOps::andNot(impact, goal), pad);
+
+            /* Pad hit: bounce, adding the spin given by the movement of the pad. */
+            Float spin = SimdOps::add(ballSpeedY, SimdOps::mul(c.playerSpeed, select(right, rightPlayerMoved, leftPlayerMoved)));
+            spin = SimdOps::min(SimdOps::max(spin, c.negBallDefaultSpeed), c.ballDefaultSpeed);
+            ballX = select(pad, padX, ballX);
+            ballSpeedX = select(pad, SimdOps::sub(zero, ballSpeedX), ballSpeedX);
+            ballSpeedY = select(pad, spin, ballSpeedY);
+            padHit = SimdOps::or_(padHit, pad);
+
+            /* Border hit: reverse the vertical speed. */
+            ballY = select(wall, wallY, ballY);
+            ballSpeedY = select(wall, SimdOps::sub(zero, ballSpeedY), ballSpeedY);
+            wallBounce = SimdOps::or_(wallBounce, wall);
+
+            leftScored = SimdOps::or_(leftScored, SimdOps::and_(goal, right));
+            rightScored = SimdOps::or_(rightScored, SimdOps::andNot(goal, right));
+            live = SimdOps::and_(SimdOps::andNot(impact, goal), SimdOps::gt(remaining, zero));
+        }
+
+        /* Goals: score and reset. */
+        Float goal = SimdOps::or_(leftScored, rightScored);
+        SimdOps::store(&_leftScore[i], SimdOps::add(SimdOps::load(&_leftScore[i]), SimdOps::and_(leftScored, one)));
+        SimdOps::store(&_rightScore[i], SimdOps::add(SimdOps::load(&_rightScore[i]), SimdOps::and_(rightScored, one)));
+        lock = SimdOps::or_(lock, goal);
+        lockSide = SimdOps::andNot(SimdOps::or_(lockSide, rightScored), leftScored);
+        ballSpeedX = SimdOps::andNot(ballSpeedX, goal);
+        ballSpeedY = SimdOps::andNot(ballSpeedY, goal);
+        leftPlayerY = select(goal, c.playerLockY, leftPlayerY);
+        rightPlayerY = select(goal, c.playerLockY, rightPlayerY);
+        ballX = select(goal, select(lockSide, c.rightBallLockX, c.leftBallLockX), ballX);
+        ballY = select(goal, c.ballLockY, ballY);
+
+        SimdOps::store(&_leftPlayerY[i], leftPlayerY);
+        SimdOps::store(&_rightPlayerY[i], rightPlayerY);
+        SimdOps::store(&_ballX[i], ballX);
+        SimdOps::store(&_ballY[i], ballY);
+        SimdOps::store(&_ballSpeedX[i], ballSpeedX);
+        SimdOps::store(&_ballSpeedY[i], ballSpeedY);
+        storeMask(&_lock[i], lock);
+        storeMask(&_lockSide[i], lockSide);
+        if (events != nullptr)
+        {
+            Float bits = SimdOps::add(SimdOps::add(eventBits(serveEvent, EVENT_SERVE), eventBits(wallBounce, EVENT_WALL_BOUNCE)),
+                                      SimdOps::add(eventBits(padHit, EVENT_PAD_HIT),
+                                                   SimdOps::add(eventBits(leftScored, EVENT_LEFT_SCORED), eventBits(rightScored, EVENT_RIGHT_SCORED))));
+            SimdOps::storeBytes(&events[i], bits);
+        }
+    }
+#endif
+    stepScalar(i, end, inputs, events);
+}
+
+void PongBatch::stepScalar(std::size_t begin, std::size_t end, const std::uint8_t* inputs, std::uint8_t* events)
+{
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        PongState state = getState(i);
+        std::uint8_t matchEvents = ::step(state, _config, inputs[i]);
+        setState(i, state);
+        if (events != nullptr) events[i] = matchEvents;
+    }
+}
+
+const std::int32_t* PongBatch::leftPlayerY() const
+{
+    return _leftPlayerY.data();
+}
+
+const std::int32_t* PongBatch::rightPlayerY() const
+{
+    return _rightPlayerY.data();
+}
+
+const std::int32_t* PongBatch::ballX() const
+{
+    return _ballX.data();
+}
+
+const std::int32_t* PongBatch::ballY() const
+{
+    return _ballY.data();
+}
+
+const std::int32_t* PongBatch::ballSpeedX() const
+{
+    return _ballSpeedX.data();
+}
+
+const std::int32_t* PongBatch::ballSpeedY() const
+{
+    return _ballSpeedY.data();
+}
+
+const std::int32_t* PongBatch::leftScore() const
+{
+    return _leftScore.data();
+}
+
+const std::int32_t* PongBatch::rightScore() const
+{
+    return _rightScore.data();
+}
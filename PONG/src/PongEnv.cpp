@@ -0,0 +1,139 @@
+#include "../include/PongEnv.h"
+
+#include <stdio.h>
+
+PongEnv::PongEnv(const PongEnvSettings& settings) :
+    _settings(settings),
+    _config(),
+    _tickRate(0.0f)
+{
+    if (_settings.ticksPerStep == 0) _settings.ticksPerStep = 1;
+}
+
+bool PongEnv::create(std::size_t count)
+{
+    if (createController(_settings.opponent) == nullptr)
+    {
+        printf("Unknown controller %s\n", _settings.opponent.c_str());
+        return false;
+    }
+
+    PongLayout layout;
+    _config = makeConfig(layout);
+    _tickRate = static_cast<float>(layout.tickRate);
+    _batch.reset(new PongBatch(_config, count));
+    _opponents.clear();
+    for (std::size_t i = 0; i < count; ++i) _opponents.push_back(createController(_settings.opponent));
+    _inputs.assign(count, INPUT_NONE);
+    _events.assign(count, EVENT_NONE);
+    _lastLeftY.assign(count, 0);
+    _lastRightY.assign(count, 0);
+    _steps.assign(count, 0);
+    _episodes.assign(count, 0);
+    for (std::size_t i = 0; i < count; ++i) startEpisode(i);
+    return true;
+}
+
+std::size_t PongEnv::size() const
+{
+    return _opponents.size();
+}
+
+const PongEnvSettings& PongEnv::settings() const
+{
+    return _settings;
+}
+
+void PongEnv::reset(std::size_t first, std::size_t count, float* observations)
+{
+    for (std::size_t i = first; i < first + count; ++i) startEpisode(i);
+    if (observations != nullptr) observe(first, count, observations);
+}
+
+void PongEnv::step(std::size_t first, std::size_t count, const std::int32_t* actions, float* rewards, std::uint8_t* dones)
+{
+    std::size_t end = first + count;
+    for (std::size_t i = first; i < end; ++i)
+    {
+        rewards[i] = 0.0f;
+        dones[i] = 0;
+        _lastLeftY[i] = _batch->leftPlayerY()[i];
+        _lastRightY[i] = _batch->rightPlayerY()[i];
+    }
+
+    for (std::uint32_t tick = 0; tick < _settings.ticksPerStep; ++tick)
+    {
+        /* Only the player holding the ball can serve, the agent does it right away. */
+        for (std::size_t i = first; i < end; ++i)
+        {
+            PongState state = _batch->getState(i);
+            std::uint8_t inputs = (actions[i] == ENV_ACTION_UP) ? INPUT_LEFT_UP : (actions[i] == ENV_ACTION_DOWN) ? INPUT_LEFT_DOWN : INPUT_NONE;
+            if (state.lock && !state.lockSide) inputs |= INPUT_SERVE;
+            ControllerAction action = _opponents[i]->act(state, _config, true);
+            action.serve = action.serve && state.lock && state.lockSide;
+            _inputs[i] = inputs | toInput(action, true);
+        }
+        _batch->step(first, end, _inputs.data(), _events.data());
+
+        /* The ticks left after the end of an episode are simulated with the others and ignored. */
+        for (std::size_t i = first; i < end; ++i)
+        {
+            if (dones[i]) continue;
+            if (_events[i] & EVENT_LEFT_SCORED) rewards[i] += 1.0f;
+            if (_events[i] & EVENT_RIGHT_SCORED) rewards[i] -= 1.0f;
+            if (_batch->leftScore()[i] >= _settings.goalsToWin || _batch->rightScore()[i] >= _settings.goalsToWin) dones[i] = 1;
+        }
+    }
+
+    for (std::size_t i = first; i < end; ++i)
+    {
+        ++_steps[i];
+        if (_settings.maxSteps > 0 && _steps[i] >= _settings.maxSteps) dones[i] = 1;
+        if (dones[i]) startEpisode(i);
+    }
+}
+
+void PongEnv::observe(std::size_t first, std::size_t count, float* observations) const
+{
+    /* Straight from the arrays of the batch to the buffer of the caller. */
+    const float width = static_cast<float>(_config.tableWidth);
+    const float height = static_cast<float>(_config.tableHeight);
+    const float padSpeed = _tickRate / (static_cast<float>(_settings.ticksPerStep) * height);
+    const std::int32_t* leftY = _batch->leftPlayerY();
+    const std::int32_t* rightY = _batch->rightPlayerY();
+    const std::int32_t* ballX = _batch->ballX();
+    const std::int32_t* ballY = _batch->ballY();
+    const std::int32_t* ballSpeedX = _batch->ballSpeedX();
+    const std::int32_t* ballSpeedY = _batch->ballSpeedY();
+    for (std::size_t i = first; i < first + count; ++i)
+    {
+        float* observation = observations + i * PONG_ENV_OBSERVATION_SIZE;
+        observation[0] = ballX[i] / width;
+        observation[1] = ballY[i] / height;
+        observation[2] = ballSpeedX[i] * _tickRate / width;
+        observation[3] = ballSpeedY[i] * _tickRate / height;
+        observation[4] = leftY[i] / height;
+        observation[5] = (leftY[i] - _lastLeftY[i]) * padSpeed;
+        observation[6] = rightY[i] / height;
+        observation[7] = (rightY[i] - _lastRightY[i]) * padSpeed;
+    }
+}
+
+std::uint64_t PongEnv::getEpisodes() const
+{
+    std::uint64_t episodes = 0;
+    for (std::uint32_t started : _episodes) episodes += started;
+    return episodes - _episodes.size();
+}
+
+void PongEnv::startEpisode(std::size_t index)
+{
+    PongState state;
+    resetMatch(state, _config);
+    _batch->setState(index, state);
+    _opponents[index]->reset(_settings.seed + static_cast<std::uint32_t>(index) * 0x9E3779B9u + _episodes[index] * 0x85EBCA6Bu);
+    ++_episodes[index];
+    _steps[index] = 0;
+    _lastLeftY[index] = state.leftPlayerY;
+    _lastRightY[index] = state.rightPlayerY;
+}
@@ -0,0 +1,102 @@
+#include "../include/PongEnvApi.h"
+
+#include <new>
+
+#include "../include/PongEnv.h"
+
+static_assert(PONG_ENV_OBSERVATION_FLOATS == PONG_ENV_OBSERVATION_SIZE, "The C interface and the environment disagree on the observation size");
+static_assert(PONG_ENV_STAY == ENV_ACTION_STAY && PONG_ENV_UP == ENV_ACTION_UP && PONG_ENV_DOWN == ENV_ACTION_DOWN, "The C interface and the environment disagree on the actions");
+static_assert(sizeof(int) == sizeof(std::int32_t) && sizeof(unsigned char) == sizeof(std::uint8_t), "The buffers of the C interface are passed as they are");
+
+/* The handle of the C interface is the environment itself. */
+struct PongEnvHandle
+{
+    PongEnv env;
+
+    explicit PongEnvHandle(const PongEnvSettings& settings) : env(settings) {}
+};
+
+static bool fits(const PongEnvHandle* env, unsigned int first, unsigned int count)
+{
+    return env != nullptr && first <= env->env.size() && count <= env->env.size() - first;
+}
+
+PongEnvOptions pongEnvDefaultOptions(void)
+{
+    PongEnvSettings defaults;
+    PongEnvOptions options;
+    options.opponent = "ai-hard";
+    options.goalsToWin = defaults.goalsToWin;
+    options.ticksPerStep = defaults.ticksPerStep;
+    options.maxSteps = defaults.maxSteps;
+    options.seed = defaults.seed;
+    return options;
+}
+
+PongEnvHandle* pongEnvCreate(unsigned int count, const PongEnvOptions* options)
+{
+    PongEnvOptions chosen = (options != nullptr) ? *options : pongEnvDefaultOptions();
+    PongEnvSettings settings;
+    if (chosen.opponent != nullptr) settings.opponent = chosen.opponent;
+    settings.goalsToWin = chosen.goalsToWin;
+    settings.ticksPerStep = chosen.ticksPerStep;
+    settings.maxSteps = chosen.maxSteps;
+    settings.seed = chosen.seed;
+    if (count == 0 || settings.goalsToWin <= 0 || settings.ticksPerStep == 0) return nullptr;
+
+    PongEnvHandle* env = new (std::nothrow) PongEnvHandle(settings);
+    if (env == nullptr) return nullptr;
+    /* No exception may cross the C interface. */
+    bool created = false;
+    try
+    {
+        created = env->env.create(count);
+    }
+    catch (const std::bad_alloc&)
+    {
+        created = false;
+    }
+    if (!created)
+    {
+        delete env;
+        return nullptr;
+    }
+    return env;
+}
+
+void pongEnvDestroy(PongEnvHandle* env)
+{
+    delete env;
+}
+
+unsigned int pongEnvSize(const PongEnvHandle* env)
+{
+    return (env != nullptr) ? static_cast<unsigned int>(env->env.size()) : 0;
+}
+
+int pongEnvReset(PongEnvHandle* env, unsigned int first, unsigned int count, float* observations)
+{
+    if (!fits(env, first, count)) return 0;
+    env->env.reset(first, count, observations);
+    return 1;
+}
+
+int pongEnvStep(PongEnvHandle* env, unsigned int first, unsigned int count, const int* actions, float* rewards, unsigned char* dones)
+{
+    if (!fits(env, first, count) || actions == nullptr || rewards == nullptr || dones == nullptr) return 0;
+    env->env.step(first, count, reinterpret_cast<const std::int32_t*>(actions), rewards, dones);
+    return 1;
+}
+
+int pongEnvObserve(const PongEnvHandle* env, unsigned int first, unsigned int count, float* observations)
+{
+    if (!fits(env, first, count) || observations == nullptr) return 0;
+    env->env.observe(first, count, observations);
+    return 1;
+}
+
+int pongEnvStepAll(PongEnvHandle* env, const int* actions, float* observations, float* rewards, unsigned char* dones)
+{
+    unsigned int count = pongEnvSize(env);
+    return pongEnvStep(env, 0, count, actions, rewards, dones) && pongEnvObserve(env, 0, count, observations);
+}
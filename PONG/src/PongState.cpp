@@ -0,0 +1,261 @@
+#include "../include/PongState.h"
+
+#include <algorithm>
+
+/*
+    Time for a coordinate to cover distance at speed, in TICK_TIME units, truncated towards zero and clamped to [-NO_IMPACT, NO_IMPACT].
+    PongBatch computes the same value exactly with double precision vectors.
+*/
+static inline std::int32_t impactTime(std::int32_t distance, std::int32_t speed)
+{
+    std::int64_t time = static_cast<std::int64_t>(distance) * TICK_TIME / speed;
+    if (time > NO_IMPACT) return NO_IMPACT;
+    if (time < -NO_IMPACT) return -NO_IMPACT;
+    return static_cast<std::int32_t>(time);
+}
+
+/* Distance covered at speed in time (in TICK_TIME units), truncated towards zero. */
+static inline std::int32_t travel(std::int32_t speed, std::int32_t time)
+{
+    return static_cast<std::int32_t>(static_cast<std::int64_t>(speed) * time / TICK_TIME);
+}
+
+/* Convert a length in pixels of the table texture to table units. */
+static std::int32_t toTableUnits(const PongLayout& layout, int pixels)
+{
+    return static_cast<std::int32_t>(static_cast<std::int64_t>(pixels) * TABLE_HEIGHT / layout.tableHeight);
+}
+
+/*
+    Move a pad according to its input. If the ball is locked to the pad, it is either dragged along or served.
+    Returns the movement of the pad.
+*/
+static PlayerMoved movePlayer(PongState& state, const PongConfig& config, std::int32_t& playerY, bool up, bool down, bool hasBall, bool serve, std::int32_t serveDirection, std::uint8_t& events)
+{
+    std::int32_t choice = 0;
+    PlayerMoved moved = PlayerMoved::NA;
+    if (up)
+    {
+        if (playerY > config.playerUpperLimit)
+        {
+            moved = PlayerMoved::UP;
+            std::int32_t diff = playerY - config.playerUpperLimit;
+            choice = -((diff < config.playerSpeed) ? diff : config.playerSpeed);
+        }
+    }
+    else if (down)
+    {
+        if (playerY < config.playerLowerLimit)
+        {
+            moved = PlayerMoved::DOWN;
+            std::int32_t diff = config.playerLowerLimit - playerY;
+            choice = ((diff < config.playerSpeed) ? diff : config.playerSpeed);
+        }
+    }
+    if (moved == PlayerMoved::NA) return moved;
+
+    playerY += choice;
+    if (hasBall)
+    {
+        if (serve)
+        {
+            state.lock = false;
+            state.ballSpeedX = serveDirection * config.ballDefaultSpeed;
+            state.ballSpeedY = static_cast<int>(moved) * config.playerSpeed;
+            events |= EVENT_SERVE;
+        }
+        else
+        {
+            state.ballY += choice;
+        }
+    }
+    return moved;
+}
+
+/* Bounce the ball on a pad, adding the spin given by the movement of the pad. */
+static void hitPlayer(PongState& state, const PongConfig& config, PlayerMoved moved)
+{
+    state.ballSpeedX = -state.ballSpeedX;
+    state.ballSpeedY = state.ballSpeedY + config.playerSpeed * static_cast<int>(moved);
+    if (state.ballSpeedY > config.ballDefaultSpeed) state.ballSpeedY = config.ballDefaultSpeed;
+    else if (state.ballSpeedY < -config.ballDefaultSpeed) state.ballSpeedY = -config.ballDefaultSpeed;
+}
+
+/* Lock the ball to the pad of the player that conceded the goal and reset the pads. */
+static void resetPositions(PongState& state, const PongConfig& config)
+{
+    state.ballSpeedX = 0;
+    state.ballSpeedY = 0;
+    state.leftPlayerY = config.playerLockY;
+    state.rightPlayerY = config.playerLockY;
+    state.ballX = state.lockSide ? config.rightBallLockX : config.leftBallLockX;
+    state.ballY = config.ballLockY;
+}
+
+PongConfig makeConfig(const PongLayout& layout)
+{
+    PongConfig config;
+
+    /* The table art defines the geometry: one table texture pixel is TABLE_HEIGHT / layout.tableHeight units. */
+    config.tableWidth = toTableUnits(layout, layout.tableWidth);
+    config.tableHeight = TABLE_HEIGHT;
+
+    /* Players. */
+    config.playerWidth = toTableUnits(layout, layout.padWidth);
+    config.playerHeight = toTableUnits(layout, layout.padHeight);
+    std::int32_t offset = toTableUnits(layout, PongLayout::BORDER_OFFSET + PongLayout::BORDER_WIDTH + PongLayout::GOAL_OFFSET + (PongLayout::GOAL_WIDTH >> 1));
+    config.leftPlayerX = offset - config.playerWidth / 2;
+    config.rightPlayerX = (config.tableWidth - offset) - config.playerWidth / 2;
+    config.playerLockY = config.tableHeight / 2;
+    config.playerSpeed = static_cast<std::int32_t>(static_cast<std::int64_t>(config.tableHeight) * PongLayout::PLAYER_SPEED / (1000 * static_cast<std::int64_t>(layout.tickRate)));
+    config.playerUpperLimit = toTableUnits(layout, PongLayout::BORDER_OFFSET + PongLayout::BORDER_WIDTH);
+    config.playerLowerLimit = config.tableHeight - toTableUnits(layout, PongLayout::BORDER_OFFSET + PongLayout::BORDER_WIDTH + layout.padHeight + PongLayout::PAD_BORDER);
+
+    /* Ball. */
+    config.ballWidth = toTableUnits(layout, layout.ballWidth);
+    config.ballHeight = toTableUnits(layout, layout.ballHeight);
+    config.ballDefaultSpeed = static_cast<std::int32_t>(static_cast<std::int64_t>(config.tableWidth) * PongLayout::BALL_SPEED / (1000 * static_cast<std::int64_t>(layout.tickRate)));
+    config.ballLockY = config.playerLockY + (config.playerHeight - config.ballHeight) / 2;
+    config.leftBallLockX = config.leftPlayerX + toTableUnits(layout, PongLayout::PAD_BORDER + layout.padWidth - PongLayout::BALL_MARGIN);
+    config.rightBallLockX = config.rightPlayerX - toTableUnits(layout, layout.padWidth + (PongLayout::BALL_MARGIN << 1));
+    config.ballLowerLimit = config.tableHeight - toTableUnits(layout, PongLayout::BORDER_OFFSET + PongLayout::BORDER_WIDTH + layout.ballHeight);
+
+    /* Goals. */
+    config.leftGoal = toTableUnits(layout, PongLayout::BORDER_OFFSET + PongLayout::BORDER_WIDTH + PongLayout::GOAL_OFFSET + PongLayout::GOAL_WIDTH - PongLayout::BALL_MARGIN);
+    config.rightGoal = config.tableWidth - config.leftGoal;
+
+    return config;
+}
+
+/* Count a goal and lock the ball to the pad of the player that conceded it. */
+static std::uint8_t scoreGoal(PongState& state, const PongConfig& config, bool leftScored)
+{
+    if (leftScored) ++state.leftScore;
+    else ++state.rightScore;
+    state.lock = true;
+    state.lockSide = !leftScored;
+    resetPositions(state, config);
+    return leftScored ? EVENT_LEFT_SCORED : EVENT_RIGHT_SCORED;
+}
+
+/*
+    Move the ball for one tick with swept collision against the borders, the pads and the goal lines.
+    Collisions are resolved in order of time of impact, so the ball can bounce several times in a tick
+    and cannot tunnel through a pad or a goal line whatever its speed.
+*/
+static std::uint8_t moveBall(PongState& state, const PongConfig& config, PlayerMoved leftPlayerMoved, PlayerMoved rightPlayerMoved)
+{
+    std::uint8_t events = EVENT_NONE;
+    std::int32_t remaining = TICK_TIME; /* Part of the tick still to simulate. */
+    for (int i = 0; i < MAX_COLLISIONS && remaining > 0; ++i)
+    {
+        /* Time of impact with the border the ball is moving towards. */
+        std::int32_t wallTime = NO_IMPACT;
+        if (state.ballSpeedY < 0) wallTime = std::max(impactTime(config.playerUpperLimit - state.ballY, state.ballSpeedY), 0);
+        else if (state.ballSpeedY > 0) wallTime = std::max(impactTime(config.ballLowerLimit - state.ballY, state.ballSpeedY), 0);
+
+        /* Time of impact with the face of the pad the ball is moving towards, if the ball overlaps it vertically at that time. */
+        bool right = state.ballSpeedX > 0;
+        std::int32_t padX = right ? config.rightPlayerX - config.ballWidth : config.leftPlayerX + config.playerWidth;
+        std::int32_t padY = right ? state.rightPlayerY : state.leftPlayerY;
+        std::int32_t padTime = NO_IMPACT;
+        if (state.ballSpeedX != 0)
+        {
+            padTime = impactTime(padX - state.ballX, state.ballSpeedX);
+            std::int32_t impactY = state.ballY + travel(state.ballSpeedY, padTime);
+            if (padTime < 0 || impactY + config.ballHeight < padY || impactY > padY + config.playerHeight) padTime = NO_IMPACT;
+        }
+
+        /* Time at which the ball crosses the goal line. */
+        std::int32_t goalX = right ? config.rightGoal : config.leftGoal;
+        std::int32_t goalTime = (state.ballSpeedX == 0) ? NO_IMPACT : std::max(impactTime(goalX - state.ballX, state.ballSpeedX), 0);
+
+        std::int32_t time = std::min(std::min(wallTime, padTime), goalTime);
+        if (time > remaining)
+        {
+            state.ballX += travel(state.ballSpeedX, remaining);
+            state.ballY += travel(state.ballSpeedY, remaining);
+            break;
+        }
+        state.ballX += travel(state.ballSpeedX, time);
+        state.ballY += travel(state.ballSpeedY, time);
+        remaining -= time;
+
+        if (goalTime <= padTime && goalTime <= wallTime)
+        {
+            events |= scoreGoal(state, config, right);
+            break;
+        }
+        if (padTime <= wallTime)
+        {
+            state.ballX = padX;
+            hitPlayer(state, config, right ? rightPlayerMoved : leftPlayerMoved);
+            events |= EVENT_PAD_HIT;
+        }
+        else
+        {
+            state.ballY = (state.ballSpeedY < 0) ? config.playerUpperLimit : config.ballLowerLimit;
+            state.ballSpeedY = -state.ballSpeedY;
+            events |= EVENT_WALL_BOUNCE;
+        }
+    }
+    return events;
+}
+
+void resetMatch(PongState& state, const PongConfig& config)
+{
+    state.leftScore = 0;
+    state.rightScore = 0;
+    state.lock = true;
+    state.lockSide = false;
+    resetPositions(state, config);
+}
+
+std::uint8_t step(PongState& state, const PongConfig& config, std::uint8_t inputs)
+{
+    std::uint8_t events = EVENT_NONE;
+    bool serve = (inputs & INPUT_SERVE) != 0;
+
+    /* Player controls. */
+    PlayerMoved leftPlayerMoved = movePlayer(state, config, state.leftPlayerY,
+                                             (inputs & INPUT_LEFT_UP) != 0, (inputs & INPUT_LEFT_DOWN) != 0,
+                                             state.lock && !state.lockSide, serve, 1, events);
+    PlayerMoved rightPlayerMoved = movePlayer(state, config, state.rightPlayerY,
+                                              (inputs & INPUT_RIGHT_UP) != 0, (inputs & INPUT_RIGHT_DOWN) != 0,
+                                              state.lock && state.lockSide, serve, -1, events);
+
+    if (state.lock && serve)
+    {
+        state.ballSpeedX = state.lockSide ? -config.ballDefaultSpeed : config.ballDefaultSpeed;
+        state.lock = false;
+        events |= EVENT_SERVE;
+    }
+    if (state.lock) return events;
+
+    return events | moveBall(state, config, leftPlayerMoved, rightPlayerMoved);
+}
+
+std::uint8_t combineInputs(const PongState& state, std::uint8_t left, std::uint8_t right)
+{
+    std::uint8_t serve = (state.lockSide ? right : left) & INPUT_SERVE;
+    return (left & (INPUT_LEFT_UP | INPUT_LEFT_DOWN)) | (right & (INPUT_RIGHT_UP | INPUT_RIGHT_DOWN)) | serve;
+}
+
+std::uint64_t hashState(const PongState& state)
+{
+    /* FNV-1a over the 32-bit words of the state, independent of the padding and the endianness of the struct. */
+    const std::uint32_t words[] = {
+        static_cast<std::uint32_t>(state.leftPlayerY), static_cast<std::uint32_t>(state.rightPlayerY),
+        static_cast<std::uint32_t>(state.ballX), static_cast<std::uint32_t>(state.ballY),
+        static_cast<std::uint32_t>(state.ballSpeedX), static_cast<std::uint32_t>(state.ballSpeedY),
+        static_cast<std::uint32_t>(state.leftScore), static_cast<std::uint32_t>(state.rightScore),
+        (state.lock ? 1u : 0u) | (state.lockSide ? 2u : 0u)
+    };
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::uint32_t word : words)
+    {
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
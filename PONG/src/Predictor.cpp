@@ -0,0 +1,52 @@
+#include "../include/Predictor.h"
+
+#include <cstdlib>
+
+std::int32_t leftPlayerImpactX(const PongConfig& config)
+{
+    return config.leftPlayerX + config.playerWidth;
+}
+
+std::int32_t rightPlayerImpactX(const PongConfig& config)
+{
+    return config.rightPlayerX - config.ballWidth;
+}
+
+std::int32_t foldBallY(const PongConfig& config, std::int64_t y)
+{
+    std::int64_t span = config.ballLowerLimit - config.playerUpperLimit;
+    if (span <= 0) return config.playerUpperLimit;
+
+    /* The motion between two borders is periodic with period 2 * span: mirror the second half. */
+    std::int64_t offset = (y - config.playerUpperLimit) % (2 * span);
+    if (offset < 0) offset += 2 * span;
+    if (offset > span) offset = 2 * span - offset;
+    return static_cast<std::int32_t>(config.playerUpperLimit + offset);
+}
+
+std::int64_t distanceToSide(const PongState& state, const PongConfig& config, bool rightSide)
+{
+    if (state.lock || state.ballSpeedX == 0) return -1;
+
+    std::int64_t targetX = rightSide ? rightPlayerImpactX(config) : leftPlayerImpactX(config);
+    bool approaching = (state.ballSpeedX > 0) == rightSide;
+    if (approaching) return std::llabs(targetX - state.ballX);
+
+    /* Reach the opposite pad, then come back across the whole table. */
+    std::int64_t oppositeX = rightSide ? leftPlayerImpactX(config) : rightPlayerImpactX(config);
+    return std::llabs(state.ballX - oppositeX) + std::llabs(targetX - oppositeX);
+}
+
+std::int32_t ticksToSide(const PongState& state, const PongConfig& config, bool rightSide)
+{
+    std::int64_t distance = distanceToSide(state, config, rightSide);
+    if (distance < 0) return -1;
+    return static_cast<std::int32_t>(distance / std::abs(state.ballSpeedX));
+}
+
+std::int32_t predictBallY(const PongState& state, const PongConfig& config, bool rightSide)
+{
+    std::int64_t distance = distanceToSide(state, config, rightSide);
+    if (distance < 0) return state.ballY;
+    return foldBallY(config, state.ballY + static_cast<std::int64_t>(state.ballSpeedY) * distance / std::abs(state.ballSpeedX));
+}
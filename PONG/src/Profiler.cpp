@@ -0,0 +1,217 @@
+#include "../include/Profiler.h"
+
+#include <stdio.h>
+
+static const char* ZONE_NAMES[ZONE_COUNT] = { "input", "physics", "render", "present", "frame" };
+
+/* Count a time in a histogram of BUCKET_COUNT buckets. */
+static void addToHistogram(std::uint32_t* histogram, double microseconds)
+{
+    int bucket = static_cast<int>(microseconds / Profiler::BUCKET_MICROSECONDS);
+    if (bucket >= Profiler::BUCKET_COUNT) bucket = Profiler::BUCKET_COUNT - 1;
+    ++histogram[bucket];
+}
+
+/* Upper bound of the first bucket that reaches the rank of the percentile, at most the maximum. */
+static double histogramPercentile(const std::uint32_t* histogram, std::uint64_t total, double maximum, double percentile)
+{
+    if (total == 0) return 0.0;
+
+    std::uint64_t rank = static_cast<std::uint64_t>(percentile / 100.0 * (total - 1)) + 1;
+    std::uint64_t count = 0;
+    for (int bucket = 0; bucket < Profiler::BUCKET_COUNT; ++bucket)
+    {
+        count += histogram[bucket];
+        if (count >= rank)
+        {
+            double upper = static_cast<double>((bucket + 1) * Profiler::BUCKET_MICROSECONDS);
+            return (upper < maximum) ? upper : maximum;
+        }
+    }
+    return maximum;
+}
+
+Profiler::Profiler() :
+    _microsecondsPerTick(1e6 / SDL_GetPerformanceFrequency()),
+    _frameStart(0),
+    _histograms(ZONE_COUNT * BUCKET_COUNT, 0),
+    _history(ZONE_COUNT * HISTORY, 0.0f),
+    _frameCount(0),
+    _latencyHistogram(BUCKET_COUNT, 0),
+    _latencyCount(0),
+    _latencyMaximum(0.0)
+{
+    for (int zone = 0; zone < ZONE_COUNT; ++zone)
+    {
+        _current[zone] = 0;
+        _last[zone] = 0.0;
+        _maximum[zone] = 0.0;
+    }
+}
+
+const char* Profiler::zoneName(int zone)
+{
+    return ZONE_NAMES[zone];
+}
+
+void Profiler::beginFrame()
+{
+    for (int zone = 0; zone < ZONE_COUNT; ++zone) _current[zone] = 0;
+    _frameStart = SDL_GetPerformanceCounter();
+}
+
+void Profiler::endFrame()
+{
+    _current[ZONE_FRAME] = SDL_GetPerformanceCounter() - _frameStart;
+
+    float* frame = &_history[(_frameCount % HISTORY) * ZONE_COUNT];
+    for (int zone = 0; zone < ZONE_COUNT; ++zone)
+    {
+        double microseconds = _current[zone] * _microsecondsPerTick;
+        addToHistogram(&_histograms[zone * BUCKET_COUNT], microseconds);
+        if (microseconds > _maximum[zone]) _maximum[zone] = microseconds;
+        _last[zone] = microseconds;
+        frame[zone] = static_cast<float>(microseconds);
+    }
+    ++_frameCount;
+}
+
+void Profiler::add(int zone, Uint64 counterTicks)
+{
+    _current[zone] += counterTicks;
+}
+
+std::uint64_t Profiler::getFrameCount() const
+{
+    return _frameCount;
+}
+
+double Profiler::getLast(int zone) const
+{
+    return _last[zone];
+}
+
+double Profiler::getPercentile(int zone, double percentile) const
+{
+    return histogramPercentile(&_histograms[zone * BUCKET_COUNT], _frameCount, _maximum[zone], percentile);
+}
+
+double Profiler::getMaximum(int zone) const
+{
+    return _maximum[zone];
+}
+
+void Profiler::addLatency(Uint64 counterTicks)
+{
+    double microseconds = counterTicks * _microsecondsPerTick;
+    addToHistogram(_latencyHistogram.data(), microseconds);
+    if (microseconds > _latencyMaximum) _latencyMaximum = microseconds;
+    ++_latencyCount;
+}
+
+std::uint64_t Profiler::getLatencyCount() const
+{
+    return _latencyCount;
+}
+
+double Profiler::getLatencyPercentile(double percentile) const
+{
+    return histogramPercentile(_latencyHistogram.data(), _latencyCount, _latencyMaximum, percentile);
+}
+
+double Profiler::getLatencyMaximum() const
+{
+    return _latencyMaximum;
+}
+
+void Profiler::setLoadTime(const std::string& asset, Uint64 counterTicks)
+{
+    double microseconds = counterTicks * _microsecondsPerTick;
+    for (std::size_t i = 0; i < _loadNames.size(); ++i)
+    {
+        if (_loadNames[i] == asset)
+        {
+            _loadTimes[i] = microseconds;
+            return;
+        }
+    }
+    _loadNames.push_back(asset);
+    _loadTimes.push_back(microseconds);
+}
+
+std::size_t Profiler::getLoadCount() const
+{
+    return _loadNames.size();
+}
+
+const std::string& Profiler::getLoadName(std::size_t index) const
+{
+    return _loadNames[index];
+}
+
+double Profiler::getLoadTime(std::size_t index) const
+{
+    return _loadTimes[index];
+}
+
+bool Profiler::writeCsv(const std::string& path) const
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        printf("Unable to create %s\n", path.c_str());
+        return false;
+    }
+    fprintf(file, "zone,frames,p50_us,p99_us,max_us\n");
+    for (int zone = 0; zone < ZONE_COUNT; ++zone)
+    {
+        fprintf(file, "%s,%llu,%.1f,%.1f,%.1f\n", zoneName(zone), static_cast<unsigned long long>(_frameCount),
+                getPercentile(zone, 50.0), getPercentile(zone, 99.0), getMaximum(zone));
+    }
+    if (_latencyCount > 0)
+    {
+        /* The count of this row is the number of inputs measured. */
+        fprintf(file, "input_latency,%llu,%.1f,%.1f,%.1f\n", static_cast<unsigned long long>(_latencyCount),
+                getLatencyPercentile(50.0), getLatencyPercentile(99.0), getLatencyMaximum());
+    }
+    for (std::size_t i = 0; i < _loadNames.size(); ++i)
+    {
+        /* Measured once: the same time in every column. */
+        fprintf(file, "load_%s,1,%.1f,%.1f,%.1f\n", _loadNames[i].c_str(), _loadTimes[i], _loadTimes[i], _loadTimes[i]);
+    }
+    return fclose(file) == 0;
+}
+
+bool Profiler::writeFramesCsv(const std::string& path) const
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        printf("Unable to create %s\n", path.c_str());
+        return false;
+    }
+    fprintf(file, "frame");
+    for (int zone = 0; zone < ZONE_COUNT; ++zone) fprintf(file, ",%s_us", zoneName(zone));
+    fprintf(file, "\n");
+
+    std::uint64_t first = (_frameCount > HISTORY) ? _frameCount - HISTORY : 0;
+    for (std::uint64_t frame = first; frame < _frameCount; ++frame)
+    {
+        const float* times = &_history[(frame % HISTORY) * ZONE_COUNT];
+        fprintf(file, "%llu", static_cast<unsigned long long>(frame));
+        for (int zone = 0; zone < ZONE_COUNT; ++zone) fprintf(file, ",%.1f", times[zone]);
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0;
+}
+
+ProfileScope::ProfileScope(Profiler& profiler, int zone) :
+    _profiler(profiler),
+    _zone(zone),
+    _start(SDL_GetPerformanceCounter())
+{}
+
+ProfileScope::~ProfileScope()
+{
+    _profiler.add(_zone, SDL_GetPerformanceCounter() - _start);
+}
@@ -0,0 +1,288 @@
+#include "../include/Replay.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+static_assert(sizeof(ReplayHeader) == 120, "ReplayHeader must not contain padding");
+static_assert(sizeof(ReplayKeyframe) == 72, "ReplayKeyframe must not contain padding");
+
+/* Copy the fields of a state to the fixed layout stored in the keyframes. */
+static void packState(const PongState& state, std::int32_t* fields)
+{
+    fields[0] = state.leftPlayerY;
+    fields[1] = state.rightPlayerY;
+    fields[2] = state.ballX;
+    fields[3] = state.ballY;
+    fields[4] = state.ballSpeedX;
+    fields[5] = state.ballSpeedY;
+    fields[6] = state.leftScore;
+    fields[7] = state.rightScore;
+    fields[8] = state.lock ? 1 : 0;
+    fields[9] = state.lockSide ? 1 : 0;
+}
+
+static void unpackState(const std::int32_t* fields, PongState& state)
+{
+    state.leftPlayerY = fields[0];
+    state.rightPlayerY = fields[1];
+    state.ballX = fields[2];
+    state.ballY = fields[3];
+    state.ballSpeedX = fields[4];
+    state.ballSpeedY = fields[5];
+    state.leftScore = fields[6];
+    state.rightScore = fields[7];
+    state.lock = fields[8] != 0;
+    state.lockSide = fields[9] != 0;
+}
+
+static ReplayKeyframe makeKeyframe(std::uint64_t tick, const PongState& state, std::uint64_t streamOffset, std::uint32_t runSkip, std::uint8_t previousInput)
+{
+    ReplayKeyframe keyframe;
+    keyframe.tick = tick;
+    keyframe.streamOffset = streamOffset;
+    keyframe.runSkip = runSkip;
+    keyframe.previousInput = previousInput;
+    packState(state, keyframe.state);
+    keyframe.hash = hashState(state);
+    return keyframe;
+}
+
+ReplayWriter::ReplayWriter(const PongConfig& config, std::uint32_t tickRate, std::uint32_t keyframeInterval) :
+    _header(),
+    _runInput(INPUT_NONE),
+    _runPreviousInput(INPUT_NONE),
+    _runLength(0)
+{
+    _header.magic = REPLAY_MAGIC;
+    _header.version = REPLAY_VERSION;
+    _header.tickRate = tickRate;
+    _header.keyframeInterval = (keyframeInterval > 0) ? keyframeInterval : REPLAY_KEYFRAME_INTERVAL;
+    _header.config = config;
+
+    /* Record() runs in the game loop: reserve the buffers once instead of growing them during the match. */
+    _keyframes.reserve(static_cast<std::size_t>(tickRate) * REPLAY_RESERVED_SECONDS / _header.keyframeInterval + 1);
+    _stream.reserve(REPLAY_RESERVED_STREAM);
+}
+
+void ReplayWriter::record(const PongState& state, std::uint8_t inputs)
+{
+    /* A new run starts whenever the input changes. */
+    if (_runLength > 0 && inputs != _runInput)
+    {
+        closeRun(_stream);
+        _runPreviousInput = _runInput;
+        _runLength = 0;
+    }
+    if (_runLength == 0) _runInput = inputs;
+
+    if (_header.tickCount % _header.keyframeInterval == 0)
+    {
+        _keyframes.push_back(makeKeyframe(_header.tickCount, state, _stream.size(), _runLength, _runPreviousInput));
+    }
+    ++_runLength;
+    ++_header.tickCount;
+}
+
+void ReplayWriter::closeRun(std::vector<std::uint8_t>& stream) const
+{
+    stream.push_back(_runInput ^ _runPreviousInput);
+    for (std::uint32_t length = _runLength; ; length >>= 7)
+    {
+        if (length < 0x80)
+        {
+            stream.push_back(static_cast<std::uint8_t>(length));
+            break;
+        }
+        stream.push_back(static_cast<std::uint8_t>(length | 0x80));
+    }
+}
+
+bool ReplayWriter::save(const std::string& path, const PongState& finalState) const
+{
+    std::vector<std::uint8_t> stream = _stream;
+    std::vector<ReplayKeyframe> keyframes = _keyframes;
+    if (_runLength > 0) closeRun(stream);
+    keyframes.push_back(makeKeyframe(_header.tickCount, finalState, stream.size(), 0, _runInput));
+
+    ReplayHeader header = _header;
+    header.keyframeCount = keyframes.size();
+    header.streamSize = stream.size();
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        printf("Unable to create %s\n", path.c_str());
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(keyframes.data(), sizeof(ReplayKeyframe), keyframes.size(), file) == keyframes.size() &&
+                   (stream.empty() || fwrite(stream.data(), stream.size(), 1, file) == 1);
+    if (fclose(file) != 0) written = false;
+    if (!written) printf("Unable to write %s\n", path.c_str());
+    return written;
+}
+
+std::uint64_t ReplayWriter::tickCount() const
+{
+    return _header.tickCount;
+}
+
+Replay::Replay() :
+    _header(),
+    _keyframes(nullptr),
+    _stream(nullptr),
+    _tick(0),
+    _offset(0),
+    _input(INPUT_NONE),
+    _runLeft(0)
+{}
+
+bool Replay::open(const std::string& path)
+{
+    _keyframes = nullptr;
+    _stream = nullptr;
+    if (!_file.open(path)) return false;
+
+    /* Check that the sections fit in the file before using them in place. */
+    if (_file.size() < sizeof(ReplayHeader))
+    {
+        printf("%s is not a replay\n", path.c_str());
+        return false;
+    }
+    std::copy(_file.data(), _file.data() + sizeof(ReplayHeader), reinterpret_cast<unsigned char*>(&_header));
+    if (_header.magic != REPLAY_MAGIC || _header.version != REPLAY_VERSION)
+    {
+        printf("%s is not a replay of version %u\n", path.c_str(), REPLAY_VERSION);
+        return false;
+    }
+    std::size_t available = _file.size() - sizeof(ReplayHeader);
+    if (_header.keyframeCount == 0 || _header.keyframeInterval == 0 ||
+        _header.keyframeCount > available / sizeof(ReplayKeyframe) ||
+        _header.streamSize != available - _header.keyframeCount * sizeof(ReplayKeyframe))
+    {
+        printf("%s is truncated or corrupted\n", path.c_str());
+        return false;
+    }
+    _keyframes = reinterpret_cast<const ReplayKeyframe*>(_file.data() + sizeof(ReplayHeader));
+    _stream = _file.data() + sizeof(ReplayHeader) + _header.keyframeCount * sizeof(ReplayKeyframe);
+    if (_keyframes[0].tick != 0)
+    {
+        printf("%s has no initial keyframe\n", path.c_str());
+        _keyframes = nullptr;
+        return false;
+    }
+
+    _tick = 0;
+    _offset = 0;
+    _input = INPUT_NONE;
+    _runLeft = 0;
+    return true;
+}
+
+const PongConfig& Replay::config() const
+{
+    return _header.config;
+}
+
+std::uint32_t Replay::tickRate() const
+{
+    return _header.tickRate;
+}
+
+std::uint64_t Replay::tickCount() const
+{
+    return _header.tickCount;
+}
+
+std::uint64_t Replay::tick() const
+{
+    return _tick;
+}
+
+bool Replay::seek(std::uint64_t tick, PongState& state)
+{
+    if (_keyframes == nullptr || tick > _header.tickCount) return false;
+
+    /* Last keyframe at or before the tick. */
+    const ReplayKeyframe* end = _keyframes + _header.keyframeCount;
+    const ReplayKeyframe* keyframe = std::upper_bound(_keyframes, end, tick,
+                                                      [](std::uint64_t t, const ReplayKeyframe& k) { return t < k.tick; }) - 1;
+    unpackState(keyframe->state, state);
+    _tick = keyframe->tick;
+    _offset = static_cast<std::size_t>(keyframe->streamOffset);
+    _input = static_cast<std::uint8_t>(keyframe->previousInput);
+    _runLeft = 0;
+    if (_tick < _header.tickCount)
+    {
+        if (!readRun() || _runLeft <= keyframe->runSkip) return false;
+        _runLeft -= keyframe->runSkip;
+    }
+
+    /* Simulate from the keyframe to the requested tick. */
+    std::uint8_t inputs;
+    while (_tick < tick)
+    {
+        if (!next(inputs)) return false;
+        step(state, _header.config, inputs);
+    }
+    return true;
+}
+
+bool Replay::next(std::uint8_t& inputs)
+{
+    if (_tick >= _header.tickCount) return false;
+    if (_runLeft == 0 && !readRun()) return false;
+    inputs = _input;
+    --_runLeft;
+    ++_tick;
+    return true;
+}
+
+bool Replay::readRun()
+{
+    if (_offset >= _header.streamSize) return false;
+    std::uint8_t delta = _stream[_offset++];
+
+    std::uint64_t length = 0;
+    for (int shift = 0; ; shift += 7)
+    {
+        if (_offset >= _header.streamSize || shift > 63) return false;
+        std::uint8_t byte = _stream[_offset++];
+        length |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) break;
+    }
+    if (length == 0) return false;
+
+    _input ^= delta;
+    _runLeft = length;
+    return true;
+}
+
+bool Replay::verify(const PongState& state) const
+{
+    if (_keyframes == nullptr) return true;
+    if (_tick % _header.keyframeInterval != 0 && _tick != _header.tickCount) return true;
+
+    const ReplayKeyframe* end = _keyframes + _header.keyframeCount;
+    const ReplayKeyframe* keyframe = std::lower_bound(_keyframes, end, _tick,
+                                                      [](const ReplayKeyframe& k, std::uint64_t t) { return k.tick < t; });
+    if (keyframe == end || keyframe->tick != _tick) return true;
+    return keyframe->hash == hashState(state);
+}
+
+bool runReplay(Replay& replay, std::uint64_t startTick, ReplayResult& result)
+{
+    result.ticks = 0;
+    result.mismatchTick = REPLAY_NO_MISMATCH;
+    if (!replay.seek(startTick, result.state)) return false;
+
+    std::uint8_t inputs;
+    for (;;)
+    {
+        if (result.mismatchTick == REPLAY_NO_MISMATCH && !replay.verify(result.state)) result.mismatchTick = replay.tick();
+        if (!replay.next(inputs)) break;
+        step(result.state, replay.config(), inputs);
+        ++result.ticks;
+    }
+    return replay.tick() == replay.tickCount();
+}
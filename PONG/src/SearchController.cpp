@@ -0,0 +1,302 @@
+#include "../include/SearchController.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "../include/Predictor.h"
+
+/* Node of the search tree: the state after the moves from the root, and the statistics of the rollouts through it. */
+struct SearchController::Node
+{
+    PongState state;
+    Node* parent;
+    Node* children[3]; /* By PlayerMoved + 1, created in that order. */
+    int expanded; /* Children created. */
+    std::uint32_t visits;
+    float value; /* Sum of the values of the rollouts. */
+    bool terminal; /* The rally is decided in this node. */
+    float terminalValue;
+};
+
+/* Value of a rally that is still undecided when the rollout stops. */
+static const float UNDECIDED_VALUE = 0.3f;
+
+/* Ticks before the ball reaches the pad that a rollout simulates with step(), the ones before are jumped. */
+static const std::int32_t ROLLOUT_TICKS = 8;
+
+/* Is the ball moving away from the pad of this side? */
+static bool movingAway(const PongState& state, bool rightSide)
+{
+    return rightSide ? state.ballSpeedX < 0 : state.ballSpeedX > 0;
+}
+
+/* Move a pad towards targetY by at most ticks moves, within its limits. */
+static std::int32_t slidePad(const PongConfig& config, std::int32_t playerY, std::int32_t targetY, std::int32_t ticks)
+{
+    std::int64_t distance = static_cast<std::int64_t>(targetY) - (playerY + config.playerHeight / 2);
+    std::int64_t reach = static_cast<std::int64_t>(ticks) * config.playerSpeed;
+    std::int64_t y = playerY + ((distance < -reach) ? -reach : (distance > reach) ? reach : distance);
+    return static_cast<std::int32_t>((y < config.playerUpperLimit) ? config.playerUpperLimit : (y > config.playerLowerLimit) ? config.playerLowerLimit : y);
+}
+
+/*
+    Advance a ball coming to the pad of this side by ticks that cannot reach it, in closed form: until then only the
+    walls act on the ball, and the pads simply slide towards their targets. Approximate, for the rollouts only.
+*/
+static void jumpAhead(PongState& state, const PongConfig& config, bool rightSide, std::int32_t ticks, std::int32_t ownTargetY)
+{
+    std::int64_t span = config.ballLowerLimit - config.playerUpperLimit;
+    std::int64_t offset = (state.ballY - config.playerUpperLimit + static_cast<std::int64_t>(state.ballSpeedY) * ticks) % (2 * span);
+    if (offset < 0) offset += 2 * span;
+    if (offset > span)
+    {
+        /* An odd number of wall bounces. */
+        offset = 2 * span - offset;
+        state.ballSpeedY = -state.ballSpeedY;
+    }
+    state.ballX += state.ballSpeedX * ticks;
+    state.ballY = static_cast<std::int32_t>(config.playerUpperLimit + offset);
+
+    std::int32_t& ownY = rightSide ? state.rightPlayerY : state.leftPlayerY;
+    std::int32_t& otherY = rightSide ? state.leftPlayerY : state.rightPlayerY;
+    ownY = slidePad(config, ownY, ownTargetY, ticks);
+    otherY = slidePad(config, otherY, state.ballY + config.ballHeight / 2, ticks);
+}
+
+SearchController::SearchController(const SearchSettings& settings) :
+    _settings(settings),
+    _arena(settings.arenaBytes),
+    _random(1),
+    _move(PlayerMoved::NA),
+    _moveTicksLeft(0),
+    _searches(0),
+    _iterations(0)
+{
+    if (_settings.ticksPerMove < 1) _settings.ticksPerMove = 1;
+}
+
+void SearchController::reset(std::uint32_t seed)
+{
+    _random = (seed != 0) ? seed : 1;
+    _move = PlayerMoved::NA;
+    _moveTicksLeft = 0;
+}
+
+ControllerAction SearchController::act(const PongState& state, const PongConfig& config, bool rightSide)
+{
+    ControllerAction action = { PlayerMoved::NA, false };
+    bool hasBall = state.lock && (state.lockSide == rightSide);
+    if (hasBall)
+    {
+        /* Serve in the direction whose spin sends the ball the farthest from the opponent. */
+        float bestValue = -1.0f;
+        for (int move = -1; move <= 1; ++move)
+        {
+            ControllerAction serve = { static_cast<PlayerMoved>(move), true };
+            PongState clone = state;
+            step(clone, config, toInput(serve, rightSide));
+            float value = evaluateReturn(clone, config, rightSide);
+            if (value > bestValue)
+            {
+                bestValue = value;
+                action = serve;
+            }
+        }
+        return action;
+    }
+    if (state.lock)
+    {
+        action.move = moveTowards(state, config, rightSide, config.playerLockY + config.playerHeight / 2);
+        return action;
+    }
+
+    /* Far balls only need the pad under them, the search picks where the ball meets the pad and with which spin. */
+    std::int32_t ticks = ticksToSide(state, config, rightSide);
+    if (movingAway(state, rightSide) || ticks > _settings.window)
+    {
+        _moveTicksLeft = 0;
+        action.move = moveTowards(state, config, rightSide, predictBallY(state, config, rightSide) + config.ballHeight / 2);
+        return action;
+    }
+    if (_moveTicksLeft <= 0)
+    {
+        _move = search(state, config, rightSide);
+        _moveTicksLeft = _settings.ticksPerMove;
+    }
+    --_moveTicksLeft;
+    action.move = _move;
+    return action;
+}
+
+std::uint64_t SearchController::getSearches() const
+{
+    return _searches;
+}
+
+std::uint64_t SearchController::getIterations() const
+{
+    return _iterations;
+}
+
+std::uint32_t SearchController::nextRandom()
+{
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return _random;
+}
+
+PlayerMoved SearchController::search(const PongState& state, const PongConfig& config, bool rightSide)
+{
+    _arena.reset();
+    Node* root = _arena.create<Node>();
+    if (root == nullptr) return PlayerMoved::NA;
+    root->state = state;
+
+    auto start = std::chrono::steady_clock::now();
+    const auto budget = std::chrono::microseconds(_settings.budgetMicroseconds);
+    int iteration = 0;
+    for (; iteration < _settings.maxIterations; ++iteration)
+    {
+        if (_settings.budgetMicroseconds != 0 && (iteration & 63) == 63 && std::chrono::steady_clock::now() - start >= budget) break;
+
+        /* Selection: follow the best UCT child down to a node that still has a move to try. */
+        Node* node = root;
+        while (!node->terminal && node->expanded == 3)
+        {
+            float logVisits = std::log(static_cast<float>(node->visits));
+            Node* best = nullptr;
+            float bestScore = -1.0f;
+            for (Node* child : node->children)
+            {
+                float score = child->value / child->visits + _settings.exploration * std::sqrt(logVisits / child->visits);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = child;
+                }
+            }
+            node = best;
+        }
+
+        /* Expansion of the next move, then a rollout from the new node. A full arena rolls out from the leaf. */
+        float value;
+        if (node->terminal)
+        {
+            value = node->terminalValue;
+        }
+        else
+        {
+            Node* child = _arena.create<Node>();
+            if (child != nullptr)
+            {
+                child->state = node->state;
+                child->parent = node;
+                node->children[node->expanded] = child;
+                PlayerMoved move = static_cast<PlayerMoved>(node->expanded - 1);
+                ++node->expanded;
+                child->terminal = advance(child->state, config, rightSide, move, _settings.ticksPerMove, child->terminalValue);
+                node = child;
+            }
+            value = node->terminal ? node->terminalValue : rollout(node->state, config, rightSide);
+        }
+
+        for (; node != nullptr; node = node->parent)
+        {
+            ++node->visits;
+            node->value += value;
+        }
+    }
+    ++_searches;
+    _iterations += iteration;
+
+    /* The most visited move is the most robust choice. */
+    PlayerMoved move = PlayerMoved::NA;
+    std::uint32_t mostVisits = 0;
+    for (int i = 0; i < root->expanded; ++i)
+    {
+        if (root->children[i]->visits > mostVisits)
+        {
+            mostVisits = root->children[i]->visits;
+            move = static_cast<PlayerMoved>(i - 1);
+        }
+    }
+    return move;
+}
+
+bool SearchController::advance(PongState& state, const PongConfig& config, bool rightSide, PlayerMoved move, int ticks, float& value)
+{
+    ControllerAction own = { move, false };
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        ControllerAction other = _opponent.act(state, config, !rightSide);
+        other.serve = false;
+        std::uint8_t events = step(state, config, toInput(own, rightSide) | toInput(other, !rightSide));
+        if (events & (EVENT_LEFT_SCORED | EVENT_RIGHT_SCORED))
+        {
+            value = (events & (rightSide ? EVENT_RIGHT_SCORED : EVENT_LEFT_SCORED)) ? 1.0f : 0.0f;
+            return true;
+        }
+        if ((events & EVENT_PAD_HIT) && movingAway(state, rightSide))
+        {
+            value = evaluateReturn(state, config, rightSide);
+            return true;
+        }
+    }
+    return false;
+}
+
+float SearchController::rollout(PongState state, const PongConfig& config, bool rightSide)
+{
+    /* Aim for a random point of the pad, with a random move now and then. */
+    std::int32_t offset = static_cast<std::int32_t>(nextRandom() % static_cast<std::uint32_t>(config.playerHeight + 1)) - config.playerHeight / 2;
+    std::int32_t ticks = ticksToSide(state, config, rightSide);
+    if (!movingAway(state, rightSide) && ticks > ROLLOUT_TICKS)
+    {
+        jumpAhead(state, config, rightSide, ticks - ROLLOUT_TICKS, predictBallY(state, config, rightSide) + config.ballHeight / 2 + offset);
+    }
+
+    float value = UNDECIDED_VALUE;
+    for (int ticks = 0; ticks < 2 * _settings.window; ticks += _settings.ticksPerMove)
+    {
+        std::uint32_t random = nextRandom();
+        PlayerMoved move = (random % 4 == 0) ? static_cast<PlayerMoved>(static_cast<int>((random >> 8) % 3) - 1)
+                                             : moveTowards(state, config, rightSide, predictBallY(state, config, rightSide) + config.ballHeight / 2 + offset);
+        if (advance(state, config, rightSide, move, _settings.ticksPerMove, value)) return value;
+    }
+    return UNDECIDED_VALUE;
+}
+
+float SearchController::evaluateReturn(const PongState& state, const PongConfig& config, bool rightSide) const
+{
+    /* A ball the opponent cannot reach in time is a goal. */
+    std::int32_t ticks = ticksToSide(state, config, !rightSide);
+    if (ticks < 0) return UNDECIDED_VALUE;
+    std::int64_t ballCentre = predictBallY(state, config, !rightSide) + config.ballHeight / 2;
+    std::int64_t padCentre = (rightSide ? state.leftPlayerY : state.rightPlayerY) + config.playerHeight / 2;
+    std::int64_t margin = (config.playerHeight + config.ballHeight) / 2; /* Largest distance between the centres at which the pad touches the ball. */
+    std::int64_t reach = static_cast<std::int64_t>(ticks + 1) * config.playerSpeed;
+    if (std::llabs(ballCentre - padCentre) - margin >= reach) return 1.0f;
+
+    /*
+        Otherwise the opponent misses when its aim, off by up to opponentNoise either way, is off by more than the
+        margin. An error towards a border closer than the margin is harmless: the border stops the pad in time.
+    */
+    std::int64_t noise = static_cast<std::int64_t>(_settings.opponentNoise) * config.playerHeight / 1000;
+    if (noise <= margin) return UNDECIDED_VALUE;
+    float missOneSide = static_cast<float>(noise - margin) / (2 * noise);
+    float miss = 0.0f;
+    if (ballCentre - (config.playerUpperLimit + config.playerHeight / 2) > margin) miss += missOneSide;
+    if ((config.playerLowerLimit + config.playerHeight / 2) - ballCentre > margin) miss += missOneSide;
+    return UNDECIDED_VALUE + (1.0f - UNDECIDED_VALUE) * miss;
+}
+
+PlayerMoved SearchController::moveTowards(const PongState& state, const PongConfig& config, bool rightSide, std::int32_t targetY) const
+{
+    std::int32_t playerY = rightSide ? state.rightPlayerY : state.leftPlayerY;
+    std::int32_t distance = targetY - (playerY + config.playerHeight / 2);
+    if (distance < -config.playerSpeed / 2) return PlayerMoved::UP;
+    if (distance > config.playerSpeed / 2) return PlayerMoved::DOWN;
+    return PlayerMoved::NA;
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <string>
+#include <thread>
+
+#include "../include/GameServer.h"
+
+/* Server settings, from the command line. */
+struct ServerOptions
+{
+    ServerSettings server;
+    double duration = 0.0; /* Seconds to run, 0 -> until interrupted. */
+    double reportInterval = 1.0; /* Seconds between two metric reports. */
+    std::string metricsPath; /* CSV file of the reports, empty if none. */
+};
+
+static std::atomic<bool> interrupted(false);
+
+static void onInterrupt(int)
+{
+    interrupted = true;
+}
+
+static void printUsage()
+{
+    printf("Usage: Server [--port N] [--shards N] [--tick-rate N] [--snapshot-interval N] [--goals N] [--timeout ms] [--max-rooms N]\n");
+    printf("              [--duration s] [--report s] [--metrics file.csv]\n");
+}
+
+static bool parseArguments(int argc, char* args[], ServerOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* option = args[i];
+        const char* value = (i + 1 < argc) ? args[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            printf("Missing value for %s\n", option);
+            return false;
+        }
+        if (strcmp(option, "--port") == 0) options.server.port = static_cast<std::uint16_t>(atoi(value));
+        else if (strcmp(option, "--shards") == 0) options.server.shards = static_cast<unsigned int>(atoi(value));
+        else if (strcmp(option, "--tick-rate") == 0) options.server.tickRate = static_cast<unsigned int>(atoi(value));
+        else if (strcmp(option, "--snapshot-interval") == 0) options.server.snapshotInterval = static_cast<unsigned int>(atoi(value));
+        else if (strcmp(option, "--goals") == 0) options.server.goalsToWin = atoi(value);
+        else if (strcmp(option, "--timeout") == 0) options.server.timeout = static_cast<unsigned int>(atoi(value));
+        else if (strcmp(option, "--max-rooms") == 0) options.server.maxRooms = strtoull(value, nullptr, 10);
+        else if (strcmp(option, "--duration") == 0) options.duration = atof(value);
+        else if (strcmp(option, "--report") == 0) options.reportInterval = atof(value);
+        else if (strcmp(option, "--metrics") == 0) options.metricsPath = value;
+        else
+        {
+            printf("Unknown option %s\n", option);
+            return false;
+        }
+        ++i;
+    }
+
+    if (options.server.port == 0 || options.server.tickRate == 0 || options.reportInterval <= 0.0)
+    {
+        printf("A port, a tick rate and a report interval are required\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* args[])
+{
+    ServerOptions options;
+    if (!parseArguments(argc, args, options))
+    {
+        printUsage();
+        return -1;
+    }
+
+    GameServer server(options.server);
+    if (!server.start()) return -1;
+    if (server.shardCount() > 1 && server.shardPort(0) != server.shardPort(1))
+    {
+        printf("Serving on UDP ports %u to %u, one per shard\n", server.shardPort(0), server.shardPort(server.shardCount() - 1));
+    }
+    else
+    {
+        printf("Serving on UDP port %u with %u shards\n", server.shardPort(0), server.shardCount());
+    }
+
+    FILE* csv = nullptr;
+    if (!options.metricsPath.empty())
+    {
+        csv = fopen(options.metricsPath.c_str(), "w");
+        if (csv == nullptr) printf("Unable to create %s\n", options.metricsPath.c_str());
+        else fprintf(csv, "time_s,rooms,waiting,tick_p50_us,tick_p99_us,tick_max_us,us_per_room_tick,busy_cores,rooms_per_core,packets_in_per_s,packets_out_per_s,late_ticks,matches_finished\n");
+    }
+
+    signal(SIGINT, onInterrupt);
+    auto start = std::chrono::steady_clock::now();
+    auto nextReport = start;
+    server.collectMetrics();
+    while (!interrupted)
+    {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (options.duration > 0.0 && elapsed >= options.duration) break;
+
+        nextReport += std::chrono::microseconds(static_cast<long long>(options.reportInterval * 1e6));
+        while (!interrupted && std::chrono::steady_clock::now() < nextReport) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        /* The wall time of the metrics is summed over the shards. */
+        ServerMetrics metrics = server.collectMetrics();
+        double wall = metrics.seconds / server.shardCount();
+        if (wall <= 0.0) continue;
+        double busyCores = metrics.busySeconds / wall;
+        double perRoomTick = (metrics.roomTicks > 0) ? metrics.busySeconds * 1e6 / metrics.roomTicks : 0.0;
+        double roomsPerCore = metrics.roomsPerCore(options.server.tickRate);
+
+        printf("rooms %llu, waiting %llu, tick p50 %.0f us p99 %.0f us max %llu us, %.2f us per room tick, %.2f cores busy, %.0f rooms per core, %.0f/%.0f packets/s in/out",
+               static_cast<unsigned long long>(metrics.rooms), static_cast<unsigned long long>(metrics.waitingPlayers),
+               metrics.tickPercentile(50.0), metrics.tickPercentile(99.0), static_cast<unsigned long long>(metrics.maxTickTime),
+               perRoomTick, busyCores, roomsPerCore, metrics.packetsIn / wall, metrics.packetsOut / wall);
+        if (metrics.lateTicks > 0) printf(", %llu late ticks", static_cast<unsigned long long>(metrics.lateTicks));
+        printf("\n");
+        if (csv != nullptr)
+        {
+            fprintf(csv, "%.1f,%llu,%llu,%.0f,%.0f,%llu,%.3f,%.3f,%.0f,%.0f,%.0f,%llu,%llu\n", elapsed + wall,
+                    static_cast<unsigned long long>(metrics.rooms), static_cast<unsigned long long>(metrics.waitingPlayers),
+                    metrics.tickPercentile(50.0), metrics.tickPercentile(99.0), static_cast<unsigned long long>(metrics.maxTickTime),
+                    perRoomTick, busyCores, roomsPerCore, metrics.packetsIn / wall, metrics.packetsOut / wall,
+                    static_cast<unsigned long long>(metrics.lateTicks), static_cast<unsigned long long>(metrics.matchesFinished));
+            fflush(csv);
+        }
+    }
+
+    server.stop();
+    if (csv != nullptr) fclose(csv);
+    return 0;
+}
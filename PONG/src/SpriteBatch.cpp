@@ -0,0 +1,81 @@
+#include "../include/SpriteBatch.h"
+
+SpriteBatch::SpriteBatch() :
+    _atlas(nullptr)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    _vertices.reserve(RESERVED_QUADS * 4);
+    _indices.reserve(RESERVED_QUADS * 6);
+#else
+    _sources.reserve(RESERVED_QUADS);
+    _destinations.reserve(RESERVED_QUADS);
+#endif
+}
+
+void SpriteBatch::begin(const TextureAtlas& atlas)
+{
+    /* The buffers keep their capacity, so a steady frame does not allocate. */
+    _atlas = &atlas;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    _vertices.clear();
+    _indices.clear();
+#else
+    _sources.clear();
+    _destinations.clear();
+#endif
+}
+
+void SpriteBatch::draw(int id, const SDL_Rect& destRect)
+{
+    draw(_atlas->getRegion(id), destRect);
+}
+
+void SpriteBatch::draw(const SDL_Rect& source, const SDL_Rect& destRect)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    float u0 = static_cast<float>(source.x) / _atlas->getWidth();
+    float v0 = static_cast<float>(source.y) / _atlas->getHeight();
+    float u1 = static_cast<float>(source.x + source.w) / _atlas->getWidth();
+    float v1 = static_cast<float>(source.y + source.h) / _atlas->getHeight();
+    float x0 = static_cast<float>(destRect.x);
+    float y0 = static_cast<float>(destRect.y);
+    float x1 = static_cast<float>(destRect.x + destRect.w);
+    float y1 = static_cast<float>(destRect.y + destRect.h);
+    const SDL_Color white = { 255, 255, 255, 255 };
+
+    int first = static_cast<int>(_vertices.size());
+    _vertices.push_back({ { x0, y0 }, white, { u0, v0 } });
+    _vertices.push_back({ { x1, y0 }, white, { u1, v0 } });
+    _vertices.push_back({ { x1, y1 }, white, { u1, v1 } });
+    _vertices.push_back({ { x0, y1 }, white, { u0, v1 } });
+    const int corners[] = { 0, 1, 2, 0, 2, 3 };
+    for (int corner : corners) _indices.push_back(first + corner);
+#else
+    _sources.push_back(source);
+    _destinations.push_back(destRect);
+#endif
+}
+
+void SpriteBatch::end(SDL_Renderer* renderer)
+{
+    if (_atlas == nullptr) return;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (!_indices.empty())
+    {
+        SDL_RenderGeometry(renderer, _atlas->getTexture(), _vertices.data(), static_cast<int>(_vertices.size()),
+                           _indices.data(), static_cast<int>(_indices.size()));
+    }
+#else
+    for (std::size_t i = 0; i < _sources.size(); ++i) SDL_RenderCopy(renderer, _atlas->getTexture(), &_sources[i], &_destinations[i]);
+#endif
+    _atlas = nullptr;
+}
+
+int SpriteBatch::getQuadCount() const
+{
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    return static_cast<int>(_indices.size() / 6);
+#else
+    return static_cast<int>(_sources.size());
+#endif
+}
@@ -0,0 +1,342 @@
+#include "../include/TextureAtlas.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+
+#include <SDL_image.h>
+
+/* Source pixel and weight of a filter tap. */
+struct FilterTap
+{
+    int index;
+    float weight;
+};
+
+/*
+    Taps of a tent filter resampling sourceSize pixels to size pixels, for every destination pixel.
+    The filter is one destination pixel wide when shrinking and one source pixel wide (bilinear) when enlarging.
+*/
+static std::vector<std::vector<FilterTap>> filterTaps(int sourceSize, int size)
+{
+    std::vector<std::vector<FilterTap>> taps(size);
+    float scale = static_cast<float>(sourceSize) / size;
+    float radius = std::max(scale, 1.0f);
+    for (int i = 0; i < size; ++i)
+    {
+        float centre = (i + 0.5f) * scale - 0.5f;
+        float total = 0.0f;
+        for (int j = static_cast<int>(std::floor(centre - radius)) + 1; j < centre + radius; ++j)
+        {
+            float weight = 1.0f - std::fabs(j - centre) / radius;
+            if (weight <= 0.0f) continue;
+            taps[i].push_back({ std::min(std::max(j, 0), sourceSize - 1), weight });
+            total += weight;
+        }
+        for (auto& tap : taps[i]) tap.weight /= total;
+    }
+    return taps;
+}
+
+/*
+    Resample an image to the given size. Colours are weighted by alpha, so that the transparent pixels
+    around a sprite do not darken its edges. Returns a new RGBA32 surface, or null on failure.
+*/
+static SDL_Surface* resample(SDL_Surface* source, int width, int height)
+{
+    /* Flatten the image and its colour key to RGBA first. */
+    SDL_Surface* image = SDL_CreateRGBSurfaceWithFormat(0, source->w, source->h, 32, SDL_PIXELFORMAT_RGBA32);
+    SDL_Surface* result = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (image == nullptr || result == nullptr)
+    {
+        printf("%s", SDL_GetError());
+        SDL_FreeSurface(image);
+        SDL_FreeSurface(result);
+        return nullptr;
+    }
+    SDL_SetSurfaceBlendMode(source, SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(source, nullptr, image, nullptr);
+
+    std::vector<std::vector<FilterTap>> columns = filterTaps(source->w, width);
+    std::vector<std::vector<FilterTap>> rows = filterTaps(source->h, height);
+    std::vector<float> row(4 * source->w); /* Vertically filtered source row, alpha premultiplied. */
+    for (int y = 0; y < height; ++y)
+    {
+        std::fill(row.begin(), row.end(), 0.0f);
+        for (const FilterTap& tap : rows[y])
+        {
+            const Uint8* pixel = static_cast<const Uint8*>(image->pixels) + tap.index * image->pitch;
+            for (int x = 0; x < source->w; ++x, pixel += 4)
+            {
+                float alpha = tap.weight * pixel[3];
+                row[4 * x] += alpha * pixel[0];
+                row[4 * x + 1] += alpha * pixel[1];
+                row[4 * x + 2] += alpha * pixel[2];
+                row[4 * x + 3] += alpha;
+            }
+        }
+
+        Uint8* pixel = static_cast<Uint8*>(result->pixels) + y * result->pitch;
+        for (int x = 0; x < width; ++x, pixel += 4)
+        {
+            float colour[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (const FilterTap& tap : columns[x])
+            {
+                for (int c = 0; c < 4; ++c) colour[c] += tap.weight * row[4 * tap.index + c];
+            }
+            for (int c = 0; c < 3; ++c) pixel[c] = (colour[3] > 0.0f) ? static_cast<Uint8>(std::min(colour[c] / colour[3], 255.0f) + 0.5f) : 0;
+            pixel[3] = static_cast<Uint8>(std::min(colour[3], 255.0f) + 0.5f);
+        }
+    }
+    SDL_FreeSurface(image);
+    return result;
+}
+
+TextureAtlas::TextureAtlas() :
+    _texture(nullptr),
+    _width(0),
+    _height(0)
+{}
+
+TextureAtlas::~TextureAtlas()
+{
+    freeSurfaces();
+    freeTexture();
+}
+
+void TextureAtlas::freeSurfaces()
+{
+    freePrepared();
+    for (SDL_Surface* surface : _surfaces) SDL_FreeSurface(surface);
+    _surfaces.clear();
+    _prepared.clear();
+    _sizes.clear();
+}
+
+void TextureAtlas::freePrepared()
+{
+    for (SDL_Surface*& surface : _prepared)
+    {
+        if (surface != nullptr) SDL_FreeSurface(surface);
+        surface = nullptr;
+    }
+}
+
+void TextureAtlas::freeTexture()
+{
+    if (_texture != nullptr)
+    {
+        SDL_DestroyTexture(_texture);
+        _texture = nullptr;
+    }
+    _regions.clear();
+    _width = 0;
+    _height = 0;
+}
+
+SDL_Surface* TextureAtlas::loadImage(const std::string& path)
+{
+    SDL_Surface* surface = IMG_Load(path.c_str());
+    if (surface == nullptr)
+    {
+        printf("%s", IMG_GetError());
+        return nullptr;
+    }
+    SDL_SetColorKey(surface, SDL_TRUE, SDL_MapRGB(surface->format, 0, 255, 255));
+    return surface;
+}
+
+SDL_Surface* TextureAtlas::renderText(TTF_Font* font, const std::string& text, SDL_Color colour)
+{
+    SDL_Surface* surface = TTF_RenderText_Solid(font, text.c_str(), colour);
+    if (surface == nullptr) printf("%s", TTF_GetError());
+    return surface;
+}
+
+bool TextureAtlas::addImage(const std::string& path, int& id)
+{
+    SDL_Surface* surface = loadImage(path);
+    if (surface == nullptr) return false;
+    addSurface(surface, id);
+    return true;
+}
+
+bool TextureAtlas::addText(TTF_Font* font, const std::string& text, SDL_Color colour, int& id)
+{
+    SDL_Surface* surface = renderText(font, text, colour);
+    if (surface == nullptr) return false;
+    addSurface(surface, id);
+    return true;
+}
+
+void TextureAtlas::addSurface(SDL_Surface* surface, int& id)
+{
+    id = static_cast<int>(_surfaces.size());
+    _surfaces.push_back(surface);
+    _prepared.push_back(nullptr);
+    _sizes.push_back({ surface->w, surface->h });
+}
+
+void TextureAtlas::replaceImage(int id, SDL_Surface* surface)
+{
+    if (_prepared[id] != nullptr) SDL_FreeSurface(_prepared[id]);
+    _prepared[id] = surface;
+}
+
+void TextureAtlas::getImageSize(int id, int& width, int& height) const
+{
+    width = _surfaces[id]->w;
+    height = _surfaces[id]->h;
+}
+
+void TextureAtlas::setImageSize(int id, int width, int height)
+{
+    _sizes[id] = { std::max(width, 1), std::max(height, 1) };
+}
+
+SDL_Surface* TextureAtlas::copyImage(int id) const
+{
+    SDL_Surface* source = _surfaces[id];
+    if (_sizes[id].x != source->w || _sizes[id].y != source->h) return resample(source, _sizes[id].x, _sizes[id].y);
+
+    /* Flatten the colour key to alpha, as build() does. */
+    SDL_Surface* copy = SDL_CreateRGBSurfaceWithFormat(0, source->w, source->h, 32, SDL_PIXELFORMAT_RGBA32);
+    if (copy == nullptr)
+    {
+        printf("%s", SDL_GetError());
+        return nullptr;
+    }
+    SDL_SetSurfaceBlendMode(source, SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(source, nullptr, copy, nullptr);
+    return copy;
+}
+
+bool TextureAtlas::build(SDL_Renderer* renderer)
+{
+    /* The images at the size they are drawn at: prepared, original, or resampled for this build only. */
+    std::vector<SDL_Surface*> images(_surfaces.size());
+    std::vector<SDL_Surface*> resampled;
+    bool success = true;
+    for (std::size_t id = 0; id < _surfaces.size(); ++id)
+    {
+        SDL_Surface* prepared = _prepared[id];
+        if (prepared != nullptr && _sizes[id].x == prepared->w && _sizes[id].y == prepared->h) images[id] = prepared;
+        else if (_sizes[id].x == _surfaces[id]->w && _sizes[id].y == _surfaces[id]->h) images[id] = _surfaces[id];
+        else
+        {
+            images[id] = resample(_surfaces[id], _sizes[id].x, _sizes[id].y);
+            if (images[id] == nullptr)
+            {
+                success = false;
+                break;
+            }
+            resampled.push_back(images[id]);
+        }
+    }
+
+    SDL_Texture* texture = nullptr;
+    std::vector<SDL_Rect> regions;
+    int atlasWidth = 0, atlasHeight = 0;
+    if (success) success = pack(renderer, images, texture, regions, atlasWidth, atlasHeight);
+    for (SDL_Surface* surface : resampled) SDL_FreeSurface(surface);
+    freePrepared();
+    if (!success) return false;
+
+    freeTexture();
+    _texture = texture;
+    _regions.swap(regions);
+    _width = atlasWidth;
+    _height = atlasHeight;
+    return true;
+}
+
+bool TextureAtlas::pack(SDL_Renderer* renderer, const std::vector<SDL_Surface*>& images, SDL_Texture*& texture, std::vector<SDL_Rect>& regions, int& atlasWidth, int& atlasHeight) const
+{
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) != 0)
+    {
+        printf("%s", SDL_GetError());
+        return false;
+    }
+    int maxWidth = (info.max_texture_width > 0) ? info.max_texture_width : 16384;
+    int maxHeight = (info.max_texture_height > 0) ? info.max_texture_height : 16384;
+
+    /* Shelf packing: the tallest images first, left to right, a new shelf when the row is full. */
+    std::vector<int> order(images.size());
+    for (std::size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+    std::sort(order.begin(), order.end(), [&images](int a, int b) { return images[a]->h > images[b]->h; });
+
+    atlasWidth = 0;
+    for (SDL_Surface* surface : images) atlasWidth = std::max(atlasWidth, surface->w + 2 * PADDING);
+    if (atlasWidth > maxWidth)
+    {
+        printf("An image is wider than the maximum texture size (%d)\n", maxWidth);
+        return false;
+    }
+
+    regions.resize(images.size());
+    int shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (int id : order)
+    {
+        int w = images[id]->w + 2 * PADDING;
+        int h = images[id]->h + 2 * PADDING;
+        if (shelfX + w > atlasWidth)
+        {
+            shelfY += shelfHeight;
+            shelfX = 0;
+            shelfHeight = 0;
+        }
+        regions[id] = { shelfX + PADDING, shelfY + PADDING, images[id]->w, images[id]->h };
+        shelfX += w;
+        shelfHeight = std::max(shelfHeight, h);
+    }
+    atlasHeight = shelfY + shelfHeight;
+    if (atlasHeight > maxHeight)
+    {
+        printf("The texture atlas does not fit in the maximum texture size (%dx%d)\n", maxWidth, maxHeight);
+        return false;
+    }
+
+    /* Copy every image, with its alpha or colour key, to a transparent surface and upload it once. */
+    SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, atlasWidth, atlasHeight, 32, SDL_PIXELFORMAT_RGBA32);
+    if (atlas == nullptr)
+    {
+        printf("%s", SDL_GetError());
+        return false;
+    }
+    for (std::size_t id = 0; id < images.size(); ++id)
+    {
+        SDL_Rect destination = regions[id];
+        SDL_SetSurfaceBlendMode(images[id], SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(images[id], nullptr, atlas, &destination);
+    }
+    texture = SDL_CreateTextureFromSurface(renderer, atlas);
+    SDL_FreeSurface(atlas);
+    if (texture == nullptr)
+    {
+        printf("%s", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+SDL_Texture* TextureAtlas::getTexture() const
+{
+    return _texture;
+}
+
+int TextureAtlas::getWidth() const
+{
+    return _width;
+}
+
+int TextureAtlas::getHeight() const
+{
+    return _height;
+}
+
+const SDL_Rect& TextureAtlas::getRegion(int id) const
+{
+    return _regions[id];
+}
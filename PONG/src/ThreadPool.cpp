@@ -0,0 +1,114 @@
+#include "../include/ThreadPool.h"
+
+/* Pool and index of the worker running on the current thread, if any. */
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local unsigned int currentWorker = 0;
+
+ThreadPool::ThreadPool(unsigned int threads) :
+    _queued(0),
+    _pending(0),
+    _nextQueue(0),
+    _stopping(false)
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (unsigned int i = 0; i < threads; ++i) _queues.emplace_back(new Queue());
+    for (unsigned int i = 0; i < threads; ++i) _workers.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _workAvailable.notify_all();
+    for (auto& worker : _workers) worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    unsigned int index = (currentPool == this) ? currentWorker : (_nextQueue++ % size());
+    ++_pending;
+    {
+        /* Counted before the task can be popped, or a worker could decrement _queued below 0 and wrap it. */
+        std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+        ++_queued;
+        _queues[index]->tasks.push_back(std::move(task));
+    }
+
+    /* Taking the lock orders the notification after a worker has checked _queued and gone to sleep. */
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+    }
+    _workAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _allDone.wait(lock, [this]() { return _pending == 0; });
+}
+
+unsigned int ThreadPool::size() const
+{
+    return static_cast<unsigned int>(_queues.size());
+}
+
+bool ThreadPool::pop(unsigned int index, std::function<void()>& task)
+{
+    /* Newest task of the own queue first, it is the most likely to be hot in cache. */
+    {
+        Queue& queue = *_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+
+    /* Then the oldest task of the other queues. */
+    for (unsigned int offset = 1; offset < size(); ++offset)
+    {
+        Queue& queue = *_queues[(index + offset) % size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(unsigned int index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    std::function<void()> task;
+    while (true)
+    {
+        if (pop(index, task))
+        {
+            --_queued;
+            task();
+            task = nullptr;
+            if (--_pending == 0)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _workAvailable.wait(lock, [this]() { return _stopping || _queued > 0; });
+        if (_stopping && _queued == 0) return;
+    }
+}
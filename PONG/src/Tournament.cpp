@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../include/Controller.h"
+#include "../include/Match.h"
+#include "../include/PongState.h"
+#include "../include/ThreadPool.h"
+
+/* Tournament settings, from the command line. */
+struct TournamentSettings
+{
+    std::vector<std::string> controllers = controllerNames(); /* Participants. */
+    int matchesPerPair = 100; /* Matches played by every pair, alternating sides. */
+    int goalsToWin = 10; /* Goals needed to win a match. */
+    std::uint64_t maxTicks = 240 * 600; /* Ticks after which a match is stopped (10 minutes of play). */
+    unsigned int threads = 0; /* Worker threads, 0 -> one per hardware thread. */
+    std::uint32_t seed = 1; /* Seed of the random controllers. */
+};
+
+/* Statistics of a pair of controllers, from the point of view of the first one. */
+struct PairStats
+{
+    int first;
+    int second;
+    int wins;
+    int losses;
+    int draws;
+    long long scoreDifference;
+    std::uint64_t rallies;
+    std::uint64_t rallyHits;
+    std::uint32_t longestRally;
+};
+
+static void printUsage()
+{
+    printf("Usage: Tournament [--controllers a,b,...] [--matches N] [--goals N] [--max-ticks N] [--threads N] [--seed N]\n");
+    printf("Available controllers:");
+    for (const auto& name : controllerNames()) printf(" %s", name.c_str());
+    printf("\n");
+}
+
+static std::vector<std::string> splitList(const char* list)
+{
+    std::vector<std::string> items;
+    std::string item;
+    for (const char* c = list; ; ++c)
+    {
+        if (*c == ',' || *c == '\0')
+        {
+            if (!item.empty()) items.push_back(item);
+            item.clear();
+            if (*c == '\0') break;
+        }
+        else
+        {
+            item += *c;
+        }
+    }
+    return items;
+}
+
+static bool parseArguments(int argc, char* args[], TournamentSettings& settings)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* option = args[i];
+        const char* value = (i + 1 < argc) ? args[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            printf("Missing value for %s\n", option);
+            return false;
+        }
+        if (strcmp(option, "--controllers") == 0) settings.controllers = splitList(value);
+        else if (strcmp(option, "--matches") == 0) settings.matchesPerPair = atoi(value);
+        else if (strcmp(option, "--goals") == 0) settings.goalsToWin = atoi(value);
+        else if (strcmp(option, "--max-ticks") == 0) settings.maxTicks = strtoull(value, nullptr, 10);
+        else if (strcmp(option, "--threads") == 0) settings.threads = static_cast<unsigned int>(atoi(value));
+        else if (strcmp(option, "--seed") == 0) settings.seed = static_cast<std::uint32_t>(strtoul(value, nullptr, 10));
+        else
+        {
+            printf("Unknown option %s\n", option);
+            return false;
+        }
+        ++i;
+    }
+
+    for (const auto& name : settings.controllers)
+    {
+        if (createController(name) == nullptr)
+        {
+            printf("Unknown controller %s\n", name.c_str());
+            return false;
+        }
+    }
+    if (settings.controllers.size() < 2 || settings.matchesPerPair <= 0 || settings.goalsToWin <= 0)
+    {
+        printf("At least two controllers, one match and one goal are required\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* args[])
+{
+    TournamentSettings settings;
+    if (!parseArguments(argc, args, settings))
+    {
+        printUsage();
+        return -1;
+    }
+
+    PongLayout layout;
+    layout.tickRate = 240;
+    const PongConfig config = makeConfig(layout);
+
+    /* Round robin: every pair plays matchesPerPair matches, swapping sides at every match. */
+    std::vector<PairStats> pairs;
+    for (int i = 0; i < static_cast<int>(settings.controllers.size()); ++i)
+    {
+        for (int j = i + 1; j < static_cast<int>(settings.controllers.size()); ++j)
+        {
+            pairs.push_back({ i, j, 0, 0, 0, 0, 0, 0, 0 });
+        }
+    }
+    std::vector<MatchResult> results(pairs.size() * settings.matchesPerPair);
+
+    ThreadPool pool(settings.threads);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t pair = 0; pair < pairs.size(); ++pair)
+    {
+        for (int match = 0; match < settings.matchesPerPair; ++match)
+        {
+            std::size_t index = pair * settings.matchesPerPair + match;
+            pool.submit([&, pair, match, index]()
+            {
+                bool swapped = (match & 1) != 0;
+                auto first = createController(settings.controllers[pairs[pair].first]);
+                auto second = createController(settings.controllers[pairs[pair].second]);
+                Controller& left = swapped ? *second : *first;
+                Controller& right = swapped ? *first : *second;
+                MatchResult result = playMatch(config, left, right, settings.goalsToWin, settings.maxTicks,
+                                               settings.seed + static_cast<std::uint32_t>(index) * 2654435761u);
+                if (swapped) std::swap(result.leftScore, result.rightScore);
+                results[index] = result;
+            });
+        }
+    }
+    pool.wait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    /* Aggregate the results of every pair. */
+    std::uint64_t totalTicks = 0;
+    for (std::size_t pair = 0; pair < pairs.size(); ++pair)
+    {
+        PairStats& stats = pairs[pair];
+        for (int match = 0; match < settings.matchesPerPair; ++match)
+        {
+            const MatchResult& result = results[pair * settings.matchesPerPair + match];
+            if (result.leftScore > result.rightScore) ++stats.wins;
+            else if (result.leftScore < result.rightScore) ++stats.losses;
+            else ++stats.draws;
+            stats.scoreDifference += result.leftScore - result.rightScore;
+            stats.rallies += result.rallies;
+            stats.rallyHits += result.rallyHits;
+            if (result.longestRally > stats.longestRally) stats.longestRally = result.longestRally;
+            totalTicks += result.ticks;
+        }
+    }
+
+    printf("%-12s %-12s %6s %6s %6s %10s %10s %8s\n", "first", "second", "wins", "losses", "draws", "avg diff", "avg rally", "longest");
+    for (const auto& stats : pairs)
+    {
+        printf("%-12s %-12s %6d %6d %6d %10.2f %10.2f %8u\n",
+               settings.controllers[stats.first].c_str(), settings.controllers[stats.second].c_str(),
+               stats.wins, stats.losses, stats.draws,
+               static_cast<double>(stats.scoreDifference) / settings.matchesPerPair,
+               (stats.rallies > 0) ? static_cast<double>(stats.rallyHits) / stats.rallies : 0.0,
+               stats.longestRally);
+    }
+    printf("\n%zu matches, %llu steps in %.3f s on %u threads: %.1f matches/s, %.2f Msteps/s\n",
+           results.size(), static_cast<unsigned long long>(totalTicks), seconds, pool.size(),
+           results.size() / seconds, totalTicks / seconds / 1e6);
+
+    return 0;
+}
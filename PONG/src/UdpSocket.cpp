@@ -0,0 +1,272 @@
+#include "../include/UdpSocket.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+static const UdpSocket::Handle NO_SOCKET = INVALID_SOCKET;
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+static const UdpSocket::Handle NO_SOCKET = -1;
+#endif
+
+#if defined(_WIN32)
+/* Winsock is started once for the process and never stopped. */
+static bool startNetwork()
+{
+    static bool started = false;
+    if (started) return true;
+    WSADATA data;
+    started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    if (!started) printf("Unable to start Winsock\n");
+    return started;
+}
+
+/* The last call failed only because it would have blocked. */
+static bool wouldBlock()
+{
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+#else
+static bool startNetwork()
+{
+    return true;
+}
+
+static bool wouldBlock()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+#endif
+
+static sockaddr_in toSockaddr(const UdpAddress& address)
+{
+    sockaddr_in result;
+    memset(&result, 0, sizeof(result));
+    result.sin_family = AF_INET;
+    result.sin_addr.s_addr = htonl(address.host);
+    result.sin_port = htons(address.port);
+    return result;
+}
+
+bool operator==(const UdpAddress& a, const UdpAddress& b)
+{
+    return a.host == b.host && a.port == b.port;
+}
+
+bool resolveAddress(const std::string& text, UdpAddress& address)
+{
+    std::size_t colon = text.rfind(':');
+    long port = (colon != std::string::npos) ? strtol(text.c_str() + colon + 1, nullptr, 10) : 0;
+    if (port <= 0 || port > 65535)
+    {
+        printf("%s is not a host:port address\n", text.c_str());
+        return false;
+    }
+    if (!startNetwork()) return false;
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(text.substr(0, colon).c_str(), nullptr, &hints, &found) != 0 || found == nullptr)
+    {
+        printf("Unable to resolve %s\n", text.c_str());
+        return false;
+    }
+    address.host = ntohl(reinterpret_cast<const sockaddr_in*>(found->ai_addr)->sin_addr.s_addr);
+    address.port = static_cast<std::uint16_t>(port);
+    freeaddrinfo(found);
+    return true;
+}
+
+std::uint32_t networkTime()
+{
+    auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+UdpSocket::UdpSocket() :
+    _socket(NO_SOCKET),
+    _port(0)
+{}
+
+UdpSocket::~UdpSocket()
+{
+    close();
+}
+
+bool UdpSocket::open(std::uint16_t port, bool sharedPort)
+{
+    close();
+    if (!startNetwork()) return false;
+
+    _socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (_socket == NO_SOCKET)
+    {
+        printf("Unable to create a UDP socket\n");
+        return false;
+    }
+#if defined(__linux__)
+    int reusePort = 1;
+    if (sharedPort && setsockopt(_socket, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort)) != 0)
+    {
+        printf("Unable to share UDP port %u\n", port);
+        close();
+        return false;
+    }
+#else
+    if (sharedPort)
+    {
+        printf("UDP ports can only be shared between sockets on Linux\n");
+        close();
+        return false;
+    }
+#endif
+    sockaddr_in local = toSockaddr({ INADDR_ANY, port });
+    if (bind(_socket, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0)
+    {
+        printf("Unable to bind UDP port %u\n", port);
+        close();
+        return false;
+    }
+    socklen_t length = sizeof(local);
+    getsockname(_socket, reinterpret_cast<sockaddr*>(&local), &length);
+    _port = ntohs(local.sin_port);
+
+#if defined(_WIN32)
+    u_long nonBlocking = 1;
+    bool configured = ioctlsocket(_socket, FIONBIO, &nonBlocking) == 0;
+#else
+    bool configured = fcntl(_socket, F_SETFL, fcntl(_socket, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+    if (!configured)
+    {
+        printf("Unable to make the UDP socket non-blocking\n");
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool UdpSocket::setBufferSizes(int receiveBytes, int sendBytes)
+{
+    if (_socket == NO_SOCKET) return false;
+    /* The system may grant less than asked, the call only fails when refused. */
+    bool receiveSet = setsockopt(_socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&receiveBytes), sizeof(receiveBytes)) == 0;
+    bool sendSet = setsockopt(_socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&sendBytes), sizeof(sendBytes)) == 0;
+    return receiveSet && sendSet;
+}
+
+void UdpSocket::close()
+{
+    if (_socket != NO_SOCKET)
+    {
+#if defined(_WIN32)
+        closesocket(_socket);
+#else
+        ::close(_socket);
+#endif
+    }
+    _socket = NO_SOCKET;
+    _port = 0;
+}
+
+bool UdpSocket::isOpen() const
+{
+    return _socket != NO_SOCKET;
+}
+
+std::uint16_t UdpSocket::localPort() const
+{
+    return _port;
+}
+
+UdpSocket::Handle UdpSocket::handle() const
+{
+    return _socket;
+}
+
+bool UdpSocket::send(const UdpAddress& to, const void* data, std::size_t size)
+{
+    sockaddr_in address = toSockaddr(to);
+    int sent = sendto(_socket, static_cast<const char*>(data), static_cast<int>(size), 0, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    return sent == static_cast<int>(size);
+}
+
+std::size_t UdpSocket::sendBatch(const UdpAddress* to, std::size_t count, const void* data, std::size_t size)
+{
+#if defined(__linux__)
+    /* One system call per BATCH datagrams, every message pointing to the same buffer. */
+    const std::size_t BATCH = 256;
+    sockaddr_in addresses[BATCH];
+    mmsghdr messages[BATCH];
+    iovec buffer;
+    buffer.iov_base = const_cast<void*>(data);
+    buffer.iov_len = size;
+
+    std::size_t next = 0; /* First datagram not tried yet. */
+    std::size_t sent = 0;
+    while (next < count)
+    {
+        std::size_t batch = std::min(count - next, BATCH);
+        for (std::size_t i = 0; i < batch; ++i)
+        {
+            addresses[i] = toSockaddr(to[next + i]);
+            memset(&messages[i], 0, sizeof(mmsghdr));
+            messages[i].msg_hdr.msg_name = &addresses[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            messages[i].msg_hdr.msg_iov = &buffer;
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        int result = sendmmsg(_socket, messages, static_cast<unsigned int>(batch), 0);
+        if (result > 0)
+        {
+            next += static_cast<std::size_t>(result);
+            sent += static_cast<std::size_t>(result);
+            continue;
+        }
+        if (result < 0 && errno == EINTR) continue;
+
+        /* The first datagram of the batch failed (full buffer, bad address): skip only that one, not the peers after it. */
+        ++next;
+    }
+    return sent;
+#else
+    std::size_t sent = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (send(to[i], data, size)) ++sent;
+    }
+    return sent;
+#endif
+}
+
+int UdpSocket::receive(UdpAddress& from, void* buffer, std::size_t size)
+{
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int received = recvfrom(_socket, static_cast<char*>(buffer), static_cast<int>(size), 0, reinterpret_cast<sockaddr*>(&address), &length);
+    if (received < 0) return wouldBlock() ? 0 : -1;
+    from.host = ntohl(address.sin_addr.s_addr);
+    from.port = ntohs(address.sin_port);
+    return received;
+}